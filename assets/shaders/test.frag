@@ -1,6 +1,16 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Vulking::BindlessTable, bound once for every draw
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform Material {
+    uint textureIndex;
+} material;
+
+// Specialized per pipeline, the untaken branch is compiled out
+layout(constant_id = 0) const bool USE_TEXTURE = true;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -8,6 +18,12 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-    //outColor = vec4(fragTexCoord, 0.0, 1.0);
+    if (USE_TEXTURE) {
+        outColor = texture(
+            sampler2D(textures[nonuniformEXT(material.textureIndex)],
+                      samplers[0]),
+            fragTexCoord);
+    } else {
+        outColor = vec4(fragColor, 1.0);
+    }
 }
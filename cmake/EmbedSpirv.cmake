@@ -0,0 +1,51 @@
+# Run with cmake -P. Writes OUTPUT, a header with every SPIR-V file in INPUTS
+# ('|' separated) as a constexpr uint32_t array, plus EmbeddedShaders::ALL
+# listing them by file name for Vulking::ShaderLibrary::addEmbedded.
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+
+set(arrays "")
+set(entries "")
+list(LENGTH INPUTS count)
+foreach(input IN LISTS INPUTS)
+  get_filename_component(name "${input}" NAME)
+  string(MAKE_C_IDENTIFIER "${name}" identifier)
+
+  file(READ "${input}" hex HEX)
+  string(LENGTH "${hex}" length)
+  math(EXPR remainder "${length} % 8")
+  if(length EQUAL 0 OR NOT remainder EQUAL 0)
+    message(FATAL_ERROR "${input} is not SPIR-V, its size isn't a multiple of 4")
+  endif()
+
+  # glslc writes little endian words, the targets we build for are too
+  string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " words "${hex}")
+  # Six words to a line, CMake regexes have no {n}
+  set(word "0x[0-9a-f]+, ")
+  string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word})"
+                       "\\1\n    " words "${words}")
+  string(REPLACE ", \n" ",\n" words "${words}")
+  string(REGEX REPLACE ",[ \n]*$" "," words "${words}")
+
+  string(APPEND arrays
+         "inline constexpr uint32_t ${identifier}[] = {\n    ${words}\n};\n\n")
+  string(APPEND entries "    {\"${name}\", ${identifier}},\n")
+endforeach()
+
+file(
+  WRITE "${OUTPUT}"
+  "// Generated by cmake/EmbedSpirv.cmake, do not edit\n"
+  "#pragma once\n\n"
+  "#include <array>\n"
+  "#include <cstdint>\n"
+  "#include <span>\n"
+  "#include <string_view>\n"
+  "#include <utility>\n\n"
+  "namespace EmbeddedShaders {\n"
+  "${arrays}"
+  "inline constexpr std::array<\n"
+  "    std::pair<std::string_view, std::span<const uint32_t>>, ${count}>\n"
+  "    ALL = {{\n"
+  "${entries}"
+  "    }};\n"
+  "} // namespace EmbeddedShaders\n")
@@ -0,0 +1,41 @@
+# vulking_embed_shaders(<target> <glsl sources>...)
+#
+# Compiles each source with glslc and embeds the SPIR-V into <target> as
+# constexpr arrays in a generated embedded_shaders.hpp on its include path.
+# Shaders are looked up by their compiled file name, test.vert becomes
+# "test.vert.spv".
+
+find_program(GLSLC glslc)
+
+function(vulking_embed_shaders target)
+  if(NOT GLSLC)
+    message(FATAL_ERROR "vulking_embed_shaders needs glslc")
+  endif()
+
+  set(output_dir "${CMAKE_CURRENT_BINARY_DIR}/${target}_shaders")
+  set(spirv_files "")
+  foreach(source IN LISTS ARGN)
+    get_filename_component(name "${source}" NAME)
+    set(spirv "${output_dir}/${name}.spv")
+    add_custom_command(
+      OUTPUT "${spirv}"
+      COMMAND ${CMAKE_COMMAND} -E make_directory "${output_dir}"
+      COMMAND ${GLSLC} "${source}" -o "${spirv}"
+      DEPENDS "${source}"
+      COMMENT "Compiling ${name}")
+    list(APPEND spirv_files "${spirv}")
+  endforeach()
+
+  # '|' separated, a ';' list would be split into separate arguments
+  string(REPLACE ";" "|" inputs "${spirv_files}")
+  set(header "${output_dir}/embedded_shaders.hpp")
+  add_custom_command(
+    OUTPUT "${header}"
+    COMMAND ${CMAKE_COMMAND} "-DINPUTS=${inputs}" "-DOUTPUT=${header}" -P
+            "${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake"
+    DEPENDS ${spirv_files} "${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake"
+    COMMENT "Embedding shaders into ${target}")
+
+  target_sources(${target} PRIVATE "${header}")
+  target_include_directories(${target} PRIVATE "${output_dir}")
+endfunction()
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace Vulking {
+/// One global descriptor set holding every texture, sampler and storage
+/// buffer, which shaders address by index (descriptor indexing, Vulkan 1.2).
+/// It is bound once per frame instead of a set per material per draw.
+///
+/// The arrays are update-after-bind and partially bound, so entries can be
+/// added while frames using the set are in flight and unused slots may stay
+/// empty. Indices are stable until removed; removed ones are reused only once
+/// every frame that might still read them has completed.
+///
+/// In GLSL, with GL_EXT_nonuniform_qualifier:
+///   layout(set = N, binding = 0) uniform texture2D textures[];
+///   layout(set = N, binding = 1) readonly buffer Buffers { ... } buffers[];
+///   layout(set = N, binding = 2) uniform sampler samplers[];
+///   texture(sampler2D(textures[nonuniformEXT(i)], samplers[0]), uv)
+class BindlessTable {
+public:
+  static constexpr uint32_t TEXTURE_BINDING = 0;
+  static constexpr uint32_t BUFFER_BINDING = 1;
+  static constexpr uint32_t SAMPLER_BINDING = 2;
+
+  /* Upper bounds, lowered to the device's update after bind limits */
+  static constexpr uint32_t MAX_TEXTURES = 16384;
+  static constexpr uint32_t MAX_BUFFERS = 16384;
+  static constexpr uint32_t MAX_SAMPLERS = 64;
+
+  /* Linear, repeating and anisotropic, added by init */
+  static constexpr uint32_t DEFAULT_SAMPLER = 0;
+
+  BindlessTable() = default;
+  BindlessTable(const BindlessTable &) = delete;
+  BindlessTable &operator=(const BindlessTable &) = delete;
+  BindlessTable(BindlessTable &&) = delete;
+  BindlessTable &operator=(BindlessTable &&) = delete;
+
+  void init();
+
+  /* view must stay alive until removeTexture and the frames in flight after
+   * it. Thread safe, like the other add and remove functions. */
+  uint32_t
+  addTexture(vk::ImageView view,
+             vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  void removeTexture(uint32_t index);
+
+  uint32_t addBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0,
+                     vk::DeviceSize range = vk::WholeSize);
+  void removeBuffer(uint32_t index);
+
+  uint32_t addSampler(vk::Sampler sampler);
+  void removeSampler(uint32_t index);
+
+  vk::DescriptorSetLayout getLayout() const { return layout.get(); }
+  vk::DescriptorSet getSet() const { return set; }
+
+  void bind(vk::CommandBuffer cmd, vk::PipelineLayout pipelineLayout,
+            uint32_t setIndex,
+            vk::PipelineBindPoint bindPoint =
+                vk::PipelineBindPoint::eGraphics) const;
+
+private:
+  /* Indices handed out for one binding */
+  struct Slots {
+    uint32_t capacity = 0;
+    /* Never handed out yet, everything below it has been */
+    uint32_t next = 0;
+    std::vector<uint32_t> free;
+    /* (index, frame it was removed in), oldest first */
+    std::deque<std::pair<uint32_t, uint64_t>> retired;
+
+    uint32_t acquire(const char *what);
+    void release(uint32_t index);
+  };
+
+  void write(uint32_t binding, uint32_t index, vk::DescriptorType type,
+             const vk::DescriptorImageInfo *imageInfo,
+             const vk::DescriptorBufferInfo *bufferInfo);
+
+  vk::UniqueDescriptorSetLayout layout;
+  vk::UniqueDescriptorPool pool;
+  /* Freed with the pool */
+  vk::DescriptorSet set;
+  vk::UniqueSampler defaultSampler;
+
+  /* Also guards writes to set, which must be externally synchronized */
+  std::mutex mutex;
+  Slots textures;
+  Slots buffers;
+  Slots samplers;
+};
+} // namespace Vulking
@@ -19,6 +19,8 @@ struct BufferUsage {
       FINAL | vk::BufferUsageFlagBits::eVertexBuffer;
   static constexpr vk::BufferUsageFlags FINAL_INDEX_BUFFER =
       FINAL | vk::BufferUsageFlagBits::eIndexBuffer;
+  static constexpr vk::BufferUsageFlags READBACK =
+      vk::BufferUsageFlagBits::eTransferDst;
 };
 
 struct BufferMemory {
@@ -30,6 +32,9 @@ struct BufferMemory {
   static constexpr vk::MemoryPropertyFlags UNIFORM =
       vk::MemoryPropertyFlagBits::eHostVisible |
       vk::MemoryPropertyFlagBits::eHostCoherent;
+  static constexpr vk::MemoryPropertyFlags READBACK =
+      vk::MemoryPropertyFlagBits::eHostVisible |
+      vk::MemoryPropertyFlagBits::eHostCoherent;
 };
 template <typename T> class Buffer {
 public:
@@ -37,7 +42,7 @@ public:
   Buffer(const Buffer &) = delete;
   Buffer &operator=(const Buffer &) = delete;
   Buffer(Buffer &&other) noexcept
-      : buffer(std::move(other.buffer)), memory(std::move(other.memory)),
+      : memory(std::move(other.memory)), buffer(std::move(other.buffer)),
         _name(std::move(other._name)), size(other.size), pData(other.pData) {
     LOG_DEBUG("buffer move: " << _name);
   }
@@ -47,6 +52,9 @@ public:
       if (isMapped()) {
         unmap();
       }
+      if (buffer) {
+        Engine::ctx().uploader.cancel(buffer.get());
+      }
       buffer = std::move(other.buffer);
       memory = std::move(other.memory);
       _name = std::move(other._name);
@@ -65,9 +73,16 @@ public:
          vk::MemoryPropertyFlags properties, const char *name = "unnamed");
   Buffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
          vk::MemoryPropertyFlags properties, const char *name = "unnamed");
+  /* Cancels any AsyncUploader acquire still pending for the buffer */
+  ~Buffer() {
+    if (buffer) {
+      Engine::ctx().uploader.cancel(buffer.get());
+    }
+  }
 
   const vk::Buffer &getBuffer() const { return buffer.get(); }
-  const vk::DeviceMemory &getMemory() const { return memory.get(); }
+  vk::DeviceMemory getMemory() const { return memory.getMemory(); }
+  vk::DeviceSize getMemoryOffset() const { return memory.getOffset(); }
   const vk::DeviceSize &getSize() const { return size; }
 
   bool isMapped() const { return pData != nullptr; }
@@ -84,8 +99,10 @@ private:
             const char *name = "unnamed");
 
   vk::DeviceSize size;
+  // memory before buffer, so the buffer is destroyed before its memory is
+  // handed back to the allocator
+  Allocation memory;
   vk::UniqueBuffer buffer;
-  vk::UniqueDeviceMemory memory;
   void *pData = nullptr;
   std::string _name = "uninitialized";
 };
@@ -129,7 +146,12 @@ template <typename T> void Buffer<T>::map() { mapTo(&pData); }
 template <typename T> void Buffer<T>::mapTo(void **mapped) {
   LOG_DEBUG("\tmapped buffer: " << _name);
   assert(!isMapped());
-  *mapped = Engine::ctx().device->mapMemory(memory.get(), 0, size);
+  // Host visible memory is persistently mapped by the allocator
+  *mapped = memory.getMappedData();
+  if (*mapped == nullptr) {
+    throw std::runtime_error(
+        std::format("buffer '{}' is not host visible, can't map it", _name));
+  }
   pData = *mapped;
 }
 
@@ -150,7 +172,6 @@ template <typename T> void Buffer<T>::set(const vk::ArrayProxy<T> &src) const {
 template <typename T> void Buffer<T>::unmap() {
   LOG_DEBUG("\tunmapped buffer: " << _name);
   assert(isMapped());
-  Engine::ctx().device->unmapMemory(memory.get());
   pData = nullptr;
 }
 
@@ -175,22 +196,12 @@ void Buffer<T>::init(vk::BufferUsageFlags usage,
   info.setSharingMode(vk::SharingMode::eExclusive);
   buffer = Engine::ctx().device->createBufferUnique(info);
 
-  auto memoryRequirements =
-      Engine::ctx().device->getBufferMemoryRequirements(buffer.get());
-
-  vk::MemoryAllocateInfo allocInfo{};
-  allocInfo.setAllocationSize(memoryRequirements.size);
-  allocInfo.setMemoryTypeIndex(findMemoryType(Engine::ctx().physicalDevice,
-                                              memoryRequirements.memoryTypeBits,
-                                              properties));
-
-  memory = Engine::ctx().device->allocateMemoryUnique(allocInfo, ALLOCATOR);
+  memory = Engine::ctx().allocator.allocate(buffer.get(), properties, name);
 
   NAME_OBJECT(Engine::ctx().device, buffer.get(),
               std::format("{}_buffer", name));
-  NAME_OBJECT(Engine::ctx().device, memory.get(),
-              std::format("{}_memory", name));
 
-  Engine::ctx().device->bindBufferMemory(buffer.get(), memory.get(), 0);
+  Engine::ctx().device->bindBufferMemory(buffer.get(), memory.getMemory(),
+                                         memory.getOffset());
 }
 } // namespace Vulking
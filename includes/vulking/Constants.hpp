@@ -12,5 +12,12 @@ inline const std::vector<const char *> VALIDATION_LAYERS = {
 #endif
 
 inline const std::vector<const char *> DEVICE_EXTENSIONS = {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
     VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME};
+
+/* Relative to the working directory, empty keeps the cache in memory */
+inline const char *PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+/* Only required when rendering to a window */
+inline const std::vector<const char *> PRESENT_DEVICE_EXTENSIONS = {
+    VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -1,9 +1,27 @@
 #pragma once
 
+#include "Allocator.hpp"
+#include "AsyncUploader.hpp"
+#include "BindlessTable.hpp"
 #include "Common.hpp"
+#include "DescriptorAllocator.hpp"
+#include "FrameAllocator.hpp"
+#include "GeometryPool.hpp"
+#include "GpuProfiler.hpp"
 #include "Image.hpp"
+#include "ParallelRecorder.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineRegistry.hpp"
+#include "StagingRing.hpp"
+#include "ThreadPool.hpp"
 #include "UniqueSurface.hpp"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 namespace Vulking {
 struct Swapchain {
   Swapchain() {}
@@ -21,16 +39,55 @@ struct Swapchain {
   Image depth;
   vk::UniqueImageView depthView;
 
+  /* Headless only, owns what images points at */
+  std::vector<Image> offscreen;
   std::vector<vk::Image> images;
   std::vector<vk::UniqueImageView> views;
   std::vector<vk::UniqueFramebuffer> framebuffers;
+  /* Per image, signaled by the frame rendering to it and waited on by its
+   * present. Per image rather than per frame, since a semaphore can't be
+   * reused until the present waiting on it is done and only reacquiring the
+   * image tells us that. Empty headless. */
+  std::vector<vk::UniqueSemaphore> presentSemaphores;
 
+  /* The image acquired by the last beginRender */
   uint32_t currentImageIndex;
-  bool framebufferResized;
+  /* Set by the window's resize callback and by suboptimal or out of date
+   * presents, the next beginRender recreates the swapchain */
+  bool framebufferResized = false;
+  /* Layout render passes leave images in, ePresentSrcKHR for a window and
+   * eTransferSrcOptimal headless so they can be read back */
+  vk::ImageLayout presentLayout = vk::ImageLayout::ePresentSrcKHR;
+  /* From the last createFramebuffers, to rebuild them on recreation */
+  vk::RenderPass renderPass;
 
   void createFramebuffers(const vk::RenderPass &renderPass);
+  /* For the image acquired by the last beginRender */
   vk::Framebuffer getFramebuffer();
-  uint32_t getCurrentResourceIndex();
+
+  /* Moves everything tied to the current swapchain into the retired list,
+   * where frames submitted before frame can keep using it. Returns the old
+   * handle to pass as oldSwapchain. */
+  vk::SwapchainKHR retire(uint64_t frame);
+  /* Destroys retired resources no frame before completedFrames used */
+  void releaseRetired(uint64_t completedFrames);
+
+private:
+  /* Declared in destruction order reversed, framebuffers go first and the
+   * swapchain last */
+  struct Retired {
+    uint64_t frame;
+    vk::UniqueSwapchainKHR handle;
+    Image color;
+    vk::UniqueImageView colorView;
+    Image depth;
+    vk::UniqueImageView depthView;
+    std::vector<vk::UniqueSemaphore> presentSemaphores;
+    std::vector<vk::UniqueImageView> views;
+    std::vector<vk::UniqueFramebuffer> framebuffers;
+  };
+
+  std::deque<Retired> retired;
 };
 
 struct Context {
@@ -47,32 +104,105 @@ struct Context {
   vk::PhysicalDevice physicalDevice;
   vk::UniqueDevice device;
 
+  // Declared after device and before anything holding allocations, so it is
+  // destroyed after them but before the device.
+  Allocator allocator;
+  StagingRing staging;
+  /* Before anything holding images or buffers, whose destructors cancel
+   * their pending acquires */
+  AsyncUploader uploader;
+  /* Transient uniform and storage data, one region per frame in flight */
+  FrameAllocator frameData;
+  /* Every Mesh's vertices and indices */
+  GeometryPool geometry;
+  /* Saved when destroyed, which needs the device */
+  PipelineCache pipelineCache;
+  /* After pipelineCache, its compiles use it until they are drained */
+  PipelineRegistry pipelines;
+  /* Persistent sets and the per frame transient pools */
+  DescriptorAllocator descriptors;
+  /* Every texture, sampler and storage buffer shaders index into */
+  BindlessTable bindless;
+
   Swapchain swapchain;
 
+  /* Owns the per frame primary command buffers, only used by the render
+   * thread */
   vk::UniqueCommandPool commandPool;
-
+  struct ThreadCommandPool {
+    vk::UniqueCommandPool pool;
+    std::weak_ptr<const void> thread;
+  };
+  /* One per live thread that has called beginCommand. Pools of threads that
+   * have exited are destroyed when the next new thread asks for one. */
+  std::unordered_map<std::thread::id, ThreadCommandPool> threadCommandPools;
+  std::mutex threadCommandPoolsMutex;
+
+  ThreadPool workers;
+  ParallelRecorder recorder;
+  GpuProfiler gpuProfiler;
+
+  /* Everything below is per frame in flight, indexed by getFrameIndex() */
   std::vector<vk::UniqueCommandBuffer> commandBuffers;
+  /* Records queue family acquires for finished async uploads */
+  std::vector<vk::UniqueCommandBuffer> acquireCommandBuffers;
   std::vector<vk::UniqueFence> inFlightFences;
   std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
-  std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
 
   vk::Queue graphicsQueue;
   uint32_t graphicsQueueFamily;
   vk::Queue presentQueue;
   uint32_t presentQueueFamily;
+  /* Same as the graphics queue when the device has no separate transfer
+   * family */
+  vk::Queue transferQueue;
+  uint32_t transferQueueFamily;
+  /* Submitting and presenting need the queue externally synchronized, and
+   * the queues above may be the same VkQueue */
+  std::mutex queueMutex;
 
   vk::SampleCountFlagBits msaaSamples = vk::SampleCountFlagBits::e1;
-
+  /* VK_KHR_push_descriptor was found and enabled. DescriptorTemplate falls
+   * back to transient sets without it. */
+  bool pushDescriptors = false;
+  /* hostQueryReset was found and enabled. GpuProfiler records its resets
+   * into the frame's submit without it. */
+  bool hostQueryReset = false;
+
+  static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+  /* Frames the CPU may record ahead of the GPU. 2 keeps latency low, 3
+   * gives the CPU more slack to keep the GPU busy. Independent of the number
+   * of swapchain images. */
+  uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
   uint32_t frame;
+  /* Frames the GPU is known to have finished, set by beginRender after its
+   * fence wait. Anything last used by a frame before it is free to reuse.
+   * Atomic, loader threads read it while the render thread advances it. */
+  std::atomic<uint64_t> completedFrames = 0;
 
+  uint32_t getFrameIndex() const { return frame % framesInFlight; }
+
+  bool isHeadless() const { return window == nullptr; }
+
+  /* Allocates from the calling thread's command pool, so it is safe to call
+   * from any thread. cmd must be submitted from the same thread. */
   vk::CommandBuffer beginCommand(const char *name = "unnamed");
-  void endAndSubmitGraphicsCommand(vk::CommandBuffer &&cmd);
+  /* Submits, waits and frees cmd. Staging slices allocated for scope are
+   * recycled once it has run. */
+  void endAndSubmitGraphicsCommand(vk::CommandBuffer &&cmd,
+                                   StagingRing::Scope scope = 0);
 
-  /* tuple<command buffer to populate, current swapchain resourceIndex> */
+  /* tuple<command buffer to populate, acquired swapchain image index>. Per
+   * frame resources should be indexed by getFrameIndex() instead. */
   std::optional<std::tuple<vk::CommandBuffer, uint32_t>> beginRender();
 
   void endRender(const std::vector<vk::CommandBuffer> &commandBuffers);
 
+  /* Headless only. Waits for the frame last passed to endRender and copies
+   * its image to the host as tightly packed RGBA8 rows. */
+  std::vector<uint8_t> readback();
+
   vk::ImageView createImageView(vk::Image image, vk::Format format,
                                 vk::ImageAspectFlags aspectFlags,
                                 uint32_t mipLevels,
@@ -81,5 +211,8 @@ struct Context {
                                             vk::ImageAspectFlags aspectFlags,
                                             uint32_t mipLevels,
                                             const char *name = "unnamed");
+
+private:
+  vk::CommandPool getThreadCommandPool();
 };
 } // namespace Vulking
@@ -13,21 +13,43 @@ public:
 public:
   Engine(GLFWwindow *window, const char *applicationInfo,
          uint32_t applicationVersion,
-         const std::vector<const char *> &requiredExtensions);
+         const std::vector<const char *> &requiredExtensions,
+         uint32_t framesInFlight = Context::DEFAULT_FRAMES_IN_FLIGHT);
+  /* Headless, renders into imageCount offscreen images instead of a window's
+   * swapchain and reads them back with Context::readback. Needs no display
+   * and accepts CPU implementations such as lavapipe. imageCount is raised
+   * to framesInFlight if lower, so frames in flight never share an image. */
+  Engine(vk::Extent2D extent, const char *applicationInfo,
+         uint32_t applicationVersion,
+         const std::vector<const char *> &requiredExtensions = {},
+         uint32_t imageCount = 2,
+         uint32_t framesInFlight = Context::DEFAULT_FRAMES_IN_FLIGHT);
 
   Context &getContext() noexcept { return context; }
 
+  /* Called by Context when the window was resized or the swapchain went out
+   * of date. Doesn't wait for the device. */
+  void recreateSwapchain();
+
 private:
   vk::UniqueInstance
   createInstance(const char *applicationInfo, uint32_t applicationVersion,
                  const std::vector<const char *> &requiredExtensions);
 
+  void initDevice();
+  void initSwapchain(vk::SwapchainKHR oldSwapchain);
+  void createAttachments();
+  void initFrameResources();
+
   vk::UniqueDevice createDevice();
-  vk::UniqueSwapchainKHR createSwapchain();
+  vk::UniqueSwapchainKHR createSwapchain(vk::SwapchainKHR oldSwapchain);
   vk::UniqueCommandPool createCommandPool();
 
   vk::PhysicalDevice getSuitablePhysicalDevice();
   bool isDeviceSuitable(vk::PhysicalDevice physicalDevice) const;
+  /* Higher is preferred, 0 is unusable */
+  static uint32_t getDeviceTypeRank(vk::PhysicalDeviceType type);
+  std::vector<const char *> getDeviceExtensions() const;
 
   vk::SurfaceFormatKHR chooseSwapSurfaceFormat(
       const std::vector<vk::SurfaceFormatKHR> &availableFormats);
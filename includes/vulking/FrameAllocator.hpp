@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Allocator.hpp"
+#include "Common.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace Vulking {
+/// A piece of the current frame's transient data. Bind it through a dynamic
+/// uniform or storage buffer descriptor pointing at buffer, passing offset
+/// as the dynamic offset.
+struct FrameAllocation {
+  vk::Buffer buffer;
+  uint32_t offset;
+  vk::DeviceSize size;
+  void *pData;
+};
+
+/// Persistently mapped, host coherent buffer for uniform and storage data
+/// that only lives for one frame, such as per object transforms. Every
+/// frame in flight owns a region of it, and allocating is an atomic bump
+/// within the current frame's region, which beginFrame rewinds once the
+/// frame's fence has signaled.
+///
+/// Allocations are aligned for both uniform and storage buffer offsets, so
+/// one descriptor set with a dynamic buffer pointing at getBuffer() serves
+/// every draw of every frame, and per draw data needs no descriptor update.
+class FrameAllocator {
+public:
+  static constexpr vk::DeviceSize DEFAULT_FRAME_SIZE = 4ull * 1024 * 1024;
+
+  FrameAllocator() = default;
+  FrameAllocator(const FrameAllocator &) = delete;
+  FrameAllocator &operator=(const FrameAllocator &) = delete;
+  FrameAllocator(FrameAllocator &&) = delete;
+  FrameAllocator &operator=(FrameAllocator &&) = delete;
+
+  void init(uint32_t frameCount, vk::DeviceSize frameSize = DEFAULT_FRAME_SIZE);
+
+  /* Called by Context::beginRender after the frame's fence has signaled */
+  void beginFrame(uint32_t frameIndex);
+
+  /* Thread safe and lock free. Throws when the frame's region is full. */
+  FrameAllocation allocate(vk::DeviceSize size);
+  template <typename T> FrameAllocation push(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto allocation = allocate(sizeof(T));
+    std::memcpy(allocation.pData, &value, sizeof(T));
+    return allocation;
+  }
+
+  vk::Buffer getBuffer() const { return buffer.get(); }
+  /* For the descriptor of a dynamic buffer reading range bytes per draw */
+  vk::DescriptorBufferInfo getBufferInfo(vk::DeviceSize range) const {
+    return vk::DescriptorBufferInfo{}
+        .setBuffer(buffer.get())
+        .setOffset(0)
+        .setRange(range);
+  }
+  vk::DeviceSize getAlignment() const { return alignment; }
+  vk::DeviceSize getFrameSize() const { return frameSize; }
+  /* Bytes allocated so far in the current frame */
+  vk::DeviceSize getUsed() const;
+
+private:
+  Allocation memory;
+  vk::UniqueBuffer buffer;
+  char *pData = nullptr;
+  vk::DeviceSize frameSize = 0;
+  vk::DeviceSize alignment = 1;
+
+  /* Start of the current frame's region */
+  vk::DeviceSize frameBegin = 0;
+  /* Absolute offset of the next allocation */
+  std::atomic<vk::DeviceSize> head = 0;
+};
+} // namespace Vulking
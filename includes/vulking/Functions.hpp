@@ -93,16 +93,28 @@ vk::UniqueSampler createSampler();
 void copyBuffer(const vk::Buffer &src, const vk::Buffer &dst,
                 const vk::DeviceSize size);
 
-void copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width,
-                       uint32_t height);
+void copyBufferToImage(vk::Buffer buffer, vk::DeviceSize bufferOffset,
+                       vk::Image image, uint32_t width, uint32_t height);
+void recordCopyBufferToImage(vk::CommandBuffer cmd, vk::Buffer buffer,
+                             vk::DeviceSize bufferOffset, vk::Image image,
+                             uint32_t width, uint32_t height);
 
 void transitionImageLayout(vk::Image image, vk::Format format,
                            uint32_t mipLevels, vk::ImageLayout from,
                            vk::ImageLayout to);
+void recordTransitionImageLayout(vk::CommandBuffer cmd, vk::Image image,
+                                 vk::Format format, uint32_t mipLevels,
+                                 vk::ImageLayout from, vk::ImageLayout to);
 
 void generateMipmaps(vk::Image image, vk::Format format, int32_t width,
                      int32_t height, uint32_t mipLevels);
 
+/* Expects every mip level in eTransferDstOptimal, leaves them all in
+ * eShaderReadOnlyOptimal. Needs a graphics queue for the blits. */
+void recordGenerateMipmaps(vk::CommandBuffer cmd, vk::Image image,
+                           vk::Format format, int32_t width, int32_t height,
+                           uint32_t mipLevels);
+
 std::tuple<std::vector<char>, uint32_t, uint32_t>
 loadRgba8888Texture(const char *path);
 } // namespace Vulking
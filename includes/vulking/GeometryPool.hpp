@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Allocator.hpp"
+#include "Common.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace Vulking {
+class GeometryPool;
+
+/// A mesh's vertices and indices inside the GeometryPool. Returns them to
+/// the pool when destroyed, which hands them out again once no frame in
+/// flight can still be drawing them.
+class GeometryRange {
+public:
+  GeometryRange() = default;
+  GeometryRange(const GeometryRange &) = delete;
+  GeometryRange &operator=(const GeometryRange &) = delete;
+  GeometryRange(GeometryRange &&other) noexcept { *this = std::move(other); }
+  GeometryRange &operator=(GeometryRange &&other) noexcept {
+    if (this != &other) {
+      reset();
+      pool = other.pool;
+      vertexByteOffset = other.vertexByteOffset;
+      indexByteOffset = other.indexByteOffset;
+      vertexOffset = other.vertexOffset;
+      firstIndex = other.firstIndex;
+      other.pool = nullptr;
+    }
+    return *this;
+  }
+  ~GeometryRange() { reset(); }
+
+  void reset();
+
+  /* For drawIndexed, in vertices and indices from the pool's start */
+  int32_t getVertexOffset() const { return vertexOffset; }
+  uint32_t getFirstIndex() const { return firstIndex; }
+  /* Where uploads go */
+  vk::DeviceSize getVertexByteOffset() const { return vertexByteOffset; }
+  vk::DeviceSize getIndexByteOffset() const { return indexByteOffset; }
+
+  explicit operator bool() const { return pool != nullptr; }
+
+private:
+  friend class GeometryPool;
+
+  GeometryPool *pool = nullptr;
+  vk::DeviceSize vertexByteOffset = 0;
+  vk::DeviceSize indexByteOffset = 0;
+  int32_t vertexOffset = 0;
+  uint32_t firstIndex = 0;
+};
+
+/// One vertex buffer and one index buffer that every mesh is sub-allocated
+/// from, so a scene is drawn with a single bind and draws differ only in
+/// drawIndexed's firstIndex and vertexOffset, ready to be merged into
+/// indirect or multi draws.
+///
+/// Indices are relative to their mesh's vertexOffset, so 16 and 32 bit
+/// index ranges can share the index buffer; binding it with the other index
+/// type is the only state change between them.
+class GeometryPool {
+public:
+  static constexpr vk::DeviceSize DEFAULT_VERTEX_CAPACITY = 64ull * 1024 * 1024;
+  static constexpr vk::DeviceSize DEFAULT_INDEX_CAPACITY = 32ull * 1024 * 1024;
+  /* So both 16 and 32 bit ranges start on a whole index */
+  static constexpr vk::DeviceSize INDEX_ALIGNMENT = sizeof(uint32_t);
+
+  GeometryPool() = default;
+  GeometryPool(const GeometryPool &) = delete;
+  GeometryPool &operator=(const GeometryPool &) = delete;
+  GeometryPool(GeometryPool &&) = delete;
+  GeometryPool &operator=(GeometryPool &&) = delete;
+
+  void init(uint32_t vertexStride,
+            vk::DeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+            vk::DeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+  /* Thread safe. Throws when either buffer has no room left. */
+  GeometryRange allocate(uint32_t vertexCount, uint32_t indexCount,
+                         vk::IndexType indexType);
+
+  /* Binds the vertex buffer to binding 0 and the index buffer */
+  void bind(vk::CommandBuffer cmd, vk::IndexType indexType) const;
+
+  vk::Buffer getVertexBuffer() const { return vertexBuffer.get(); }
+  vk::Buffer getIndexBuffer() const { return indexBuffer.get(); }
+  uint32_t getVertexStride() const { return vertexStride; }
+  vk::DeviceSize getVertexBytesUsed() const;
+  vk::DeviceSize getIndexBytesUsed() const;
+
+private:
+  friend class GeometryRange;
+
+  void free(const GeometryRange &range);
+  /* Frees what was released in frames the GPU has completed */
+  void reclaim();
+
+  Allocation vertexMemory;
+  vk::UniqueBuffer vertexBuffer;
+  Allocation indexMemory;
+  vk::UniqueBuffer indexBuffer;
+  uint32_t vertexStride = 0;
+
+  mutable std::mutex mutex;
+  RangeAllocator vertexRanges;
+  RangeAllocator indexRanges;
+  struct Retired {
+    vk::DeviceSize vertexByteOffset;
+    vk::DeviceSize indexByteOffset;
+    uint64_t frame;
+  };
+  /* oldest first */
+  std::deque<Retired> retired;
+};
+} // namespace Vulking
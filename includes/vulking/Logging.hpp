@@ -1,47 +1,42 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 #ifndef PROJECT_ROOT
 // Set by CMakeLists.txt, prefix to strip from __FILE__
 #define PROJECT_ROOT ""
 #endif
 
-#ifdef NDEBUG
-#define LOG_TRACE(...)
-#define LOG_DEBUG(...)
-#else
-#define LOG_TRACE(x)                                                           \
-  do {                                                                         \
-    static constexpr auto _prefix = COMPTIME_PREFIX(__FILE__, __LINE__);       \
-    std::cout << _prefix.c_str() << "[trce]: " << x << "\n";                   \
-  } while (0)
-
-#define LOG_DEBUG(x)                                                           \
-  do {                                                                         \
-    static constexpr auto _prefix = COMPTIME_PREFIX(__FILE__, __LINE__);       \
-    std::cout << _prefix.c_str() << "[dbug]: " << x << "\n";                   \
-  } while (0)
+#ifndef VULKING_LOG_MIN_LEVEL
+// Sites below this level are compiled out, everything else is filtered at
+// runtime (see Vulking::Logger::configure)
+#define VULKING_LOG_MIN_LEVEL Vulking::LogLevel::Trace
 #endif
 
-#define LOG_INFO(x)                                                            \
-  do {                                                                         \
-    static constexpr auto _prefix = COMPTIME_PREFIX(__FILE__, __LINE__);       \
-    std::cout << _prefix.c_str() << "[info]: " << x << "\n";                   \
-  } while (0)
-
-#define LOG_WARNING(x)                                                         \
+#define LOG_AT(level, x)                                                       \
   do {                                                                         \
     static constexpr auto _prefix = COMPTIME_PREFIX(__FILE__, __LINE__);       \
-    std::cout << _prefix.c_str() << "[warn]: " << x << "\n";                   \
+    static constinit Vulking::LogSite _site{_prefix.c_str(), level};           \
+    if (level >= VULKING_LOG_MIN_LEVEL && _site.shouldLog()) {                 \
+      Vulking::LogRecord(&_site) << x;                                         \
+    }                                                                          \
   } while (0)
 
-#define LOG_ERROR(x)                                                           \
-  do {                                                                         \
-    static constexpr auto _prefix = COMPTIME_PREFIX(__FILE__, __LINE__);       \
-    std::cout << _prefix.c_str() << "[erro]: " << x << "\n";                   \
-  } while (0)
+#define LOG_TRACE(x) LOG_AT(Vulking::LogLevel::Trace, x)
+#define LOG_DEBUG(x) LOG_AT(Vulking::LogLevel::Debug, x)
+#define LOG_INFO(x) LOG_AT(Vulking::LogLevel::Info, x)
+#define LOG_WARNING(x) LOG_AT(Vulking::LogLevel::Warning, x)
+#define LOG_ERROR(x) LOG_AT(Vulking::LogLevel::Error, x)
 
 constexpr std::size_t LOG_PREFIX_WIDTH = 40;
 constexpr std::size_t MAX_PREFIX_SIZE = 256;
@@ -124,3 +119,197 @@ constexpr Prefix<N> build_prefix(std::string_view file, int line) {
   ([]() constexpr -> auto {                                                    \
     return build_prefix<MAX_PREFIX_SIZE>(file, line);                          \
   }())
+
+namespace Vulking {
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warning, Error, Off };
+
+/// One per LOG_* statement, static so records only carry a pointer to it.
+///
+/// Sites register themselves with Logger the first time they are reached and
+/// cache what the rules say about them, re-resolving whenever the rules
+/// change. Checking a site is then two relaxed loads, plus the rate limit
+/// bookkeeping for sites that have one.
+struct LogSite {
+  const char *prefix;
+  LogLevel level;
+
+  /* Logger::generation the fields below were resolved for, 0 until the site
+   * is registered */
+  std::atomic<uint32_t> generation = 0;
+  std::atomic<bool> enabled = false;
+  std::atomic<uint32_t> maxPerSecond = 0;
+  std::atomic<uint32_t> sampleEvery = 1;
+
+  std::atomic<uint64_t> hits = 0;
+  std::atomic<uint64_t> window = 0;
+  std::atomic<uint32_t> windowCount = 0;
+  /* Dropped by the rate limit since the last record that got through */
+  std::atomic<uint32_t> suppressed = 0;
+  /* Registry list, guarded by Logger */
+  LogSite *next = nullptr;
+
+  bool shouldLog();
+};
+
+/// Runtime filter for the sites whose prefix starts with module, e.g.
+/// "src/Buffer.hpp" or "src/". The longest matching module wins, "" is the
+/// default for everything. Headers user code includes from
+/// "includes/vulking/" count as their "src/" originals, so a rule for
+/// src/Buffer.hpp also covers Buffer<T> instantiated in user code.
+struct LogRule {
+  std::string module;
+  LogLevel level;
+  /* 0 is unlimited */
+  uint32_t maxPerSecond = 0;
+  /* Keep one record in sampleEvery */
+  uint32_t sampleEvery = 1;
+};
+
+/* Tags in front of each argument of a record */
+enum class LogArg : uint8_t { Bool, Char, Int, Uint, Float, Pointer, String };
+
+/// Asynchronous backend behind the LOG_* macros.
+///
+/// Every thread writes its records into its own lock-free ring; a background
+/// thread drains the rings every few milliseconds, orders the records by
+/// time and formats them to the output. Formatting, the stream and its lock
+/// are all off the calling thread.
+///
+/// LOG_ERROR waits for everything logged so far to be written, so nothing is
+/// lost if the error ends the process. Once the backend has shut down at exit,
+/// records are formatted synchronously.
+class Logger {
+public:
+  static void write(const LogSite *site, const std::byte *args, size_t size);
+  /* Blocks until every record logged before the call has been written */
+  static void flush();
+  /* std::cout by default. Flushes before switching. */
+  static void setOutput(std::ostream &output);
+  /* Formats a record the way the backend writes it */
+  static void format(std::ostream &output, const LogSite &site,
+                     const std::byte *args, size_t size);
+
+  /* Replaces every rule. spec is a comma separated list of
+   * [module=]level[/maxPerSecond][%sampleEvery], e.g.
+   * "info,src/Buffer.hpp=debug/10,src/Context.cpp=trace%60". level is one
+   * of trace, debug, info, warning, error and off. Without a default entry
+   * debug builds log everything and release builds info and above.
+   *
+   * Also read from the VULKING_LOG environment variable at startup. */
+  static void configure(std::string_view spec);
+  /* Adds the rule, or replaces the one for the same module */
+  static void setRule(const LogRule &rule);
+  /* Every site reached so far */
+  static std::vector<const LogSite *> getSites();
+
+  /* Called by LogSite when its cached rule is stale */
+  static void resolve(LogSite &site);
+  /* Rate limit check for sites that have one */
+  static bool admit(LogSite &site);
+  /* Bumped whenever the rules change */
+  static inline std::atomic<uint32_t> generation = 1;
+};
+
+inline bool LogSite::shouldLog() {
+  if (generation.load(std::memory_order_acquire) !=
+      Logger::generation.load(std::memory_order_relaxed)) {
+    Logger::resolve(*this);
+  }
+  if (!enabled.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  const auto every = sampleEvery.load(std::memory_order_relaxed);
+  if (every > 1 && hits.fetch_add(1, std::memory_order_relaxed) % every != 0) {
+    return false;
+  }
+  if (maxPerSecond.load(std::memory_order_relaxed) != 0) {
+    return Logger::admit(*this);
+  }
+  return true;
+}
+
+/// Encodes the << chain of one LOG_* statement as tagged raw values and hands
+/// it to Logger when the statement ends. Numbers and strings are copied as
+/// they are; anything else is formatted here with its operator<< so it
+/// doesn't have to outlive the statement.
+class LogRecord {
+public:
+  explicit LogRecord(LogSite *site) : site(site) {}
+  LogRecord(const LogRecord &) = delete;
+  LogRecord &operator=(const LogRecord &) = delete;
+  ~LogRecord() {
+    if (site->maxPerSecond.load(std::memory_order_relaxed) != 0) {
+      if (const auto count = site->suppressed.exchange(0)) {
+        *this << " (" << count << " more suppressed)";
+      }
+    }
+    Logger::write(site, data(), size);
+  }
+
+  template <typename T> LogRecord &operator<<(const T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      put(LogArg::Bool, value);
+    } else if constexpr (std::is_same_v<T, char> ||
+                         std::is_same_v<T, signed char> ||
+                         std::is_same_v<T, unsigned char>) {
+      // ostream prints these as characters, not numbers
+      put(LogArg::Char, static_cast<char>(value));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      put(LogArg::Int, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<T>) {
+      put(LogArg::Uint, static_cast<uint64_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      put(LogArg::Float, static_cast<double>(value));
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+      putString(value);
+    } else if constexpr (std::is_pointer_v<T>) {
+      put(LogArg::Pointer, static_cast<const void *>(value));
+    } else {
+      std::ostringstream stream;
+      stream << value;
+      putString(stream.view());
+    }
+    return *this;
+  }
+
+private:
+  static constexpr size_t INLINE_SIZE = 256;
+
+  template <typename V> void put(LogArg tag, V value) {
+    append(&tag, sizeof(tag));
+    append(&value, sizeof(value));
+  }
+
+  void putString(std::string_view value) {
+    const auto tag = LogArg::String;
+    const auto length = static_cast<uint32_t>(value.size());
+    append(&tag, sizeof(tag));
+    append(&length, sizeof(length));
+    append(value.data(), length);
+  }
+
+  void append(const void *src, size_t count) {
+    if (spill.empty() && size + count <= INLINE_SIZE) {
+      std::memcpy(inlineData.data() + size, src, count);
+    } else {
+      // Longer records move to the heap, most never get here
+      if (spill.empty()) {
+        spill.assign(inlineData.begin(), inlineData.begin() + size);
+      }
+      const auto *bytes = static_cast<const std::byte *>(src);
+      spill.insert(spill.end(), bytes, bytes + count);
+    }
+    size += count;
+  }
+
+  const std::byte *data() const {
+    return spill.empty() ? inlineData.data() : spill.data();
+  }
+
+  LogSite *site;
+  size_t size = 0;
+  /* Left uninitialized, only the first size bytes are read */
+  std::array<std::byte, INLINE_SIZE> inlineData;
+  std::vector<std::byte> spill;
+};
+} // namespace Vulking
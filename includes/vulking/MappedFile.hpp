@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <filesystem>
+#include <span>
+
+namespace Vulking {
+/// Read-only memory mapping of a whole file. Pages are faulted in by the OS
+/// as they are touched, so nothing is read or copied up front, and the data
+/// is page aligned.
+class MappedFile {
+public:
+  explicit MappedFile(const std::filesystem::path &path);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+  ~MappedFile();
+
+  const std::byte *data() const { return bytes; }
+  size_t size() const { return length; }
+  std::span<const std::byte> getBytes() const { return {bytes, length}; }
+  std::string_view getText() const {
+    return {reinterpret_cast<const char *>(bytes), length};
+  }
+
+private:
+  const std::byte *bytes = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  void *mapping = nullptr;
+#endif
+};
+} // namespace Vulking
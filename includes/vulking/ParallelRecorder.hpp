@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+
+namespace Vulking {
+/// Records secondary command buffers for the current frame on worker threads.
+///
+/// Every (frame, worker) pair owns its own transient command pool, so workers
+/// never share a pool and never take a lock while recording. A frame's pools
+/// are reset in one call once beginRender has waited for that frame's fence,
+/// which recycles every secondary recorded for it.
+class ParallelRecorder {
+public:
+  using RecordFn =
+      std::function<void(vk::CommandBuffer cmd, size_t begin, size_t end)>;
+
+  /* Below this many items per chunk the cost of an extra secondary command
+   * buffer outweighs recording on another core */
+  static constexpr size_t DEFAULT_MIN_CHUNK = 64;
+
+  ParallelRecorder() = default;
+  ParallelRecorder(const ParallelRecorder &) = delete;
+  ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+  ParallelRecorder(ParallelRecorder &&) = delete;
+  ParallelRecorder &operator=(ParallelRecorder &&) = delete;
+
+  void init(ThreadPool &workers, uint32_t frameCount);
+
+  /* Called by Context::beginRender after the frame's fence has signaled */
+  void beginFrame(uint32_t frameIndex);
+
+  /* Splits [0, count) into chunks and calls fn for each on a worker, with a
+   * secondary command buffer that continues the render pass described by
+   * inheritance. fn must bind everything it uses (pipeline, dynamic state,
+   * descriptor sets), secondaries inherit none of it.
+   *
+   * Returns the recorded buffers in chunk order, ready for
+   * executeCommands() inside a render pass begun with
+   * eSecondaryCommandBuffers. Valid until the same frame index comes around
+   * again. */
+  std::vector<vk::CommandBuffer>
+  record(const vk::CommandBufferInheritanceInfo &inheritance, size_t count,
+         const RecordFn &fn, size_t minChunk = DEFAULT_MIN_CHUNK);
+
+private:
+  struct WorkerPool {
+    vk::UniqueCommandPool pool;
+    /* Freed with the pool */
+    std::vector<vk::CommandBuffer> buffers;
+    /* buffers handed out since the last reset */
+    uint32_t used = 0;
+  };
+
+  vk::CommandBuffer acquire(WorkerPool &pool, uint32_t worker);
+
+  ThreadPool *workers = nullptr;
+  /* [frame][worker] */
+  std::vector<std::vector<WorkerPool>> frames;
+  uint32_t frameIndex = 0;
+};
+} // namespace Vulking
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Common.hpp"
+#include "ShaderLibrary.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <bit>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Vulking {
+/// Values for a shader's specialization constants by constant_id. GLSL
+/// bool, int, uint and float constants are all 32 bits, so every value is
+/// stored as one word. Constants left unset keep the shader's default.
+class Specialization {
+public:
+  Specialization &set(uint32_t constantId, bool value) {
+    values[constantId] = value ? vk::True : vk::False;
+    return *this;
+  }
+  Specialization &set(uint32_t constantId, int32_t value) {
+    values[constantId] = std::bit_cast<uint32_t>(value);
+    return *this;
+  }
+  Specialization &set(uint32_t constantId, uint32_t value) {
+    values[constantId] = value;
+    return *this;
+  }
+  Specialization &set(uint32_t constantId, float value) {
+    values[constantId] = std::bit_cast<uint32_t>(value);
+    return *this;
+  }
+
+  bool empty() const { return values.empty(); }
+  /* Sorted by constant_id, so equal sets compare and hash equal */
+  const std::map<uint32_t, uint32_t> &getValues() const { return values; }
+
+  auto operator<=>(const Specialization &) const = default;
+  size_t hash() const;
+
+private:
+  std::map<uint32_t, uint32_t> values;
+};
+
+/* Keyed by the SPIR-V it holds, the module is only created for compiling */
+struct ShaderStage {
+  vk::ShaderStageFlagBits stage;
+  ShaderCode code;
+  std::string entrypoint = "main";
+  Specialization specialization;
+
+  bool operator==(const ShaderStage &) const = default;
+};
+
+/// A pipeline layout, created and owned by PipelineRegistry so that equal
+/// descriptions share one. The descriptor set layouts are keyed by handle
+/// and have to outlive the registry, as the engine's own ones do.
+struct PipelineLayoutDesc {
+  std::vector<vk::DescriptorSetLayout> setLayouts;
+  std::vector<vk::PushConstantRange> pushConstantRanges;
+
+  bool operator==(const PipelineLayoutDesc &) const = default;
+  size_t hash() const;
+};
+
+/// The render pass a pipeline is compiled against. Pipelines can be used in
+/// any render pass compatible with it, so what is compared is what
+/// compatibility depends on: the attachments' formats and sample counts and
+/// which of them every subpass references as input, color, resolve and
+/// depth attachments, plus the subpass the pipeline is for. Layouts and
+/// load/store ops are left out, the handle only has to stay alive until the
+/// pipeline is ready. References are compared by attachment index, which is
+/// stricter than Vulkan needs but never calls incompatible passes equal.
+struct RenderPassDesc {
+  struct Subpass {
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> colors;
+    /* Empty when the subpass resolves nothing */
+    std::vector<uint32_t> resolves;
+    uint32_t depth = vk::AttachmentUnused;
+
+    bool operator==(const Subpass &) const = default;
+  };
+
+  vk::RenderPass renderPass;
+  std::vector<std::pair<vk::Format, vk::SampleCountFlagBits>> attachments;
+  std::vector<Subpass> subpasses;
+  uint32_t subpass = 0;
+
+  static RenderPassDesc fromCreateInfo(vk::RenderPass renderPass,
+                                       const vk::RenderPassCreateInfo &info,
+                                       uint32_t subpass = 0);
+
+  bool operator==(const RenderPassDesc &other) const {
+    return attachments == other.attachments &&
+           subpasses == other.subpasses && subpass == other.subpass;
+  }
+  size_t hash() const;
+};
+
+/// Everything a graphics pipeline compiles from, as plain values so that
+/// identical descriptions hash and compare equal whatever handles they were
+/// built from. Viewport and scissor are always dynamic.
+struct GraphicsPipelineDesc {
+  std::vector<ShaderStage> stages;
+  std::vector<vk::VertexInputBindingDescription> bindings;
+  std::vector<vk::VertexInputAttributeDescription> attributes;
+  vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+  vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+  vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+  vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+
+  bool depthTest = true;
+  bool depthWrite = true;
+  vk::CompareOp depthCompare = vk::CompareOp::eLess;
+
+  vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+  bool sampleShading = false;
+  float minSampleShading = 0.0f;
+  /* One per color attachment of the subpass */
+  std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments = {
+      vk::PipelineColorBlendAttachmentState{}.setColorWriteMask(
+          vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)};
+
+  PipelineLayoutDesc layout;
+  RenderPassDesc renderPass;
+
+  bool operator==(const GraphicsPipelineDesc &) const = default;
+  size_t hash() const;
+};
+
+/// A pipeline owned by PipelineRegistry. Compiles in the background; until
+/// it is ready get() hands out the fallback it was requested with, if any.
+class GraphicsPipeline {
+public:
+  GraphicsPipeline(GraphicsPipelineDesc desc, vk::PipelineLayout layout,
+                   std::string name,
+                   std::shared_ptr<GraphicsPipeline> fallback)
+      : desc(std::move(desc)), layout(layout), name(std::move(name)),
+        fallback(std::move(fallback)) {}
+  GraphicsPipeline(const GraphicsPipeline &) = delete;
+  GraphicsPipeline &operator=(const GraphicsPipeline &) = delete;
+  GraphicsPipeline(GraphicsPipeline &&) = delete;
+  GraphicsPipeline &operator=(GraphicsPipeline &&) = delete;
+
+  /* The compiled pipeline, else the fallback's, else a null handle */
+  vk::Pipeline get() const;
+  /* Owned by the registry, valid as soon as the pipeline is requested */
+  vk::PipelineLayout getLayout() const { return layout; }
+  const GraphicsPipelineDesc &getDesc() const { return desc; }
+
+  bool isReady() const { return state.load() == State::Ready; }
+  /* Blocks until compilation finished, rethrows if it failed */
+  void wait() const;
+
+private:
+  friend class PipelineRegistry;
+  enum class State : uint8_t { Pending, Ready, Failed };
+
+  void compile();
+
+  GraphicsPipelineDesc desc;
+  vk::PipelineLayout layout;
+  std::string name;
+  std::shared_ptr<GraphicsPipeline> fallback;
+
+  /* Written once before state leaves Pending */
+  vk::UniquePipeline pipeline;
+  std::exception_ptr error;
+  std::atomic<State> state = State::Pending;
+};
+
+/// Deduplicates graphics pipelines by their full description and compiles
+/// each unique one exactly once on its own worker threads, so a level load
+/// can request hundreds of materials up front and keep going while they
+/// compile in parallel. Compiles go through Context::pipelineCache.
+///
+/// Descriptions are keyed by content rather than by handles, which callers
+/// may destroy and the driver may hand out again for something else. Shader
+/// modules are created from the SPIR-V for each compile and pipeline layouts
+/// are owned here; only the render pass has to stay alive until the
+/// pipeline is ready.
+class PipelineRegistry {
+public:
+  PipelineRegistry() = default;
+  PipelineRegistry(const PipelineRegistry &) = delete;
+  PipelineRegistry &operator=(const PipelineRegistry &) = delete;
+  PipelineRegistry(PipelineRegistry &&) = delete;
+  PipelineRegistry &operator=(PipelineRegistry &&) = delete;
+
+  /* 0 starts one compile thread per two hardware threads, leaving the rest
+   * to Context::workers */
+  void init(uint32_t threadCount = 0);
+
+  /* Returns the shared pipeline for desc, queuing its compilation the first
+   * time desc is seen. fallback is what get() returns meanwhile, typically a
+   * simpler pipeline that is already ready. */
+  std::shared_ptr<GraphicsPipeline>
+  request(const GraphicsPipelineDesc &desc, const char *name = "unnamed",
+          std::shared_ptr<GraphicsPipeline> fallback = nullptr);
+
+  /* request() then wait() */
+  std::shared_ptr<GraphicsPipeline> get(const GraphicsPipelineDesc &desc,
+                                        const char *name = "unnamed");
+
+  /* The shared layout for desc, created the first time desc is seen */
+  vk::PipelineLayout getLayout(const PipelineLayoutDesc &desc);
+
+  /* Blocks until every queued compilation is done */
+  void waitIdle() const;
+
+  size_t getRequestCount() const { return requests; }
+  size_t getUniqueCount() const;
+
+private:
+  struct DescHash {
+    template <typename Desc> size_t operator()(const Desc &desc) const {
+      return desc.hash();
+    }
+  };
+
+  /* Callers hold mutex */
+  vk::PipelineLayout getLayoutLocked(const PipelineLayoutDesc &desc);
+
+  std::unordered_map<PipelineLayoutDesc, vk::UniquePipelineLayout, DescHash>
+      layouts;
+  std::unordered_map<GraphicsPipelineDesc, std::shared_ptr<GraphicsPipeline>,
+                     DescHash>
+      pipelines;
+  mutable std::mutex mutex;
+  std::atomic<size_t> requests = 0;
+  std::atomic<size_t> pending = 0;
+
+  /* Declared last so queued compiles finish before the pipelines go */
+  ThreadPool compiler;
+};
+} // namespace Vulking
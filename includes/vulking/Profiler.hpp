@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Logging.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifndef VULKING_PROFILE
+// Set by CMakeLists.txt with -DVULKING_PROFILE=ON
+#define VULKING_PROFILE 0
+#endif
+
+namespace Vulking {
+/// Where a zone was opened. One static constexpr instance per PROFILE_ZONE,
+/// so an event only has to carry a pointer to it.
+struct ZoneSite {
+  const char *name;
+  /* COMPTIME_PREFIX, padded with spaces like the log prefix */
+  const char *location;
+};
+
+/// CPU zone profiler behind the PROFILE_* macros.
+///
+/// Every thread appends to its own buffer, chunks of events that are
+/// allocated as needed and never move, and publishes the count with a release
+/// store. Recording never takes a lock; only a thread's first event registers
+/// its buffer. Buffers outlive their threads so the trace can be written at
+/// any point, including after worker threads have exited.
+///
+/// The macros compile to nothing unless VULKING_PROFILE is set.
+class Profiler {
+public:
+  static constexpr bool ENABLED = VULKING_PROFILE;
+  static constexpr size_t EVENTS_PER_CHUNK = 4096;
+  /* About a million events per thread, further events are counted and
+   * dropped */
+  static constexpr size_t MAX_CHUNKS_PER_THREAD = 256;
+
+  /* ns since the profiler started */
+  static uint64_t now();
+  static void record(const ZoneSite *site, uint64_t begin, uint64_t end);
+  /* Called by Context::beginRender */
+  static void markFrame(uint64_t frame);
+  static void setThreadName(const std::string &name);
+
+  /* Chrome trace event JSON, loadable in chrome://tracing and Perfetto.
+   * Frame markers also become "frame" zones spanning from one to the next. */
+  static void writeChromeTrace(const std::string &path);
+  static uint64_t getDroppedEvents();
+
+  /* text as the inside of a JSON string, for trace writers */
+  static std::string escapeJson(std::string_view text);
+};
+
+class ScopedZone {
+public:
+  explicit ScopedZone(const ZoneSite *site)
+      : site(site), begin(Profiler::now()) {}
+  ScopedZone(const ScopedZone &) = delete;
+  ScopedZone &operator=(const ScopedZone &) = delete;
+  ~ScopedZone() { Profiler::record(site, begin, Profiler::now()); }
+
+private:
+  const ZoneSite *site;
+  uint64_t begin;
+};
+} // namespace Vulking
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if VULKING_PROFILE
+#define PROFILE_ZONE(name)                                                     \
+  static constexpr auto PROFILE_CONCAT(_zonePrefix, __LINE__) =                \
+      COMPTIME_PREFIX(__FILE__, __LINE__);                                     \
+  static constexpr Vulking::ZoneSite PROFILE_CONCAT(_zoneSite, __LINE__){      \
+      name, PROFILE_CONCAT(_zonePrefix, __LINE__).c_str()};                    \
+  Vulking::ScopedZone PROFILE_CONCAT(_zone, __LINE__)(                         \
+      &PROFILE_CONCAT(_zoneSite, __LINE__))
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_FRAME_MARK(frame) Vulking::Profiler::markFrame(frame)
+#define PROFILE_THREAD_NAME(name) Vulking::Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_FRAME_MARK(frame)
+#define PROFILE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Allocator.hpp"
+#include "Common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+
+namespace Vulking {
+/// A piece of the staging ring to write upload data into. Valid until the
+/// fence returned by committing its scope has signaled.
+struct StagingSlice {
+  vk::Buffer buffer;
+  vk::DeviceSize offset;
+  vk::DeviceSize size;
+  void *pData;
+};
+
+/// Persistently mapped, host coherent ring buffer that all uploads copy their
+/// data through, instead of creating, mapping and destroying a staging buffer
+/// per asset.
+///
+/// Slices are allocated on behalf of a scope, one per independent submitter
+/// (an UploadBatch, the AsyncUploader, ...). commit(scope) returns a fence
+/// that the caller must signal with the submit that reads that scope's
+/// slices; they are recycled once it has. Scope 0 is shared by code that
+/// allocates and submits right away.
+///
+/// When the ring is full behind another scope's uncommitted slices, allocate
+/// waits for that scope to commit. Only when they are the caller's own, or
+/// both are scope 0, waiting could never end and it throws instead.
+class StagingRing {
+public:
+  using Scope = uint64_t;
+
+  static constexpr vk::DeviceSize DEFAULT_SIZE = 64ull * 1024 * 1024;
+  static constexpr vk::DeviceSize DEFAULT_ALIGNMENT = 16;
+
+  StagingRing() = default;
+  StagingRing(const StagingRing &) = delete;
+  StagingRing &operator=(const StagingRing &) = delete;
+  StagingRing(StagingRing &&) = delete;
+  StagingRing &operator=(StagingRing &&) = delete;
+
+  void init(vk::DeviceSize size = DEFAULT_SIZE);
+
+  Scope openScope();
+
+  StagingSlice allocate(vk::DeviceSize size, Scope scope = 0,
+                        vk::DeviceSize alignment = DEFAULT_ALIGNMENT);
+  /* Copies size bytes of src into a fresh slice */
+  StagingSlice upload(const void *src, vk::DeviceSize size, Scope scope = 0,
+                      vk::DeviceSize alignment = DEFAULT_ALIGNMENT);
+
+  vk::Fence commit(Scope scope = 0);
+
+  vk::DeviceSize getCapacity() const { return capacity; }
+  vk::DeviceSize getUsed() const { return used; }
+
+private:
+  struct Fence {
+    vk::UniqueFence fence;
+    /* spans and oversized buffers waiting on this fence */
+    uint32_t refs = 0;
+    bool committed = false;
+  };
+
+  /* A contiguous run of the ring owned by one scope, including alignment and
+   * wrap-around padding */
+  struct Span {
+    vk::DeviceSize begin;
+    vk::DeviceSize bytes;
+    Scope scope;
+    Fence *fence = nullptr;
+  };
+
+  /* Requests larger than the ring get their own buffer, kept alive until the
+   * scope's fence signals */
+  struct Oversized {
+    Allocation memory;
+    vk::UniqueBuffer buffer;
+    Scope scope;
+    Fence *fence = nullptr;
+  };
+
+  std::optional<vk::DeviceSize> tryAllocate(vk::DeviceSize size,
+                                            vk::DeviceSize alignment,
+                                            Scope scope);
+  StagingSlice allocateOversized(vk::DeviceSize size, Scope scope);
+  void retire(bool wait);
+  bool isSignaled(const Fence &fence) const;
+  Fence &acquireFence();
+
+  Allocation memory;
+  vk::UniqueBuffer buffer;
+  char *pData = nullptr;
+  vk::DeviceSize capacity = 0;
+
+  std::mutex mutex;
+  /* Notified by commit, allocate waits on it for other scopes' spans */
+  std::condition_variable committed;
+  Scope nextScope = 1;
+  /* bytes in live spans */
+  vk::DeviceSize used = 0;
+  vk::DeviceSize head = 0;
+  /* oldest first */
+  std::deque<Span> spans;
+  std::vector<Oversized> oversized;
+  /* list for stable addresses */
+  std::list<Fence> fences;
+};
+} // namespace Vulking
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Vulking {
+/// Fixed set of worker threads for fanning CPU work out across cores.
+///
+/// Each worker has a stable index in [0, getThreadCount()), which lets callers
+/// keep per-thread state (command pools, scratch memory, ...) in a plain
+/// vector without locking.
+class ThreadPool {
+public:
+  using RangeFn =
+      std::function<void(size_t begin, size_t end, uint32_t worker)>;
+
+  ThreadPool() = default;
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+  ~ThreadPool();
+
+  /* 0 starts one worker per hardware thread */
+  void init(uint32_t threadCount = 0);
+
+  uint32_t getThreadCount() const {
+    return static_cast<uint32_t>(threads.size());
+  }
+
+  /* Splits [0, count) into at most getThreadCount() contiguous chunks of at
+   * least minChunk items and runs fn on each from the workers. Blocks until
+   * every chunk is done and rethrows the first exception one threw.
+   *
+   * Called from one of this pool's workers, e.g. by a submitted job, it runs
+   * the same chunks one after another on that worker instead, as waiting
+   * there could leave every worker waiting on chunks nobody is free to run. */
+  void parallelFor(size_t count, size_t minChunk, const RangeFn &fn);
+
+  /* Queues fn to run on a worker and returns right away. fn has to handle
+   * its own exceptions. Jobs still queued when the pool is destroyed run
+   * before it returns. */
+  void submit(std::function<void(uint32_t worker)> fn);
+
+  /* Whether the calling thread is one of this pool's workers */
+  bool isWorker() const;
+
+  /* Number of chunks parallelFor(count, minChunk, ...) splits into */
+  size_t getChunkCount(size_t count, size_t minChunk) const;
+
+private:
+  void run(uint32_t worker);
+
+  std::vector<std::jthread> threads;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::function<void(uint32_t worker)>> jobs;
+  bool stopping = false;
+};
+
+/* Expires once the calling thread has exited. Per thread state keyed by
+ * std::thread::id holds on to one to tell which entries can be pruned, ids
+ * of exited threads may be reused. */
+std::weak_ptr<const void> getThreadLifetime();
+} // namespace Vulking
@@ -1,12 +1,34 @@
 #pragma once
 
+#include "Allocator.hpp"
+#include "AsyncUploader.hpp"
+#include "BindlessTable.hpp"
 #include "Buffer.hpp"
 #include "Common.hpp"
 #include "Constants.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DescriptorTemplate.hpp"
 #include "Engine.hpp"
+#include "FrameAllocator.hpp"
+#include "GeometryPool.hpp"
+#include "GpuProfiler.hpp"
 #include "Image.hpp"
+#include "MappedFile.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "ObjParser.hpp"
+#include "ParallelRecorder.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineRegistry.hpp"
+#include "Profiler.hpp"
+#include "ShaderLibrary.hpp"
+#include "ShaderVariants.hpp"
+#include "StagingRing.hpp"
+#include "ThreadPool.hpp"
 #include "Util.hpp"
+#include "VertexLayout.hpp"
 #include "Functions.hpp"
 #include "UniqueSurface.hpp"
+#include "UploadBatch.hpp"
 #include "Context.hpp"
@@ -0,0 +1,324 @@
+#include "Allocator.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Vulking {
+RangeAllocator::RangeAllocator(vk::DeviceSize size) : size(size) {
+  insertFree(0, size);
+}
+
+std::optional<vk::DeviceSize> RangeAllocator::allocate(vk::DeviceSize size,
+                                                       vk::DeviceSize alignment) {
+  assert(size != 0);
+  // Smallest free range that could hold the request, then walk up until the
+  // alignment padding fits too.
+  for (auto it = freeBySize.lower_bound(size); it != freeBySize.end(); ++it) {
+    const auto [rangeSize, rangeOffset] = *it;
+    const auto alignedOffset = alignUp(rangeOffset, alignment);
+    const auto padding = alignedOffset - rangeOffset;
+    if (padding + size > rangeSize) {
+      continue;
+    }
+
+    eraseFree(freeByOffset.find(rangeOffset));
+    if (padding != 0) {
+      insertFree(rangeOffset, padding);
+    }
+    const auto tail = rangeSize - padding - size;
+    if (tail != 0) {
+      insertFree(alignedOffset + size, tail);
+    }
+
+    allocated[alignedOffset] = Range{.offset = alignedOffset, .size = size};
+    used += size;
+    return alignedOffset;
+  }
+
+  return std::nullopt;
+}
+
+void RangeAllocator::free(vk::DeviceSize offset) {
+  const auto it = allocated.find(offset);
+  if (it == allocated.end()) {
+    throw std::invalid_argument(
+        std::format("offset {} was not allocated from this range", offset));
+  }
+  auto [freeOffset, freeSize] = it->second;
+  allocated.erase(it);
+  used -= freeSize;
+
+  // Coalesce with the free neighbour after us...
+  auto next = freeByOffset.find(freeOffset + freeSize);
+  if (next != freeByOffset.end()) {
+    freeSize += next->second;
+    eraseFree(next);
+  }
+
+  // ...and the one before us
+  auto after = freeByOffset.lower_bound(freeOffset);
+  if (after != freeByOffset.begin()) {
+    auto prev = std::prev(after);
+    if (prev->first + prev->second == freeOffset) {
+      freeOffset = prev->first;
+      freeSize += prev->second;
+      eraseFree(prev);
+    }
+  }
+
+  insertFree(freeOffset, freeSize);
+}
+
+vk::DeviceSize RangeAllocator::getLargestFree() const {
+  return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFree(vk::DeviceSize offset, vk::DeviceSize size) {
+  freeByOffset.emplace(offset, size);
+  freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(
+    std::map<vk::DeviceSize, vk::DeviceSize>::iterator it) {
+  assert(it != freeByOffset.end());
+  auto [first, last] = freeBySize.equal_range(it->second);
+  for (auto bySize = first; bySize != last; ++bySize) {
+    if (bySize->second == it->first) {
+      freeBySize.erase(bySize);
+      break;
+    }
+  }
+  freeByOffset.erase(it);
+}
+
+void Allocation::reset() {
+  if (allocator) {
+    allocator->free(*this);
+  }
+}
+
+Allocator::~Allocator() { destroy(); }
+
+void Allocator::init(vk::PhysicalDevice physicalDevice, vk::Device device,
+                     vk::DeviceSize blockSize) {
+  this->physicalDevice = physicalDevice;
+  this->device = device;
+  this->blockSize = blockSize;
+  memoryProperties = physicalDevice.getMemoryProperties();
+}
+
+void Allocator::destroy() {
+  std::lock_guard lock(mutex);
+  for (auto &block : blocks) {
+    if (!block->ranges.isEmpty()) {
+      LOG_WARNING("destroying memory block with "
+                  << block->ranges.getAllocationCount()
+                  << " live allocations");
+    }
+    device.freeMemory(block->memory, ALLOCATOR);
+  }
+  blocks.clear();
+}
+
+Allocation Allocator::allocate(vk::Buffer buffer,
+                               vk::MemoryPropertyFlags properties,
+                               const char *name) {
+  const auto chain =
+      device.getBufferMemoryRequirements2<vk::MemoryRequirements2,
+                                          vk::MemoryDedicatedRequirements>(
+          vk::BufferMemoryRequirementsInfo2{}.setBuffer(buffer));
+  const auto &dedicated = chain.get<vk::MemoryDedicatedRequirements>();
+  return allocate(chain.get<vk::MemoryRequirements2>().memoryRequirements,
+                  properties, true,
+                  dedicated.prefersDedicatedAllocation ||
+                      dedicated.requiresDedicatedAllocation,
+                  buffer, nullptr, name);
+}
+
+Allocation Allocator::allocate(vk::Image image, vk::ImageTiling tiling,
+                               vk::MemoryPropertyFlags properties,
+                               const char *name) {
+  const auto chain =
+      device.getImageMemoryRequirements2<vk::MemoryRequirements2,
+                                         vk::MemoryDedicatedRequirements>(
+          vk::ImageMemoryRequirementsInfo2{}.setImage(image));
+  const auto &dedicated = chain.get<vk::MemoryDedicatedRequirements>();
+  return allocate(chain.get<vk::MemoryRequirements2>().memoryRequirements,
+                  properties, tiling == vk::ImageTiling::eLinear,
+                  dedicated.prefersDedicatedAllocation ||
+                      dedicated.requiresDedicatedAllocation,
+                  nullptr, image, name);
+}
+
+Allocation Allocator::allocate(const vk::MemoryRequirements &requirements,
+                               vk::MemoryPropertyFlags properties, bool linear,
+                               bool dedicated, vk::Buffer buffer,
+                               vk::Image image, const char *name) {
+  const auto memoryTypeIndex =
+      findMemoryType(physicalDevice, requirements.memoryTypeBits, properties);
+
+  std::lock_guard lock(mutex);
+
+  if (dedicated || requirements.size > getBlockSize(memoryTypeIndex) / 2) {
+    return allocateDedicated(requirements, memoryTypeIndex, buffer, image,
+                             name);
+  }
+
+  auto place = [&](MemoryBlock &block) -> std::optional<Allocation> {
+    const auto offset =
+        block.ranges.allocate(requirements.size, requirements.alignment);
+    if (!offset) {
+      return std::nullopt;
+    }
+    Allocation allocation;
+    allocation.allocator = this;
+    allocation.block = &block;
+    allocation.memory = block.memory;
+    allocation.offset = offset.value();
+    allocation.size = requirements.size;
+    if (block.pMapped) {
+      allocation.pMapped = static_cast<char *>(block.pMapped) + offset.value();
+    }
+    return allocation;
+  };
+
+  for (auto &block : blocks) {
+    if (block->memoryTypeIndex != memoryTypeIndex || block->linear != linear) {
+      continue;
+    }
+    if (auto allocation = place(*block)) {
+      return std::move(allocation.value());
+    }
+  }
+
+  auto allocation =
+      place(createBlock(memoryTypeIndex, linear, requirements.size));
+  assert(allocation);
+  return std::move(allocation.value());
+}
+
+Allocation Allocator::allocateDedicated(
+    const vk::MemoryRequirements &requirements, uint32_t memoryTypeIndex,
+    vk::Buffer buffer, vk::Image image, const char *name) {
+  const auto dedicatedInfo =
+      vk::MemoryDedicatedAllocateInfo{}.setBuffer(buffer).setImage(image);
+  const auto allocInfo = vk::MemoryAllocateInfo{}
+                             .setAllocationSize(requirements.size)
+                             .setMemoryTypeIndex(memoryTypeIndex)
+                             .setPNext(&dedicatedInfo);
+
+  Allocation allocation;
+  allocation.allocator = this;
+  allocation.memory = device.allocateMemory(allocInfo, ALLOCATOR);
+  allocation.offset = 0;
+  allocation.size = requirements.size;
+  if (isHostVisible(memoryTypeIndex)) {
+    allocation.pMapped =
+        device.mapMemory(allocation.memory, 0, vk::WholeSize);
+  }
+  NAME_OBJECT(Engine::ctx().device, allocation.memory,
+              std::format("{}_dedicated_memory", name));
+
+  dedicatedCount++;
+  dedicatedBytes += requirements.size;
+  LOG_DEBUG("dedicated allocation: " << name << " (" << requirements.size
+                                     << " bytes)");
+  return allocation;
+}
+
+void Allocator::free(Allocation &allocation) {
+  assert(allocation.allocator == this);
+  {
+    std::lock_guard lock(mutex);
+    if (allocation.block) {
+      allocation.block->ranges.free(allocation.offset);
+    } else {
+      // Freeing memory implicitly unmaps it
+      device.freeMemory(allocation.memory, ALLOCATOR);
+      dedicatedCount--;
+      dedicatedBytes -= allocation.size;
+    }
+  }
+
+  allocation.allocator = nullptr;
+  allocation.block = nullptr;
+  allocation.memory = nullptr;
+  allocation.pMapped = nullptr;
+}
+
+MemoryBlock &Allocator::createBlock(uint32_t memoryTypeIndex, bool linear,
+                                    vk::DeviceSize minSize) {
+  const auto size = std::max(getBlockSize(memoryTypeIndex), minSize);
+  auto block = std::make_unique<MemoryBlock>();
+  block->memoryTypeIndex = memoryTypeIndex;
+  block->linear = linear;
+  block->memory = device.allocateMemory(vk::MemoryAllocateInfo{}
+                                            .setAllocationSize(size)
+                                            .setMemoryTypeIndex(memoryTypeIndex),
+                                        ALLOCATOR);
+  if (isHostVisible(memoryTypeIndex)) {
+    block->pMapped = device.mapMemory(block->memory, 0, vk::WholeSize);
+  }
+  block->ranges = RangeAllocator(size);
+  NAME_OBJECT(Engine::ctx().device, block->memory,
+              std::format("allocator_block_{}", blocks.size()));
+
+  LOG_DEBUG("allocated memory block " << blocks.size() << ": type "
+                                      << memoryTypeIndex << ", " << size
+                                      << " bytes, "
+                                      << (linear ? "linear" : "optimal"));
+  blocks.push_back(std::move(block));
+  return *blocks.back();
+}
+
+bool Allocator::isHostVisible(uint32_t memoryTypeIndex) const {
+  return static_cast<bool>(
+      memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+      vk::MemoryPropertyFlagBits::eHostVisible);
+}
+
+vk::DeviceSize Allocator::getBlockSize(uint32_t memoryTypeIndex) const {
+  const auto heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  const auto heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+  // Small heaps (e.g. the 256MB host visible device local one) shouldn't be
+  // eaten by a single block
+  return std::min(blockSize, heapSize / 8);
+}
+
+AllocatorStats Allocator::getStats() const {
+  std::lock_guard lock(mutex);
+  AllocatorStats stats{};
+  stats.blockCount = blocks.size();
+  stats.dedicatedAllocationCount = dedicatedCount;
+  stats.allocationCount = dedicatedCount;
+  stats.bytesAllocated = dedicatedBytes;
+  stats.bytesInUse = dedicatedBytes;
+
+  vk::DeviceSize totalFree = 0;
+  vk::DeviceSize largestFree = 0;
+  for (const auto &block : blocks) {
+    const auto &ranges = block->ranges;
+    stats.allocationCount += ranges.getAllocationCount();
+    stats.bytesAllocated += ranges.getSize();
+    stats.bytesInUse += ranges.getUsed();
+    totalFree += ranges.getSize() - ranges.getUsed();
+    largestFree = std::max(largestFree, ranges.getLargestFree());
+  }
+  if (totalFree != 0) {
+    stats.fragmentation =
+        1.0f - static_cast<float>(largestFree) / static_cast<float>(totalFree);
+  }
+  return stats;
+}
+
+void Allocator::logStats() const {
+  const auto stats = getStats();
+  LOG_INFO("allocator: " << stats.blockCount << " blocks, "
+                         << stats.dedicatedAllocationCount << " dedicated, "
+                         << stats.allocationCount << " allocations, "
+                         << stats.bytesInUse << "/" << stats.bytesAllocated
+                         << " bytes in use, fragmentation "
+                         << stats.fragmentation);
+}
+} // namespace Vulking
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace Vulking {
+/// Manages the free ranges of a single [0, size) region. Used by Allocator to
+/// carve sub-allocations out of a block of device memory, but knows nothing
+/// about Vulkan itself so it can be tested on its own.
+///
+/// Best-fit over a size-ordered index of free ranges, with neighbouring free
+/// ranges coalesced on free.
+class RangeAllocator {
+public:
+  RangeAllocator() = default;
+  explicit RangeAllocator(vk::DeviceSize size);
+
+  /* Returns the aligned offset of the new range, or nullopt if nothing fits */
+  std::optional<vk::DeviceSize> allocate(vk::DeviceSize size,
+                                         vk::DeviceSize alignment);
+  void free(vk::DeviceSize offset);
+
+  vk::DeviceSize getSize() const { return size; }
+  vk::DeviceSize getUsed() const { return used; }
+  vk::DeviceSize getLargestFree() const;
+  size_t getAllocationCount() const { return allocated.size(); }
+  size_t getFreeRangeCount() const { return freeByOffset.size(); }
+  bool isEmpty() const { return allocated.empty(); }
+
+private:
+  void insertFree(vk::DeviceSize offset, vk::DeviceSize size);
+  void eraseFree(std::map<vk::DeviceSize, vk::DeviceSize>::iterator it);
+
+  struct Range {
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+  };
+
+  vk::DeviceSize size = 0;
+  vk::DeviceSize used = 0;
+  /* offset -> size */
+  std::map<vk::DeviceSize, vk::DeviceSize> freeByOffset;
+  /* size -> offset */
+  std::multimap<vk::DeviceSize, vk::DeviceSize> freeBySize;
+  /* aligned offset handed out -> range actually taken (including padding) */
+  std::unordered_map<vk::DeviceSize, Range> allocated;
+};
+
+class Allocator;
+struct MemoryBlock;
+
+/// A piece of device memory handed out by Allocator. Returns itself to the
+/// allocator when destroyed, so it can be held like a vk::UniqueDeviceMemory.
+class Allocation {
+public:
+  Allocation() = default;
+  Allocation(const Allocation &) = delete;
+  Allocation &operator=(const Allocation &) = delete;
+  Allocation(Allocation &&other) noexcept { *this = std::move(other); }
+  Allocation &operator=(Allocation &&other) noexcept {
+    if (this != &other) {
+      reset();
+      allocator = other.allocator;
+      block = other.block;
+      memory = other.memory;
+      offset = other.offset;
+      size = other.size;
+      pMapped = other.pMapped;
+      other.allocator = nullptr;
+      other.block = nullptr;
+      other.memory = nullptr;
+      other.pMapped = nullptr;
+    }
+    return *this;
+  }
+  ~Allocation() { reset(); }
+
+  void reset();
+
+  vk::DeviceMemory getMemory() const { return memory; }
+  vk::DeviceSize getOffset() const { return offset; }
+  vk::DeviceSize getSize() const { return size; }
+  /* Host pointer to the start of this allocation, null if not host visible */
+  void *getMappedData() const { return pMapped; }
+  bool isDedicated() const { return block == nullptr; }
+
+  explicit operator bool() const { return memory != nullptr; }
+
+private:
+  friend class Allocator;
+
+  Allocator *allocator = nullptr;
+  /* null for dedicated allocations */
+  MemoryBlock *block = nullptr;
+  vk::DeviceMemory memory;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+  void *pMapped = nullptr;
+};
+
+struct MemoryBlock {
+  vk::DeviceMemory memory;
+  uint32_t memoryTypeIndex;
+  bool linear;
+  void *pMapped = nullptr;
+  RangeAllocator ranges;
+};
+
+struct AllocatorStats {
+  size_t blockCount = 0;
+  size_t dedicatedAllocationCount = 0;
+  size_t allocationCount = 0;
+  /* total VkDeviceMemory allocated, blocks and dedicated allocations */
+  vk::DeviceSize bytesAllocated = 0;
+  vk::DeviceSize bytesInUse = 0;
+  /* 1 - largest free range / total free, over all blocks. 0 is unfragmented */
+  float fragmentation = 0.0f;
+};
+
+/// Engine-owned device memory allocator. Buffers and images are placed in
+/// large per-memory-type blocks instead of getting a VkDeviceMemory each,
+/// which keeps us far away from maxMemoryAllocationCount.
+///
+/// Linear resources (buffers, linear images) and optimal images never share a
+/// block, so bufferImageGranularity can't bite. Resources the driver wants a
+/// dedicated allocation for, or that are too large for a block, get one.
+///
+/// Host visible blocks are mapped once when created and stay mapped.
+class Allocator {
+public:
+  static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  Allocator() = default;
+  Allocator(const Allocator &) = delete;
+  Allocator &operator=(const Allocator &) = delete;
+  Allocator(Allocator &&) = delete;
+  Allocator &operator=(Allocator &&) = delete;
+  ~Allocator();
+
+  void init(vk::PhysicalDevice physicalDevice, vk::Device device,
+            vk::DeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+  void destroy();
+
+  Allocation allocate(vk::Buffer buffer, vk::MemoryPropertyFlags properties,
+                      const char *name = "unnamed");
+  Allocation allocate(vk::Image image, vk::ImageTiling tiling,
+                      vk::MemoryPropertyFlags properties,
+                      const char *name = "unnamed");
+
+  void free(Allocation &allocation);
+
+  AllocatorStats getStats() const;
+  void logStats() const;
+
+private:
+  Allocation allocate(const vk::MemoryRequirements &requirements,
+                      vk::MemoryPropertyFlags properties, bool linear,
+                      bool dedicated, vk::Buffer buffer, vk::Image image,
+                      const char *name);
+  Allocation allocateDedicated(const vk::MemoryRequirements &requirements,
+                               uint32_t memoryTypeIndex, vk::Buffer buffer,
+                               vk::Image image, const char *name);
+  MemoryBlock &createBlock(uint32_t memoryTypeIndex, bool linear,
+                           vk::DeviceSize minSize);
+  bool isHostVisible(uint32_t memoryTypeIndex) const;
+  vk::DeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+
+  vk::PhysicalDevice physicalDevice;
+  vk::Device device;
+  vk::PhysicalDeviceMemoryProperties memoryProperties;
+  vk::DeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+
+  mutable std::mutex mutex;
+  std::vector<std::unique_ptr<MemoryBlock>> blocks;
+  size_t dedicatedCount = 0;
+  vk::DeviceSize dedicatedBytes = 0;
+};
+} // namespace Vulking
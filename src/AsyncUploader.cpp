@@ -0,0 +1,306 @@
+#include "AsyncUploader.hpp"
+
+#include "Engine.hpp"
+#include "Functions.hpp"
+
+#include <algorithm>
+
+namespace Vulking {
+void AsyncUploader::init() {
+  auto &ctx = Engine::ctx();
+  transferFamily = ctx.transferQueueFamily;
+  graphicsFamily = ctx.graphicsQueueFamily;
+  queue = ctx.transferQueue;
+  dedicated = transferFamily != graphicsFamily;
+  stagingScope = ctx.staging.openScope();
+
+  commandPool = ctx.device->createCommandPoolUnique(
+      vk::CommandPoolCreateInfo{}
+          .setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+          .setQueueFamilyIndex(transferFamily));
+  NAME_OBJECT(ctx.device, commandPool.get(), "async_upload_command_pool");
+
+  auto typeInfo = vk::SemaphoreTypeCreateInfo{}
+                      .setSemaphoreType(vk::SemaphoreType::eTimeline)
+                      .setInitialValue(0);
+  timeline = ctx.device->createSemaphoreUnique(
+      vk::SemaphoreCreateInfo{}.setPNext(&typeInfo));
+  NAME_OBJECT(ctx.device, timeline.get(), "async_upload_timeline");
+
+  LOG_INFO("async uploads on queue family "
+           << transferFamily << (dedicated ? " (dedicated transfer)" : ""));
+}
+
+UploadTicket AsyncUploader::uploadBuffer(const void *src, vk::DeviceSize size,
+                                         vk::Buffer dst,
+                                         vk::DeviceSize dstOffset,
+                                         vk::PipelineStageFlags2 dstStage,
+                                         vk::AccessFlags2 dstAccess) {
+  std::lock_guard lock(mutex);
+  collect();
+
+  const auto staging = Engine::ctx().staging.upload(src, size, stagingScope);
+  auto cmd = begin("async_buffer_upload");
+  cmd->copyBuffer(staging.buffer, dst,
+                  vk::BufferCopy()
+                      .setSrcOffset(staging.offset)
+                      .setDstOffset(dstOffset)
+                      .setSize(size));
+
+  auto barrier = vk::BufferMemoryBarrier2KHR{}
+                     .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setBuffer(dst)
+                     .setOffset(dstOffset)
+                     .setSize(size);
+
+  if (dedicated) {
+    auto release = barrier;
+    release.setSrcQueueFamilyIndex(transferFamily)
+        .setDstQueueFamilyIndex(graphicsFamily)
+        .setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+        .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite);
+    cmd->pipelineBarrier2KHR(
+        vk::DependencyInfoKHR{}.setBufferMemoryBarriers({release}),
+        DYNAMIC_DISPATCHER);
+
+    // The release already made the writes available
+    barrier.setSrcQueueFamilyIndex(transferFamily)
+        .setDstQueueFamilyIndex(graphicsFamily);
+  } else {
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+        .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite);
+  }
+  barrier.setDstStageMask(dstStage).setDstAccessMask(dstAccess);
+
+  auto acquire = [barrier](vk::CommandBuffer cmd) {
+    cmd.pipelineBarrier2KHR(
+        vk::DependencyInfoKHR{}.setBufferMemoryBarriers({barrier}),
+        DYNAMIC_DISPATCHER);
+  };
+  return submit(std::move(cmd), getVulkanHandle(dst), std::move(acquire));
+}
+
+UploadTicket AsyncUploader::uploadImage(const void *src, vk::DeviceSize size,
+                                        vk::Image image, vk::Format format,
+                                        uint32_t width, uint32_t height,
+                                        uint32_t mipLevels) {
+  std::lock_guard lock(mutex);
+  collect();
+
+  const auto staging = Engine::ctx().staging.upload(src, size, stagingScope);
+  auto cmd = begin("async_image_upload");
+
+  const auto range = vk::ImageSubresourceRange()
+                         .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                         .setLevelCount(mipLevels)
+                         .setLayerCount(1);
+  auto barrier = vk::ImageMemoryBarrier2KHR()
+                     .setOldLayout(vk::ImageLayout::eUndefined)
+                     .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                     .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setImage(image)
+                     .setSubresourceRange(range)
+                     .setSrcStageMask(vk::PipelineStageFlagBits2::eTopOfPipe)
+                     .setSrcAccessMask(vk::AccessFlagBits2::eNone)
+                     .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer)
+                     .setDstAccessMask(vk::AccessFlagBits2::eTransferWrite);
+  cmd->pipelineBarrier2KHR(
+      vk::DependencyInfoKHR().setImageMemoryBarriers({barrier}),
+      DYNAMIC_DISPATCHER);
+
+  cmd->copyBufferToImage(
+      staging.buffer, image, vk::ImageLayout::eTransferDstOptimal,
+      vk::BufferImageCopy()
+          .setBufferOffset(staging.offset)
+          .setImageSubresource(
+              vk::ImageSubresourceLayers()
+                  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                  .setLayerCount(1))
+          .setImageExtent({width, height, 1}));
+
+  // Mips are blitted on the graphics queue, so the image crosses over still
+  // in eTransferDstOptimal
+  barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+      .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+      .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer)
+      .setDstAccessMask(vk::AccessFlagBits2::eTransferRead |
+                        vk::AccessFlagBits2::eTransferWrite);
+
+  if (dedicated) {
+    auto release = barrier;
+    release.setSrcQueueFamilyIndex(transferFamily)
+        .setDstQueueFamilyIndex(graphicsFamily)
+        .setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+        .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+        .setDstStageMask(vk::PipelineStageFlagBits2::eNone)
+        .setDstAccessMask(vk::AccessFlagBits2::eNone);
+    cmd->pipelineBarrier2KHR(
+        vk::DependencyInfoKHR().setImageMemoryBarriers({release}),
+        DYNAMIC_DISPATCHER);
+
+    barrier.setSrcQueueFamilyIndex(transferFamily)
+        .setDstQueueFamilyIndex(graphicsFamily)
+        .setSrcStageMask(vk::PipelineStageFlagBits2::eNone)
+        .setSrcAccessMask(vk::AccessFlagBits2::eNone);
+  } else {
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+        .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite);
+  }
+
+  auto acquire = [=](vk::CommandBuffer cmd) {
+    cmd.pipelineBarrier2KHR(
+        vk::DependencyInfoKHR().setImageMemoryBarriers({barrier}),
+        DYNAMIC_DISPATCHER);
+    recordGenerateMipmaps(cmd, image, format, static_cast<int32_t>(width),
+                          static_cast<int32_t>(height), mipLevels);
+  };
+  return submit(std::move(cmd), getVulkanHandle(image), std::move(acquire));
+}
+
+bool AsyncUploader::isComplete(UploadTicket ticket) const {
+  return getCompletedValue() >= ticket.value;
+}
+
+void AsyncUploader::wait(UploadTicket ticket) const {
+  const auto semaphore = timeline.get();
+  CHK(Engine::ctx().device->waitSemaphores(vk::SemaphoreWaitInfo{}
+                                               .setSemaphores(semaphore)
+                                               .setValues(ticket.value),
+                                           UINT64_MAX),
+      "failed waiting for upload");
+}
+
+bool AsyncUploader::isUsable(UploadTicket ticket) {
+  std::lock_guard lock(mutex);
+  return isUsableLocked(ticket);
+}
+
+void AsyncUploader::waitUsable(UploadTicket ticket) {
+  wait(ticket);
+  auto &ctx = Engine::ctx();
+  std::unique_lock lock(mutex);
+  if (!acquires.empty() && acquires.front().value <= ticket.value) {
+    // No frame has picked it up yet. Everything recorded here has completed,
+    // so unlike a frame the submit needn't wait on the timeline.
+    auto cmd = ctx.beginCommand("async_upload_acquire");
+    const auto value = recordCompleted(cmd);
+    lock.unlock();
+    ctx.endAndSubmitGraphicsCommand(std::move(cmd));
+    markSubmitted(value);
+    return;
+  }
+  // Recorded by a frame that hasn't been submitted yet
+  submitted.wait(lock, [&] { return isUsableLocked(ticket); });
+}
+
+uint64_t AsyncUploader::recordAcquires(vk::CommandBuffer cmd) {
+  std::lock_guard lock(mutex);
+  return recordCompleted(cmd);
+}
+
+void AsyncUploader::markSubmitted(uint64_t value) {
+  {
+    std::lock_guard lock(mutex);
+    std::erase_if(unsubmitted,
+                  [&](const Batch &batch) { return batch.last == value; });
+  }
+  submitted.notify_all();
+}
+
+void AsyncUploader::cancelResource(uint64_t resource) {
+  std::lock_guard lock(mutex);
+  std::erase_if(acquires, [&](const Acquire &acquire) {
+    return acquire.resource == resource;
+  });
+}
+
+uint64_t AsyncUploader::recordCompleted(vk::CommandBuffer cmd) {
+  const auto completed = getCompletedValue();
+  collect();
+
+  uint64_t first = 0;
+  uint64_t last = 0;
+  while (!acquires.empty() && acquires.front().value <= completed) {
+    acquires.front().record(cmd);
+    if (first == 0) {
+      first = acquires.front().value;
+    }
+    last = acquires.front().value;
+    acquires.pop_front();
+  }
+  if (last != 0) {
+    unsubmitted.push_back(Batch{.first = first, .last = last});
+  }
+  return last;
+}
+
+bool AsyncUploader::isUsableLocked(UploadTicket ticket) const {
+  if (ticket.value >= nextValue) {
+    return false;
+  }
+  // Acquires are queued in value order, so anything at or before the ticket
+  // still queued means it hasn't been recorded
+  if (!acquires.empty() && acquires.front().value <= ticket.value) {
+    return false;
+  }
+  return std::ranges::none_of(unsubmitted, [&](const Batch &batch) {
+    return batch.first <= ticket.value && ticket.value <= batch.last;
+  });
+}
+
+vk::UniqueCommandBuffer AsyncUploader::begin(const char *name) {
+  auto cmd = std::move(Engine::ctx()
+                           .device
+                           ->allocateCommandBuffersUnique(
+                               vk::CommandBufferAllocateInfo()
+                                   .setCommandPool(commandPool.get())
+                                   .setLevel(vk::CommandBufferLevel::ePrimary)
+                                   .setCommandBufferCount(1))
+                           .front());
+  NAME_OBJECT(Engine::ctx().device, cmd.get(), name);
+  cmd->begin(vk::CommandBufferBeginInfo{}.setFlags(
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+  return cmd;
+}
+
+UploadTicket
+AsyncUploader::submit(vk::UniqueCommandBuffer cmd, uint64_t resource,
+                      std::function<void(vk::CommandBuffer)> &&acquire) {
+  cmd->end();
+
+  const auto value = nextValue++;
+  const auto semaphore = timeline.get();
+  const auto commandBuffer = cmd.get();
+  auto timelineInfo =
+      vk::TimelineSemaphoreSubmitInfo{}.setSignalSemaphoreValues(value);
+  // Staging slices taken for this upload are recycled by this fence
+  auto &ctx = Engine::ctx();
+  const auto fence = ctx.staging.commit(stagingScope);
+  {
+    std::lock_guard lock(ctx.queueMutex);
+    queue.submit(vk::SubmitInfo{}
+                     .setCommandBuffers(commandBuffer)
+                     .setSignalSemaphores(semaphore)
+                     .setPNext(&timelineInfo),
+                 fence);
+  }
+
+  inFlight.push_back(InFlight{.value = value, .cmd = std::move(cmd)});
+  acquires.push_back(Acquire{
+      .value = value, .resource = resource, .record = std::move(acquire)});
+  return UploadTicket{.value = value};
+}
+
+void AsyncUploader::collect() {
+  const auto completed = getCompletedValue();
+  while (!inFlight.empty() && inFlight.front().value <= completed) {
+    inFlight.pop_front();
+  }
+}
+
+uint64_t AsyncUploader::getCompletedValue() const {
+  return Engine::ctx().device->getSemaphoreCounterValue(timeline.get());
+}
+} // namespace Vulking
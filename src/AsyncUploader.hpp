@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Common.hpp"
+#include "StagingRing.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Vulking {
+/// Handle for an upload submitted through AsyncUploader. Complete once the
+/// transfer queue has signaled its timeline value, usable once the acquire
+/// that hands the resource to the graphics queue has been submitted too.
+struct UploadTicket {
+  uint64_t value = 0;
+};
+
+/// Uploads buffers and images on a dedicated transfer queue when the device
+/// has one, without blocking the calling thread or the graphics queue.
+///
+/// Every upload is one submit that signals a timeline semaphore. When the
+/// transfer queue belongs to another family the upload ends with a queue
+/// family release; the matching acquire (plus anything that needs a graphics
+/// queue, like mip generation) is recorded by Context::endRender in front of
+/// the first frame submitted after the upload completed. Until then the
+/// resource belongs to the transfer queue (and an image has no mips yet), so
+/// wait for isUsable or call waitUsable before using it anywhere else.
+///
+/// Image and Buffer cancel their pending acquires when destroyed, so
+/// dropping a resource before its acquire was recorded is fine.
+class AsyncUploader {
+public:
+  AsyncUploader() = default;
+  AsyncUploader(const AsyncUploader &) = delete;
+  AsyncUploader &operator=(const AsyncUploader &) = delete;
+  AsyncUploader(AsyncUploader &&) = delete;
+  AsyncUploader &operator=(AsyncUploader &&) = delete;
+
+  void init();
+
+  /* dstStage/dstAccess describe how the graphics queue will use dst */
+  UploadTicket uploadBuffer(const void *src, vk::DeviceSize size,
+                            vk::Buffer dst, vk::DeviceSize dstOffset,
+                            vk::PipelineStageFlags2 dstStage,
+                            vk::AccessFlags2 dstAccess);
+
+  /* Uploads mip level 0 of an RGBA8 image and generates the rest. The image
+   * ends up in eShaderReadOnlyOptimal. */
+  UploadTicket uploadImage(const void *src, vk::DeviceSize size,
+                           vk::Image image, vk::Format format, uint32_t width,
+                           uint32_t height, uint32_t mipLevels);
+
+  /* The transfer is done. The resource is still not usable on the graphics
+   * queue, see isUsable. */
+  bool isComplete(UploadTicket ticket) const;
+  void wait(UploadTicket ticket) const;
+  /* The acquire has been submitted on the graphics queue, anything submitted
+   * there afterwards may use the resource */
+  bool isUsable(UploadTicket ticket);
+  /* Waits for the upload and submits its acquire right away unless a frame
+   * already has, for use outside frames such as headless loading or with
+   * beginCommand */
+  void waitUsable(UploadTicket ticket);
+
+  /* Drops pending acquires for a resource about to be destroyed */
+  void cancel(vk::Buffer buffer) { cancelResource(getVulkanHandle(buffer)); }
+  void cancel(vk::Image image) { cancelResource(getVulkanHandle(image)); }
+
+  bool isDedicated() const { return dedicated; }
+  vk::Semaphore getSemaphore() const { return timeline.get(); }
+
+  /* Called by Context on the graphics queue. Records acquires for every
+   * completed upload into cmd and returns the timeline value the submit must
+   * wait on, or 0 if nothing was recorded. */
+  uint64_t recordAcquires(vk::CommandBuffer cmd);
+  /* Called by Context once the command buffer recordAcquires returned value
+   * for has been submitted */
+  void markSubmitted(uint64_t value);
+
+private:
+  struct InFlight {
+    uint64_t value;
+    vk::UniqueCommandBuffer cmd;
+  };
+
+  struct Acquire {
+    uint64_t value;
+    /* The buffer or image it transfers, to cancel it by */
+    uint64_t resource;
+    std::function<void(vk::CommandBuffer)> record;
+  };
+
+  /* Recorded acquires not submitted yet, first and last timeline value */
+  struct Batch {
+    uint64_t first;
+    uint64_t last;
+  };
+
+  vk::UniqueCommandBuffer begin(const char *name);
+  UploadTicket submit(vk::UniqueCommandBuffer cmd, uint64_t resource,
+                      std::function<void(vk::CommandBuffer)> &&acquire);
+  void cancelResource(uint64_t resource);
+  /* Callers hold mutex */
+  uint64_t recordCompleted(vk::CommandBuffer cmd);
+  bool isUsableLocked(UploadTicket ticket) const;
+  void collect();
+  uint64_t getCompletedValue() const;
+
+  bool dedicated = false;
+  uint32_t transferFamily;
+  uint32_t graphicsFamily;
+  vk::Queue queue;
+
+  vk::UniqueCommandPool commandPool;
+  vk::UniqueSemaphore timeline;
+  StagingRing::Scope stagingScope;
+
+  std::mutex mutex;
+  uint64_t nextValue = 1;
+  std::deque<InFlight> inFlight;
+  std::deque<Acquire> acquires;
+  std::vector<Batch> unsubmitted;
+  /* Notified by markSubmitted */
+  std::condition_variable submitted;
+};
+} // namespace Vulking
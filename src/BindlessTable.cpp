@@ -0,0 +1,196 @@
+#include "BindlessTable.hpp"
+
+#include "Engine.hpp"
+#include "Functions.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Vulking {
+void BindlessTable::init() {
+  PROFILE_FUNCTION();
+  auto &ctx = Engine::ctx();
+
+  const auto properties =
+      ctx.physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                        vk::PhysicalDeviceVulkan12Properties>();
+  const auto &limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+  // Every array counts towards the per stage resource limit, so each gets at
+  // most a third of it
+  const auto perStage = limits.maxPerStageUpdateAfterBindResources / 3;
+  textures.capacity = std::min(
+      {MAX_TEXTURES, perStage,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       limits.maxDescriptorSetUpdateAfterBindSampledImages});
+  buffers.capacity = std::min(
+      {MAX_BUFFERS, perStage,
+       limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+       limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+  samplers.capacity =
+      std::min({MAX_SAMPLERS, perStage,
+                limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                limits.maxDescriptorSetUpdateAfterBindSamplers});
+
+  const std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {
+      vk::DescriptorSetLayoutBinding{}
+          .setBinding(TEXTURE_BINDING)
+          .setDescriptorType(vk::DescriptorType::eSampledImage)
+          .setDescriptorCount(textures.capacity)
+          .setStageFlags(vk::ShaderStageFlagBits::eAll),
+      vk::DescriptorSetLayoutBinding{}
+          .setBinding(BUFFER_BINDING)
+          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+          .setDescriptorCount(buffers.capacity)
+          .setStageFlags(vk::ShaderStageFlagBits::eAll),
+      vk::DescriptorSetLayoutBinding{}
+          .setBinding(SAMPLER_BINDING)
+          .setDescriptorType(vk::DescriptorType::eSampler)
+          .setDescriptorCount(samplers.capacity)
+          .setStageFlags(vk::ShaderStageFlagBits::eAll),
+  };
+  const vk::DescriptorBindingFlags flags =
+      vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+      vk::DescriptorBindingFlagBits::ePartiallyBound |
+      vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+  const std::array<vk::DescriptorBindingFlags, 3> bindingFlags = {
+      flags, flags, flags};
+  const auto bindingFlagsInfo =
+      vk::DescriptorSetLayoutBindingFlagsCreateInfo{}.setBindingFlags(
+          bindingFlags);
+  layout = ctx.device->createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo{}
+          .setFlags(
+              vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+          .setBindings(bindings)
+          .setPNext(&bindingFlagsInfo));
+  NAME_OBJECT(ctx.device, layout.get(), "bindless_layout");
+
+  const std::array<vk::DescriptorPoolSize, 3> sizes = {
+      vk::DescriptorPoolSize{}
+          .setType(vk::DescriptorType::eSampledImage)
+          .setDescriptorCount(textures.capacity),
+      vk::DescriptorPoolSize{}
+          .setType(vk::DescriptorType::eStorageBuffer)
+          .setDescriptorCount(buffers.capacity),
+      vk::DescriptorPoolSize{}
+          .setType(vk::DescriptorType::eSampler)
+          .setDescriptorCount(samplers.capacity),
+  };
+  pool = ctx.device->createDescriptorPoolUnique(
+      vk::DescriptorPoolCreateInfo{}
+          .setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+          .setMaxSets(1)
+          .setPoolSizes(sizes));
+  NAME_OBJECT(ctx.device, pool.get(), "bindless_pool");
+  const auto layoutHandle = layout.get();
+  set = ctx.device
+            ->allocateDescriptorSets(vk::DescriptorSetAllocateInfo{}
+                                         .setDescriptorPool(pool.get())
+                                         .setSetLayouts(layoutHandle))
+            .front();
+  NAME_OBJECT(ctx.device, set, "bindless_set");
+
+  defaultSampler = createSampler();
+  NAME_OBJECT(ctx.device, defaultSampler.get(), "bindless_default_sampler");
+  addSampler(defaultSampler.get());
+
+  LOG_INFO("bindless table holds " << textures.capacity << " textures, "
+                                   << buffers.capacity << " buffers and "
+                                   << samplers.capacity << " samplers");
+}
+
+uint32_t BindlessTable::addTexture(vk::ImageView view,
+                                   vk::ImageLayout layout) {
+  const auto info =
+      vk::DescriptorImageInfo{}.setImageView(view).setImageLayout(layout);
+  std::lock_guard lock(mutex);
+  const auto index = textures.acquire("textures");
+  write(TEXTURE_BINDING, index, vk::DescriptorType::eSampledImage, &info,
+        nullptr);
+  return index;
+}
+
+void BindlessTable::removeTexture(uint32_t index) {
+  std::lock_guard lock(mutex);
+  textures.release(index);
+}
+
+uint32_t BindlessTable::addBuffer(vk::Buffer buffer, vk::DeviceSize offset,
+                                  vk::DeviceSize range) {
+  const auto info = vk::DescriptorBufferInfo{}
+                        .setBuffer(buffer)
+                        .setOffset(offset)
+                        .setRange(range);
+  std::lock_guard lock(mutex);
+  const auto index = buffers.acquire("buffers");
+  write(BUFFER_BINDING, index, vk::DescriptorType::eStorageBuffer, nullptr,
+        &info);
+  return index;
+}
+
+void BindlessTable::removeBuffer(uint32_t index) {
+  std::lock_guard lock(mutex);
+  buffers.release(index);
+}
+
+uint32_t BindlessTable::addSampler(vk::Sampler sampler) {
+  const auto info = vk::DescriptorImageInfo{}.setSampler(sampler);
+  std::lock_guard lock(mutex);
+  const auto index = samplers.acquire("samplers");
+  write(SAMPLER_BINDING, index, vk::DescriptorType::eSampler, &info, nullptr);
+  return index;
+}
+
+void BindlessTable::removeSampler(uint32_t index) {
+  std::lock_guard lock(mutex);
+  samplers.release(index);
+}
+
+void BindlessTable::bind(vk::CommandBuffer cmd,
+                         vk::PipelineLayout pipelineLayout, uint32_t setIndex,
+                         vk::PipelineBindPoint bindPoint) const {
+  cmd.bindDescriptorSets(bindPoint, pipelineLayout, setIndex, set, {});
+}
+
+uint32_t BindlessTable::Slots::acquire(const char *what) {
+  // Frames up to the one an index was removed in may still read it, so it is
+  // free again once that frame has completed. ctx.frame alone can't tell,
+  // beginRender only waits for the oldest frame after it has moved on.
+  const auto completed = Engine::ctx().completedFrames.load();
+  while (!retired.empty() && retired.front().second < completed) {
+    free.push_back(retired.front().first);
+    retired.pop_front();
+  }
+  if (!free.empty()) {
+    const auto index = free.back();
+    free.pop_back();
+    return index;
+  }
+  if (next == capacity) {
+    throw std::runtime_error(
+        std::format("bindless table is out of {}, all {} are in use", what,
+                    capacity));
+  }
+  return next++;
+}
+
+void BindlessTable::Slots::release(uint32_t index) {
+  assert(index < next);
+  retired.emplace_back(index, Engine::ctx().frame);
+}
+
+void BindlessTable::write(uint32_t binding, uint32_t index,
+                          vk::DescriptorType type,
+                          const vk::DescriptorImageInfo *imageInfo,
+                          const vk::DescriptorBufferInfo *bufferInfo) {
+  const auto write = vk::WriteDescriptorSet{}
+                         .setDstSet(set)
+                         .setDstBinding(binding)
+                         .setDstArrayElement(index)
+                         .setDescriptorCount(1)
+                         .setDescriptorType(type)
+                         .setPImageInfo(imageInfo)
+                         .setPBufferInfo(bufferInfo);
+  Engine::ctx().device->updateDescriptorSets(write, {});
+}
+} // namespace Vulking
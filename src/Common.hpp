@@ -24,11 +24,19 @@
 #include <vector>
 
 #include "Logging.hpp"
+#include "Profiler.hpp"
 
 template <typename T> uint64_t getVulkanHandle(T const &cppHandle) {
   return uint64_t(static_cast<T::CType>(cppHandle));
 }
 
+/* Rounds value up to a multiple of alignment, an alignment of 0 keeps it */
+constexpr vk::DeviceSize alignUp(vk::DeviceSize value,
+                                 vk::DeviceSize alignment) {
+  return alignment == 0 ? value
+                        : (value + alignment - 1) / alignment * alignment;
+}
+
 static const char *vkResultToString(vk::Result result) {
   switch (result) {
   case vk::Result::eSuccess:
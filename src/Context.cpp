@@ -1,9 +1,11 @@
 #include "Context.hpp"
+#include "Buffer.hpp"
 #include "Engine.hpp"
 
 namespace Vulking {
 void Swapchain::createFramebuffers(const vk::RenderPass &renderPass) {
   const auto device = Engine::ctx().device.get();
+  this->renderPass = renderPass;
   framebuffers.resize(images.size());
   for (uint32_t i = 0; i < images.size(); i++) {
     std::array<vk::ImageView, 3> attachments = {
@@ -24,16 +26,41 @@ void Swapchain::createFramebuffers(const vk::RenderPass &renderPass) {
 }
 
 vk::Framebuffer Swapchain::getFramebuffer() {
-  return framebuffers[getCurrentResourceIndex()].get();
+  return framebuffers[currentImageIndex].get();
 }
 
-uint32_t Swapchain::getCurrentResourceIndex() {
-  return Engine::ctx().frame % imageCount;
+vk::SwapchainKHR Swapchain::retire(uint64_t frame) {
+  auto &entry = retired.emplace_back(Retired{
+      .frame = frame,
+      .handle = std::move(handle),
+      .color = std::move(color),
+      .colorView = std::move(colorView),
+      .depth = std::move(depth),
+      .depthView = std::move(depthView),
+      .presentSemaphores = std::move(presentSemaphores),
+      .views = std::move(views),
+      .framebuffers = std::move(framebuffers),
+  });
+  images.clear();
+  presentSemaphores.clear();
+  views.clear();
+  framebuffers.clear();
+  return entry.handle.get();
+}
+
+void Swapchain::releaseRetired(uint64_t completedFrames) {
+  // Presentation isn't fenced, so this relies on a present having finished by
+  // the time the frame after it has. Every driver we know of behaves that
+  // way, and it is what keeps recreation free of a waitIdle.
+  while (!retired.empty() && retired.front().frame <= completedFrames) {
+    LOG_DEBUG("releasing swapchain retired at frame " << retired.front().frame);
+    retired.pop_front();
+  }
 }
 
 vk::CommandBuffer Context::beginCommand(const char *name) {
   const auto info = vk::CommandBufferAllocateInfo()
-                        .setCommandPool(commandPool.get())
+                        .setCommandPool(getThreadCommandPool())
                         .setLevel(vk::CommandBufferLevel::ePrimary)
                         .setCommandBufferCount(1);
   auto commandBuffer = device->allocateCommandBuffers(info).front();
@@ -45,70 +72,193 @@ vk::CommandBuffer Context::beginCommand(const char *name) {
   return commandBuffer;
 }
 
-void Context::endAndSubmitGraphicsCommand(vk::CommandBuffer &&cmd) {
+void Context::endAndSubmitGraphicsCommand(vk::CommandBuffer &&cmd,
+                                          StagingRing::Scope scope) {
   cmd.end();
-  graphicsQueue.submit(vk::SubmitInfo().setCommandBuffers(cmd));
-  device->waitIdle();
-  device->freeCommandBuffers(commandPool.get(), cmd);
+  const auto fence = staging.commit(scope);
+  {
+    std::lock_guard lock(queueMutex);
+    graphicsQueue.submit(vk::SubmitInfo().setCommandBuffers(cmd), fence);
+  }
+  CHK(device->waitForFences(fence, vk::True, UINT64_MAX),
+      "failed waiting for graphics command");
+  device->freeCommandBuffers(getThreadCommandPool(), cmd);
+}
+
+vk::CommandPool Context::getThreadCommandPool() {
+  std::lock_guard lock(threadCommandPoolsMutex);
+  const auto id = std::this_thread::get_id();
+  const auto it = threadCommandPools.find(id);
+  if (it != threadCommandPools.end() && !it->second.thread.expired()) {
+    return it->second.pool.get();
+  }
+
+  // A new thread, or one that got the id of a thread that exited. Command
+  // buffers never outlive endAndSubmitGraphicsCommand, so the pools of exited
+  // threads have nothing left in them.
+  std::erase_if(threadCommandPools, [](const auto &entry) {
+    return entry.second.thread.expired();
+  });
+  auto &entry = threadCommandPools[id];
+  entry.pool = device->createCommandPoolUnique(
+      vk::CommandPoolCreateInfo{}
+          .setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+          .setQueueFamilyIndex(graphicsQueueFamily));
+  entry.thread = getThreadLifetime();
+  NAME_OBJECT(device, entry.pool.get(),
+              std::format("thread_command_pool_{}",
+                          threadCommandPools.size() - 1));
+  return entry.pool.get();
 }
 
 std::optional<std::tuple<vk::CommandBuffer, uint32_t>> Context::beginRender() {
-  const auto index = swapchain.getCurrentResourceIndex();
+  PROFILE_FRAME_MARK(frame);
+  PROFILE_FUNCTION();
+  if (!isHeadless()) {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (width == 0 || height == 0) {
+      // Minimized, there is nothing to render into until it comes back
+      return std::nullopt;
+    }
+    if (swapchain.framebufferResized) {
+      swapchain.framebufferResized = false;
+      Engine::engineInstance->recreateSwapchain();
+    }
+  }
+
+  const auto index = getFrameIndex();
   const auto waitFenceResult =
       device->waitForFences(inFlightFences[index].get(), vk::True, UINT64_MAX);
   if (waitFenceResult == vk::Result::eErrorDeviceLost) {
     throw std::runtime_error("device lost");
   }
+  // The fence we just waited for belongs to the oldest frame still in flight
+  // and every frame before it has completed too
+  completedFrames =
+      frame + 1 >= framesInFlight ? frame + 1 - framesInFlight : 0;
+  swapchain.releaseRetired(completedFrames);
+  gpuProfiler.beginFrame(index, frame);
+  descriptors.beginFrame(index);
+  frameData.beginFrame(index);
 
-  const auto acquire =
-      device->acquireNextImageKHR(swapchain.handle.get(), UINT64_MAX,
-                                  imageAvailableSemaphores[index].get());
-  const auto acquireResult = acquire.result;
-
-  if (acquireResult == vk::Result::eErrorOutOfDateKHR) {
-    // recreate swapchain
-    throw std::runtime_error("swapchain recreation not implemented yet");
-    return std::nullopt;
-  } else if (acquireResult != vk::Result::eSuccess &&
-             acquireResult != vk::Result::eSuboptimalKHR) {
-    throw std::runtime_error("failed to acquire swapchain image");
+  if (isHeadless()) {
+    // Offscreen images aren't handed out by anyone. There are at least
+    // framesInFlight of them, so the frame that last rendered to this one is
+    // the one whose fence we just waited for, or older.
+    swapchain.currentImageIndex = frame % swapchain.imageCount;
+  } else {
+    while (true) {
+      try {
+        const auto acquire =
+            device->acquireNextImageKHR(swapchain.handle.get(), UINT64_MAX,
+                                        imageAvailableSemaphores[index].get());
+        if (acquire.result == vk::Result::eSuboptimalKHR) {
+          // The semaphore is already pending, so render this one and
+          // recreate next frame
+          swapchain.framebufferResized = true;
+        } else if (acquire.result != vk::Result::eSuccess) {
+          throw std::runtime_error("failed to acquire swapchain image");
+        }
+        swapchain.currentImageIndex = acquire.value;
+        break;
+      } catch (const vk::OutOfDateKHRError &) {
+        // Nothing was signaled, so recreate and try again right away
+        Engine::engineInstance->recreateSwapchain();
+      }
+    }
   }
-
-  swapchain.currentImageIndex = acquire.value;
   device->resetFences(inFlightFences[index].get());
   commandBuffers[index]->reset();
+  recorder.beginFrame(index);
 
   return std::make_tuple(commandBuffers[index].get(),
                          swapchain.currentImageIndex);
 }
 
 void Context::endRender(const std::vector<vk::CommandBuffer> &commandBuffers) {
-  const auto index = swapchain.getCurrentResourceIndex();
+  PROFILE_FUNCTION();
+  const auto index = getFrameIndex();
+
+  std::vector<vk::Semaphore> waitSemaphores;
+  std::vector<vk::PipelineStageFlags> waitDstStageMask;
+  std::vector<uint64_t> waitValues;
+  std::vector<vk::CommandBuffer> submitted;
+  if (!isHeadless()) {
+    waitSemaphores.push_back(imageAvailableSemaphores[index].get());
+    waitDstStageMask.push_back(
+        vk::PipelineStageFlagBits::eColorAttachmentOutput);
+    waitValues.push_back(0);
+  }
 
-  std::vector<vk::PipelineStageFlags> waitDstStageMask{
-      vk::PipelineStageFlagBits::eColorAttachmentOutput};
-  const auto submitInfo =
-      vk::SubmitInfo()
-          .setWaitSemaphores({imageAvailableSemaphores[index].get()})
-          .setWaitDstStageMask(waitDstStageMask)
-          .setCommandBuffers(commandBuffers)
-          .setSignalSemaphores({renderFinishedSemaphores[index].get()});
+  // Take ownership of whatever finished uploading since the last frame before
+  // any of the frame's commands can touch it. GPU profiler query resets go
+  // here too when the host can't do them.
+  const auto acquireCmd = acquireCommandBuffers[index].get();
+  acquireCmd.begin(vk::CommandBufferBeginInfo{}.setFlags(
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+  const auto uploadValue = uploader.recordAcquires(acquireCmd);
+  const auto resetRecorded = gpuProfiler.recordReset(acquireCmd);
+  acquireCmd.end();
+  if (uploadValue != 0) {
+    waitSemaphores.push_back(uploader.getSemaphore());
+    waitDstStageMask.push_back(vk::PipelineStageFlagBits::eAllCommands);
+    waitValues.push_back(uploadValue);
+  }
+  if (uploadValue != 0 || resetRecorded) {
+    submitted.push_back(acquireCmd);
+  }
+  submitted.insert(submitted.end(), commandBuffers.begin(),
+                   commandBuffers.end());
 
-  graphicsQueue.submit(submitInfo, inFlightFences[index].get());
+  const auto timelineInfo =
+      vk::TimelineSemaphoreSubmitInfo{}.setWaitSemaphoreValues(waitValues);
+  auto submitInfo = vk::SubmitInfo()
+                        .setWaitSemaphores(waitSemaphores)
+                        .setWaitDstStageMask(waitDstStageMask)
+                        .setCommandBuffers(submitted)
+                        .setPNext(&timelineInfo);
+
+  if (isHeadless()) {
+    {
+      std::lock_guard lock(queueMutex);
+      graphicsQueue.submit(submitInfo, inFlightFences[index].get());
+    }
+    if (uploadValue != 0) {
+      uploader.markSubmitted(uploadValue);
+    }
+    ++frame;
+    return;
+  }
 
+  const auto renderFinished =
+      swapchain.presentSemaphores[swapchain.currentImageIndex].get();
+  submitInfo.setSignalSemaphores(renderFinished);
   const auto presentInfo =
       vk::PresentInfoKHR{}
-          .setWaitSemaphores({renderFinishedSemaphores[index].get()})
+          .setWaitSemaphores(renderFinished)
           .setSwapchains({swapchain.handle.get()})
           .setImageIndices({swapchain.currentImageIndex});
 
-  const auto presentResult = presentQueue.presentKHR(presentInfo);
+  vk::Result presentResult;
+  {
+    std::lock_guard lock(queueMutex);
+    graphicsQueue.submit(submitInfo, inFlightFences[index].get());
+    try {
+      presentResult = presentQueue.presentKHR(presentInfo);
+    } catch (const vk::OutOfDateKHRError &) {
+      presentResult = vk::Result::eErrorOutOfDateKHR;
+    }
+  }
+  // Outside queueMutex, uploads take the uploader's lock before it
+  if (uploadValue != 0) {
+    uploader.markSubmitted(uploadValue);
+  }
   if (presentResult == vk::Result::eErrorOutOfDateKHR ||
-      presentResult == vk::Result::eSuboptimalKHR ||
-      swapchain.framebufferResized) {
-    swapchain.framebufferResized = false;
-    // recreate swapchain
-    throw std::runtime_error("swapchain recreation not implemented yet");
+      presentResult == vk::Result::eSuboptimalKHR) {
+    // Recreated at the start of the next frame, once this one counts as
+    // submitted
+    swapchain.framebufferResized = true;
   } else if (presentResult != vk::Result::eSuccess) {
     throw std::runtime_error("failed to present swapchain image");
   }
@@ -116,6 +266,66 @@ void Context::endRender(const std::vector<vk::CommandBuffer> &commandBuffers) {
   ++frame;
 }
 
+std::vector<uint8_t> Context::readback() {
+  if (!isHeadless()) {
+    throw std::runtime_error(
+        "readback is only supported headless, swapchain images belong to the "
+        "presentation engine once presented");
+  }
+  if (frame == 0) {
+    throw std::runtime_error("readback before any frame was rendered");
+  }
+
+  const auto index = (frame - 1) % framesInFlight;
+  CHK(device->waitForFences(inFlightFences[index].get(), vk::True, UINT64_MAX),
+      "failed waiting for frame to read back");
+
+  const auto image = swapchain.images[swapchain.currentImageIndex];
+  const auto [width, height] = swapchain.extent;
+  const vk::DeviceSize size = vk::DeviceSize(width) * height * 4;
+  auto buffer = Buffer<uint8_t>(size, BufferUsage::READBACK,
+                                BufferMemory::READBACK, "readback");
+
+  auto cmd = beginCommand("readback");
+  // The fence only synchronizes with the host, the copy still needs the
+  // render pass's writes made visible to it
+  const auto barrier =
+      vk::ImageMemoryBarrier2KHR{}
+          .setSrcStageMask(vk::PipelineStageFlagBits2::eColorAttachmentOutput)
+          .setSrcAccessMask(vk::AccessFlagBits2::eColorAttachmentWrite)
+          .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer)
+          .setDstAccessMask(vk::AccessFlagBits2::eTransferRead)
+          .setOldLayout(swapchain.presentLayout)
+          .setNewLayout(swapchain.presentLayout)
+          .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+          .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+          .setImage(image)
+          .setSubresourceRange(
+              vk::ImageSubresourceRange{}
+                  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                  .setLevelCount(1)
+                  .setLayerCount(1));
+  cmd.pipelineBarrier2KHR(
+      vk::DependencyInfoKHR{}.setImageMemoryBarriers(barrier),
+      DYNAMIC_DISPATCHER);
+  cmd.copyImageToBuffer(
+      image, swapchain.presentLayout, buffer.getBuffer(),
+      vk::BufferImageCopy{}
+          .setImageSubresource(
+              vk::ImageSubresourceLayers{}
+                  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                  .setLayerCount(1))
+          .setImageExtent({width, height, 1}));
+  endAndSubmitGraphicsCommand(std::move(cmd));
+
+  void *pData;
+  buffer.mapTo(&pData);
+  const auto *bytes = static_cast<const uint8_t *>(pData);
+  std::vector<uint8_t> pixels(bytes, bytes + size);
+  buffer.unmap();
+  return pixels;
+}
+
 vk::ImageView Context::createImageView(vk::Image image, vk::Format format,
                                        vk::ImageAspectFlags aspectFlags,
                                        uint32_t mipLevels, const char *name) {
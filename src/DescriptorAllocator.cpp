@@ -0,0 +1,182 @@
+#include "DescriptorAllocator.hpp"
+
+#include "Engine.hpp"
+
+#include <algorithm>
+
+namespace Vulking {
+void DescriptorAllocator::init(uint32_t frameCount) {
+  std::lock_guard lock(mutex);
+  this->frameCount = frameCount;
+  for (auto &shape : shapes) {
+    shape.frames.resize(frameCount);
+  }
+}
+
+UniqueSetLayout DescriptorAllocator::createLayout(
+    std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    const char *name) {
+  auto &ctx = Engine::ctx();
+  auto layout = ctx.device->createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo{}.setBindings(bindings));
+  NAME_OBJECT(ctx.device, layout.get(), name);
+  registerLayout(layout.get(), bindings);
+  return UniqueSetLayout(std::move(layout), this);
+}
+
+void DescriptorAllocator::registerLayout(
+    vk::DescriptorSetLayout layout,
+    std::span<const vk::DescriptorSetLayoutBinding> bindings) {
+  auto sizes = getSetSizes(bindings);
+  std::vector<std::pair<vk::DescriptorType, uint32_t>> key;
+  for (const auto &size : sizes) {
+    key.emplace_back(size.type, size.descriptorCount);
+  }
+
+  std::lock_guard lock(mutex);
+  auto [found, inserted] = shapeIndices.try_emplace(key, shapes.size());
+  if (inserted) {
+    auto &shape = shapes.emplace_back();
+    shape.sizes = std::move(sizes);
+    shape.frames.resize(frameCount);
+  }
+  layoutShapes[layout] = &shapes[found->second];
+}
+
+void DescriptorAllocator::unregisterLayout(vk::DescriptorSetLayout layout) {
+  std::lock_guard lock(mutex);
+  layoutShapes.erase(layout);
+}
+
+vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout,
+                                                const char *name) {
+  vk::DescriptorSet set;
+  {
+    std::lock_guard lock(mutex);
+    auto &shape = getShape(layout);
+    set = allocateFrom(shape, shape.persistent, layout);
+  }
+  NAME_OBJECT(Engine::ctx().device, set, name);
+  return set;
+}
+
+vk::DescriptorSet
+DescriptorAllocator::allocateTransient(vk::DescriptorSetLayout layout) {
+  std::lock_guard lock(mutex);
+  auto &shape = getShape(layout);
+  return allocateFrom(shape, shape.frames[frameIndex], layout);
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex) {
+  std::lock_guard lock(mutex);
+  this->frameIndex = frameIndex;
+  const auto &device = Engine::ctx().device;
+  for (auto &shape : shapes) {
+    auto &list = shape.frames[frameIndex];
+    for (auto &pool : list.pools) {
+      if (pool.used != 0) {
+        device->resetDescriptorPool(pool.pool.get());
+        pool.used = 0;
+      }
+    }
+    list.current = 0;
+  }
+}
+
+size_t DescriptorAllocator::getPoolCount() const {
+  std::lock_guard lock(mutex);
+  size_t count = 0;
+  for (const auto &shape : shapes) {
+    count += shape.persistent.pools.size();
+    for (const auto &list : shape.frames) {
+      count += list.pools.size();
+    }
+  }
+  return count;
+}
+
+size_t DescriptorAllocator::getLayoutCount() const {
+  std::lock_guard lock(mutex);
+  return layoutShapes.size();
+}
+
+std::vector<vk::DescriptorPoolSize> DescriptorAllocator::getSetSizes(
+    std::span<const vk::DescriptorSetLayoutBinding> bindings) {
+  std::map<vk::DescriptorType, uint32_t> counts;
+  for (const auto &binding : bindings) {
+    counts[binding.descriptorType] += binding.descriptorCount;
+  }
+  std::vector<vk::DescriptorPoolSize> sizes;
+  for (const auto &[type, count] : counts) {
+    sizes.push_back(
+        vk::DescriptorPoolSize{}.setType(type).setDescriptorCount(count));
+  }
+  return sizes;
+}
+
+uint32_t DescriptorAllocator::getNextCapacity(uint32_t lastCapacity) {
+  return lastCapacity == 0 ? INITIAL_SETS_PER_POOL
+                           : std::min(lastCapacity * 2, MAX_SETS_PER_POOL);
+}
+
+std::vector<vk::DescriptorPoolSize> DescriptorAllocator::getPoolSizes(
+    std::span<const vk::DescriptorPoolSize> setSizes, uint32_t capacity) {
+  std::vector<vk::DescriptorPoolSize> sizes(setSizes.begin(), setSizes.end());
+  for (auto &size : sizes) {
+    size.descriptorCount *= capacity;
+  }
+  return sizes;
+}
+
+DescriptorAllocator::Shape &
+DescriptorAllocator::getShape(vk::DescriptorSetLayout layout) {
+  const auto found = layoutShapes.find(layout);
+  if (found == layoutShapes.end()) {
+    throw std::runtime_error(
+        "descriptor set layout was not registered with the allocator");
+  }
+  return *found->second;
+}
+
+vk::DescriptorSet DescriptorAllocator::allocateFrom(
+    Shape &shape, PoolList &list, vk::DescriptorSetLayout layout) {
+  const auto &device = Engine::ctx().device;
+  auto info = vk::DescriptorSetAllocateInfo{}.setSetLayouts(layout);
+  while (true) {
+    if (list.current == list.pools.size()) {
+      const auto capacity = getNextCapacity(
+          list.pools.empty() ? 0 : list.pools.back().capacity);
+      list.pools.push_back(createPool(shape, capacity));
+    }
+    auto &pool = list.pools[list.current];
+    if (pool.used < pool.capacity) {
+      info.setDescriptorPool(pool.pool.get());
+      vk::DescriptorSet set;
+      // The non throwing overload, running out is expected here
+      const auto result = device->allocateDescriptorSets(&info, &set);
+      if (result == vk::Result::eSuccess) {
+        pool.used++;
+        return set;
+      }
+      if (result != vk::Result::eErrorOutOfPoolMemory &&
+          result != vk::Result::eErrorFragmentedPool) {
+        throw std::runtime_error(std::format(
+            "failed allocating descriptor set: {}", vk::to_string(result)));
+      }
+    }
+    list.current++;
+  }
+}
+
+DescriptorAllocator::Pool
+DescriptorAllocator::createPool(const Shape &shape, uint32_t capacity) const {
+  LOG_DEBUG("creating descriptor pool for " << capacity << " sets");
+  const auto sizes = getPoolSizes(shape.sizes, capacity);
+  return Pool{
+      .pool = Engine::ctx().device->createDescriptorPoolUnique(
+          vk::DescriptorPoolCreateInfo{}.setMaxSets(capacity).setPoolSizes(
+              sizes)),
+      .capacity = capacity,
+  };
+}
+} // namespace Vulking
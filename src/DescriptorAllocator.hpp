@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+namespace Vulking {
+class UniqueSetLayout;
+
+/// Hands out descriptor sets from pools sized for their layout, growing
+/// instead of failing with eErrorOutOfPoolMemory.
+///
+/// Layouts with the same descriptor counts share a "shape" and so share
+/// pools. Each shape keeps one list of pools for persistent sets, which live
+/// as long as the allocator, and one per frame in flight for transient sets,
+/// which beginFrame resets wholesale once that frame's fence has signaled.
+/// Pools are never created with eFreeDescriptorSet, so allocating is a bump
+/// in the driver and nothing is freed set by set.
+class DescriptorAllocator {
+public:
+  /* The first pool of a list holds this many sets, each new one twice the
+   * last up to MAX_SETS_PER_POOL */
+  static constexpr uint32_t INITIAL_SETS_PER_POOL = 16;
+  static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+  DescriptorAllocator() = default;
+  DescriptorAllocator(const DescriptorAllocator &) = delete;
+  DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+  DescriptorAllocator(DescriptorAllocator &&) = delete;
+  DescriptorAllocator &operator=(DescriptorAllocator &&) = delete;
+
+  void init(uint32_t frameCount);
+
+  /* Creates a layout already registered with the allocator, unregistered
+   * again when it is destroyed */
+  UniqueSetLayout
+  createLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+               const char *name = "unnamed");
+  /* For layouts created elsewhere, bindings must be the ones it was created
+   * with. Pass it to unregisterLayout before destroying it. */
+  void registerLayout(vk::DescriptorSetLayout layout,
+                      std::span<const vk::DescriptorSetLayoutBinding> bindings);
+  /* Forgets layout, so a destroyed layout doesn't keep its entry and a new
+   * one reusing the handle can't be mistaken for it. Its shape's pools and
+   * the sets already allocated from them stay. Does nothing for layouts that
+   * were never registered. */
+  void unregisterLayout(vk::DescriptorSetLayout layout);
+
+  /* Lives as long as the allocator. Thread safe. */
+  vk::DescriptorSet allocate(vk::DescriptorSetLayout layout,
+                             const char *name = "unnamed");
+  /* Valid for the current frame only, recycled when its frame index comes
+   * around again. Thread safe. */
+  vk::DescriptorSet allocateTransient(vk::DescriptorSetLayout layout);
+
+  /* Called by Context::beginRender after the frame's fence has signaled */
+  void beginFrame(uint32_t frameIndex);
+
+  size_t getPoolCount() const;
+  size_t getLayoutCount() const;
+
+  /* What one set of bindings takes from a pool, one entry per descriptor
+   * type sorted by type. Layouts with equal sizes share a shape. */
+  static std::vector<vk::DescriptorPoolSize>
+  getSetSizes(std::span<const vk::DescriptorSetLayoutBinding> bindings);
+  /* Capacity of the pool created after one of lastCapacity sets, 0 for the
+   * first pool of a list */
+  static uint32_t getNextCapacity(uint32_t lastCapacity);
+  /* Sizes for a pool of capacity sets of setSizes */
+  static std::vector<vk::DescriptorPoolSize>
+  getPoolSizes(std::span<const vk::DescriptorPoolSize> setSizes,
+               uint32_t capacity);
+
+private:
+  struct Pool {
+    vk::UniqueDescriptorPool pool;
+    uint32_t capacity;
+    uint32_t used = 0;
+  };
+
+  /* Pools before current are full, the ones after it were emptied by a
+   * reset and are reused before any new one is created */
+  struct PoolList {
+    std::vector<Pool> pools;
+    size_t current = 0;
+  };
+
+  struct Shape {
+    /* For a single set */
+    std::vector<vk::DescriptorPoolSize> sizes;
+    PoolList persistent;
+    /* Indexed by frame index */
+    std::vector<PoolList> frames;
+  };
+
+  Shape &getShape(vk::DescriptorSetLayout layout);
+  vk::DescriptorSet allocateFrom(Shape &shape, PoolList &list,
+                                 vk::DescriptorSetLayout layout);
+  Pool createPool(const Shape &shape, uint32_t capacity) const;
+
+  mutable std::mutex mutex;
+  /* deque for stable addresses */
+  std::deque<Shape> shapes;
+  /* (type, count) pairs sorted by type, to index into shapes */
+  std::map<std::vector<std::pair<vk::DescriptorType, uint32_t>>, size_t>
+      shapeIndices;
+  std::unordered_map<VkDescriptorSetLayout, Shape *> layoutShapes;
+  uint32_t frameCount = 0;
+  uint32_t frameIndex = 0;
+};
+
+/// A descriptor set layout that is unregistered from the DescriptorAllocator
+/// it was created by right before it is destroyed, so the allocator never
+/// holds on to a dead handle
+class UniqueSetLayout {
+public:
+  UniqueSetLayout() = default;
+  /* allocator may be null for layouts it doesn't know about */
+  UniqueSetLayout(vk::UniqueDescriptorSetLayout layout,
+                  DescriptorAllocator *allocator)
+      : layout(std::move(layout)), allocator(allocator) {}
+  UniqueSetLayout(const UniqueSetLayout &) = delete;
+  UniqueSetLayout &operator=(const UniqueSetLayout &) = delete;
+  UniqueSetLayout(UniqueSetLayout &&other) noexcept
+      : layout(std::move(other.layout)), allocator(other.allocator) {
+    other.allocator = nullptr;
+  }
+  UniqueSetLayout &operator=(UniqueSetLayout &&other) noexcept {
+    if (this != &other) {
+      reset();
+      layout = std::move(other.layout);
+      allocator = other.allocator;
+      other.allocator = nullptr;
+    }
+    return *this;
+  }
+  ~UniqueSetLayout() { reset(); }
+
+  vk::DescriptorSetLayout get() const { return layout.get(); }
+
+  void reset() {
+    if (layout && allocator) {
+      allocator->unregisterLayout(layout.get());
+    }
+    layout.reset();
+    allocator = nullptr;
+  }
+
+private:
+  vk::UniqueDescriptorSetLayout layout;
+  DescriptorAllocator *allocator = nullptr;
+};
+} // namespace Vulking
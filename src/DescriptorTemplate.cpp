@@ -0,0 +1,134 @@
+#include "DescriptorTemplate.hpp"
+
+#include "Engine.hpp"
+
+#include <algorithm>
+
+namespace Vulking {
+namespace {
+/* Bytes one descriptor of type takes in the packed struct */
+size_t getDescriptorSize(vk::DescriptorType type) {
+  switch (type) {
+  case vk::DescriptorType::eSampler:
+  case vk::DescriptorType::eCombinedImageSampler:
+  case vk::DescriptorType::eSampledImage:
+  case vk::DescriptorType::eStorageImage:
+  case vk::DescriptorType::eInputAttachment:
+    return sizeof(vk::DescriptorImageInfo);
+  case vk::DescriptorType::eUniformBuffer:
+  case vk::DescriptorType::eStorageBuffer:
+  case vk::DescriptorType::eUniformBufferDynamic:
+  case vk::DescriptorType::eStorageBufferDynamic:
+    return sizeof(vk::DescriptorBufferInfo);
+  case vk::DescriptorType::eUniformTexelBuffer:
+  case vk::DescriptorType::eStorageTexelBuffer:
+    return sizeof(vk::BufferView);
+  default:
+    throw std::runtime_error(
+        std::format("descriptor templates don't support {} descriptors",
+                    vk::to_string(type)));
+  }
+}
+} // namespace
+
+UniqueSetLayout DescriptorTemplate::createPushLayout(
+    std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    const char *name) {
+  auto &ctx = Engine::ctx();
+  if (!ctx.pushDescriptors) {
+    // push() allocates transient sets of it
+    return ctx.descriptors.createLayout(bindings, name);
+  }
+  auto layout = ctx.device->createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo{}
+          .setFlags(vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR)
+          .setBindings(bindings));
+  NAME_OBJECT(ctx.device, layout.get(), name);
+  // Never registered, nothing to unregister
+  return UniqueSetLayout(std::move(layout), nullptr);
+}
+
+void DescriptorTemplate::init(
+    vk::DescriptorSetLayout layout,
+    std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    const char *name) {
+  create(bindings,
+         vk::DescriptorUpdateTemplateCreateInfo{}
+             .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+             .setDescriptorSetLayout(layout),
+         name);
+}
+
+void DescriptorTemplate::initPush(
+    vk::DescriptorSetLayout layout,
+    std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    vk::PipelineLayout pipelineLayout, uint32_t setIndex,
+    vk::PipelineBindPoint bindPoint, const char *name) {
+  this->pipelineLayout = pipelineLayout;
+  this->setIndex = setIndex;
+  this->bindPoint = bindPoint;
+  if (!Engine::ctx().pushDescriptors) {
+    setLayout = layout;
+    init(layout, bindings, name);
+    return;
+  }
+  create(bindings,
+         vk::DescriptorUpdateTemplateCreateInfo{}
+             .setTemplateType(
+                 vk::DescriptorUpdateTemplateType::ePushDescriptorsKHR)
+             .setPipelineBindPoint(bindPoint)
+             .setPipelineLayout(pipelineLayout)
+             .setSet(setIndex),
+         name);
+}
+
+void DescriptorTemplate::update(vk::DescriptorSet set,
+                                const void *data) const {
+  Engine::ctx().device->updateDescriptorSetWithTemplate(set, handle.get(),
+                                                        data);
+}
+
+void DescriptorTemplate::push(vk::CommandBuffer cmd, const void *data) const {
+  assert(pipelineLayout && "not a push descriptor template");
+  if (setLayout) {
+    const auto set = Engine::ctx().descriptors.allocateTransient(setLayout);
+    update(set, data);
+    cmd.bindDescriptorSets(bindPoint, pipelineLayout, setIndex, set, {});
+    return;
+  }
+  cmd.pushDescriptorSetWithTemplateKHR(handle.get(), pipelineLayout, setIndex,
+                                       data, DYNAMIC_DISPATCHER);
+}
+
+void DescriptorTemplate::create(
+    std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    vk::DescriptorUpdateTemplateCreateInfo info, const char *name) {
+  // Binding order, which is what the packed struct declares its members in
+  std::vector<vk::DescriptorSetLayoutBinding> sorted(bindings.begin(),
+                                                     bindings.end());
+  std::ranges::sort(sorted, {}, &vk::DescriptorSetLayoutBinding::binding);
+
+  std::vector<vk::DescriptorUpdateTemplateEntry> entries;
+  entries.reserve(sorted.size());
+  dataSize = 0;
+  for (const auto &binding : sorted) {
+    if (binding.descriptorCount == 0) {
+      continue;
+    }
+    const auto size = getDescriptorSize(binding.descriptorType);
+    entries.push_back(vk::DescriptorUpdateTemplateEntry{}
+                          .setDstBinding(binding.binding)
+                          .setDstArrayElement(0)
+                          .setDescriptorCount(binding.descriptorCount)
+                          .setDescriptorType(binding.descriptorType)
+                          .setOffset(dataSize)
+                          .setStride(size));
+    dataSize += size * binding.descriptorCount;
+  }
+
+  auto &ctx = Engine::ctx();
+  handle = ctx.device->createDescriptorUpdateTemplateUnique(
+      info.setDescriptorUpdateEntries(entries));
+  NAME_OBJECT(ctx.device, handle.get(), name);
+}
+} // namespace Vulking
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Common.hpp"
+#include "DescriptorAllocator.hpp"
+
+#include <cassert>
+#include <span>
+#include <type_traits>
+
+namespace Vulking {
+/// A descriptor update template generated from a set layout's bindings, so
+/// writing a whole set is one vkUpdateDescriptorSetWithTemplate over a
+/// packed struct instead of building WriteDescriptorSets.
+///
+/// The struct holds each binding's descriptors in binding order, as
+/// vk::DescriptorImageInfo for samplers and images, vk::DescriptorBufferInfo
+/// for buffers and vk::BufferView for texel buffers:
+///
+///   struct FrameDescriptors {
+///     vk::DescriptorBufferInfo ubo;        // binding 0
+///     vk::DescriptorImageInfo shadows[4];  // binding 1, count 4
+///   };
+///
+/// Made with initPush, it writes push descriptors (VK_KHR_push_descriptor)
+/// straight into a command buffer instead, for per draw data that shouldn't
+/// need a set allocated at all. On devices without the extension push()
+/// writes a transient set from Context::descriptors and binds it, which
+/// costs an allocation but behaves the same.
+class DescriptorTemplate {
+public:
+  DescriptorTemplate() = default;
+  DescriptorTemplate(const DescriptorTemplate &) = delete;
+  DescriptorTemplate &operator=(const DescriptorTemplate &) = delete;
+  DescriptorTemplate(DescriptorTemplate &&) = delete;
+  DescriptorTemplate &operator=(DescriptorTemplate &&) = delete;
+
+  /* Creates a layout for initPush, with ePushDescriptorKHR when the device
+   * supports it and registered with Context::descriptors otherwise */
+  static UniqueSetLayout
+  createPushLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                   const char *name = "unnamed");
+
+  /* For sets allocated with layout, which was created from bindings */
+  void init(vk::DescriptorSetLayout layout,
+            std::span<const vk::DescriptorSetLayoutBinding> bindings,
+            const char *name = "unnamed");
+  /* For pushing to set setIndex of pipelineLayout, whose layout there is
+   * layout, made by createPushLayout from bindings */
+  void initPush(vk::DescriptorSetLayout layout,
+                std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                vk::PipelineLayout pipelineLayout, uint32_t setIndex,
+                vk::PipelineBindPoint bindPoint =
+                    vk::PipelineBindPoint::eGraphics,
+                const char *name = "unnamed");
+
+  /* Bytes the packed struct must have */
+  size_t getDataSize() const { return dataSize; }
+
+  template <typename T>
+  void update(vk::DescriptorSet set, const T &data) const {
+    static_assert(std::is_trivially_copyable_v<T>);
+    assert(sizeof(T) == dataSize);
+    update(set, static_cast<const void *>(&data));
+  }
+  void update(vk::DescriptorSet set, const void *data) const;
+
+  /* initPush templates only. Without push descriptor support the set
+   * written is only valid for the current frame. */
+  template <typename T> void push(vk::CommandBuffer cmd, const T &data) const {
+    static_assert(std::is_trivially_copyable_v<T>);
+    assert(sizeof(T) == dataSize);
+    push(cmd, static_cast<const void *>(&data));
+  }
+  void push(vk::CommandBuffer cmd, const void *data) const;
+
+private:
+  void create(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+              vk::DescriptorUpdateTemplateCreateInfo info, const char *name);
+
+  vk::UniqueDescriptorUpdateTemplate handle;
+  size_t dataSize = 0;
+  /* Push templates only */
+  vk::PipelineLayout pipelineLayout;
+  uint32_t setIndex = 0;
+  /* Push templates on devices without push descriptors, whose template
+   * writes sets of setLayout */
+  vk::DescriptorSetLayout setLayout;
+  vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics;
+};
+} // namespace Vulking
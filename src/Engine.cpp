@@ -2,6 +2,7 @@
 
 #include "Constants.hpp"
 #include "Functions.hpp"
+#include "Mesh.hpp"
 #include "UniqueSurface.hpp"
 
 #include <cassert>
@@ -13,6 +14,8 @@
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  /* Only set for a family without graphics, i.e. a dedicated copy engine */
+  std::optional<uint32_t> transferFamily;
 
   bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value();
@@ -27,10 +30,13 @@ Engine *Engine::engineInstance = nullptr;
 
 Engine::Engine(GLFWwindow *window, const char *applicationInfo,
                uint32_t applicationVersion,
-               const std::vector<const char *> &requiredExtensions) {
+               const std::vector<const char *> &requiredExtensions,
+               uint32_t framesInFlight) {
+  PROFILE_ZONE("Engine::Engine");
   Engine::engineInstance = this;
 
   context.window = window;
+  context.framesInFlight = framesInFlight;
   context.instance =
       createInstance(applicationInfo, applicationVersion, requiredExtensions);
 
@@ -44,57 +50,162 @@ Engine::Engine(GLFWwindow *window, const char *applicationInfo,
   context.surface = std::move(
       UniqueSurface(context.instance.get(), vk::SurfaceKHR(_surface)));
 
+  initDevice();
+
+  context.swapchain.presentLayout = vk::ImageLayout::ePresentSrcKHR;
+  initSwapchain(nullptr);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *, int, int) {
+    Engine::ctx().swapchain.framebufferResized = true;
+  });
+
+  initFrameResources();
+}
+
+void Engine::recreateSwapchain() {
+  PROFILE_FUNCTION();
+  assert(!context.isHeadless());
+  auto &swapchain = context.swapchain;
+  const auto previousExtent = swapchain.extent;
+  // Frames already submitted keep rendering to and presenting the old
+  // swapchain, its resources are released once they have completed
+  const auto oldSwapchain = swapchain.retire(context.frame);
+  initSwapchain(oldSwapchain);
+  if (swapchain.renderPass) {
+    swapchain.createFramebuffers(swapchain.renderPass);
+  }
+  LOG_INFO("recreated swapchain " << previousExtent.width << "x"
+                                  << previousExtent.height << " -> "
+                                  << swapchain.extent.width << "x"
+                                  << swapchain.extent.height);
+}
+
+void Engine::initSwapchain(vk::SwapchainKHR oldSwapchain) {
+  PROFILE_FUNCTION();
+  context.swapchain.handle = createSwapchain(oldSwapchain);
+  context.swapchain.images =
+      context.device->getSwapchainImagesKHR(context.swapchain.handle.get());
+  // The driver may hand out more images than we asked for
+  const auto count = static_cast<uint32_t>(context.swapchain.images.size());
+  context.swapchain.imageCount = count;
+
+  context.swapchain.views.resize(count);
+  context.swapchain.presentSemaphores.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    context.swapchain.views[i] = context.createImageViewUnique(
+        context.swapchain.images[i], context.swapchain.imageFormat,
+        vk::ImageAspectFlagBits::eColor, 1);
+    context.swapchain.presentSemaphores[i] =
+        context.device->createSemaphoreUnique(vk::SemaphoreCreateInfo{});
+    NAME_OBJECT(context.device, context.swapchain.presentSemaphores[i].get(),
+                std::format("present_semaphore_{}", i));
+  }
+
+  createAttachments();
+}
+
+Engine::Engine(vk::Extent2D extent, const char *applicationInfo,
+               uint32_t applicationVersion,
+               const std::vector<const char *> &requiredExtensions,
+               uint32_t imageCount, uint32_t framesInFlight) {
+  PROFILE_ZONE("Engine::Engine");
+  Engine::engineInstance = this;
+
+  context.window = nullptr;
+  context.framesInFlight = framesInFlight;
+  context.instance =
+      createInstance(applicationInfo, applicationVersion, requiredExtensions);
+
+  initDevice();
+
+  // Offscreen images stand in for the swapchain, everything downstream of
+  // Swapchain::images works the same
+  {
+    if (imageCount < framesInFlight) {
+      LOG_WARNING("raising the offscreen image count from "
+                  << imageCount << " to " << framesInFlight
+                  << ", one per frame in flight");
+      imageCount = framesInFlight;
+    }
+    auto &swapchain = context.swapchain;
+    swapchain.imageCount = imageCount;
+    swapchain.imageFormat = vk::Format::eR8G8B8A8Srgb;
+    swapchain.extent = extent;
+    swapchain.presentLayout = vk::ImageLayout::eTransferSrcOptimal;
+
+    swapchain.offscreen.resize(imageCount);
+    swapchain.images.resize(imageCount);
+    swapchain.views.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+      swapchain.offscreen[i] =
+          Image(extent.width, extent.height, 1, vk::SampleCountFlagBits::e1,
+                swapchain.imageFormat, vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eColorAttachment |
+                    vk::ImageUsageFlagBits::eTransferSrc,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                std::format("offscreen_image_{}", i).c_str());
+      swapchain.images[i] = swapchain.offscreen[i].image.get();
+      swapchain.views[i] = context.createImageViewUnique(
+          swapchain.images[i], swapchain.imageFormat,
+          vk::ImageAspectFlagBits::eColor, 1);
+    }
+
+    createAttachments();
+  }
+
+  initFrameResources();
+  LOG_INFO("running headless at " << extent.width << "x" << extent.height);
+}
+
+void Engine::initDevice() {
+  PROFILE_FUNCTION();
   context.physicalDevice = getSuitablePhysicalDevice();
   context.device = createDevice();
+  context.allocator.init(context.physicalDevice, context.device.get());
+  context.pipelineCache.init(PIPELINE_CACHE_PATH);
+  context.pipelines.init();
 
   context.commandPool = createCommandPool();
+  context.staging.init();
+  context.geometry.init(sizeof(Mesh::PackedVertex));
+  context.uploader.init();
+  context.bindless.init();
+}
 
-  // Move swapchain stuff to own function so we can recreate easily
+void Engine::createAttachments() {
+  const auto width = context.swapchain.extent.width;
+  const auto height = context.swapchain.extent.height;
+  // color image (extract later)
   {
-    context.swapchain.handle = createSwapchain();
-    context.swapchain.images =
-        context.device->getSwapchainImagesKHR(context.swapchain.handle.get());
-    const auto count = context.swapchain.images.size();
-
-    context.swapchain.views.resize(count);
-    for (uint32_t i = 0; i < count; i++) {
-      context.swapchain.views[i] = context.createImageViewUnique(
-          context.swapchain.images[i], context.swapchain.imageFormat,
-          vk::ImageAspectFlagBits::eColor, 1);
-    }
+    context.swapchain.color =
+        Image(width, height, 1, context.msaaSamples,
+              context.swapchain.imageFormat, vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eTransientAttachment |
+                  vk::ImageUsageFlagBits::eColorAttachment,
+              vk::MemoryPropertyFlagBits::eDeviceLocal);
+    context.swapchain.colorView = context.createImageViewUnique(
+        context.swapchain.color.image.get(), context.swapchain.imageFormat,
+        vk::ImageAspectFlagBits::eColor, 1);
+  }
 
-    {
-      // create resources
-
-      const auto width = context.swapchain.extent.width;
-      const auto height = context.swapchain.extent.height;
-      // color image (extract later)
-      {
-        context.swapchain.color =
-            Image(width, height, 1, context.msaaSamples,
-                  context.swapchain.imageFormat, vk::ImageTiling::eOptimal,
-                  vk::ImageUsageFlagBits::eTransientAttachment |
-                      vk::ImageUsageFlagBits::eColorAttachment,
-                  vk::MemoryPropertyFlagBits::eDeviceLocal);
-        context.swapchain.colorView = context.createImageViewUnique(
-            context.swapchain.color.image.get(), context.swapchain.imageFormat,
-            vk::ImageAspectFlagBits::eColor, 1);
-      }
+  // depth image (extract later)
+  {
+    const auto depthFormat = findDepthFormat();
+    context.swapchain.depth =
+        Image(width, height, 1, context.msaaSamples, depthFormat,
+              vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eTransientAttachment |
+                  vk::ImageUsageFlagBits::eDepthStencilAttachment,
+              vk::MemoryPropertyFlagBits::eDeviceLocal);
+    context.swapchain.depthView = context.createImageViewUnique(
+        context.swapchain.depth.image.get(), depthFormat,
+        vk::ImageAspectFlagBits::eDepth, 1);
+  }
+}
 
-      // depth image (extract later)
-      {
-        const auto depthFormat = findDepthFormat();
-        context.swapchain.depth =
-            Image(width, height, 1, context.msaaSamples, depthFormat,
-                  vk::ImageTiling::eOptimal,
-                  vk::ImageUsageFlagBits::eTransientAttachment |
-                      vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                  vk::MemoryPropertyFlagBits::eDeviceLocal);
-        context.swapchain.depthView = context.createImageViewUnique(
-            context.swapchain.depth.image.get(), depthFormat,
-            vk::ImageAspectFlagBits::eDepth, 1);
-      }
-    }
+void Engine::initFrameResources() {
+  PROFILE_FUNCTION();
+  if (context.framesInFlight == 0) {
+    throw std::runtime_error("framesInFlight must be at least 1");
   }
 
   // command buffers (extract later)
@@ -103,32 +214,47 @@ Engine::Engine(GLFWwindow *window, const char *applicationInfo,
         vk::CommandBufferAllocateInfo()
             .setCommandPool(context.commandPool.get())
             .setLevel(vk::CommandBufferLevel::ePrimary)
-            .setCommandBufferCount(context.swapchain.imageCount));
+            .setCommandBufferCount(context.framesInFlight));
     for (const auto &[i, cmd] :
          std::ranges::views::enumerate(context.commandBuffers)) {
       NAME_OBJECT(context.device, cmd.get(),
                   std::format("engine_command_buffer_{}", i));
     }
+
+    context.acquireCommandBuffers =
+        context.device->allocateCommandBuffersUnique(
+            vk::CommandBufferAllocateInfo()
+                .setCommandPool(context.commandPool.get())
+                .setLevel(vk::CommandBufferLevel::ePrimary)
+                .setCommandBufferCount(context.framesInFlight));
+    for (const auto &[i, cmd] :
+         std::ranges::views::enumerate(context.acquireCommandBuffers)) {
+      NAME_OBJECT(context.device, cmd.get(),
+                  std::format("engine_acquire_command_buffer_{}", i));
+    }
   }
 
+  context.workers.init();
+  context.recorder.init(context.workers, context.framesInFlight);
+  context.gpuProfiler.init(context.framesInFlight);
+  context.descriptors.init(context.framesInFlight);
+  context.frameData.init(context.framesInFlight);
+
   // sync objects (extract later)
   {
     // Create the fence signaled to simplify our sync loop in begin/end render.
     const auto fenceInfo =
         vk::FenceCreateInfo().setFlags(vk::FenceCreateFlagBits::eSignaled);
-    const auto count = context.swapchain.imageCount;
+    const auto count = context.framesInFlight;
     context.inFlightFences.resize(count);
 
     const auto semaphoreInfo = vk::SemaphoreCreateInfo();
     context.imageAvailableSemaphores.resize(count);
-    context.renderFinishedSemaphores.resize(count);
 
     for (uint32_t i = 0; i < count; i++) {
       context.inFlightFences[i] = context.device->createFenceUnique(fenceInfo);
       context.imageAvailableSemaphores[i] =
           context.device->createSemaphoreUnique(semaphoreInfo);
-      context.renderFinishedSemaphores[i] =
-          context.device->createSemaphoreUnique(semaphoreInfo);
     }
   }
 }
@@ -155,34 +281,49 @@ Engine::createInstance(const char *applicationInfo, uint32_t applicationVersion,
 
 vk::PhysicalDevice Engine::getSuitablePhysicalDevice() {
   auto physicalDevices = context.instance->enumeratePhysicalDevices();
+  std::optional<vk::PhysicalDevice> best;
+  uint32_t bestRank = 0;
   for (const auto &physicalDevice : physicalDevices) {
-    if (isDeviceSuitable(physicalDevice)) {
-      const auto props = physicalDevice.getProperties();
-      const auto counts = props.limits.framebufferColorSampleCounts &
-                          props.limits.framebufferDepthSampleCounts;
-      const std::array<vk::SampleCountFlagBits, 6> sampleCounts = {
-          vk::SampleCountFlagBits::e64, vk::SampleCountFlagBits::e32,
-          vk::SampleCountFlagBits::e16, vk::SampleCountFlagBits::e8,
-          vk::SampleCountFlagBits::e4,  vk::SampleCountFlagBits::e2,
-      };
-
-      for (const auto sampleCount : sampleCounts) {
-        if (counts & sampleCount) {
-          context.msaaSamples = sampleCount;
-          break;
-        }
-      }
+    if (!isDeviceSuitable(physicalDevice)) {
+      continue;
+    }
+    const auto rank =
+        getDeviceTypeRank(physicalDevice.getProperties().deviceType);
+    if (!best || rank > bestRank) {
+      best = physicalDevice;
+      bestRank = rank;
+    }
+  }
 
-      if (context.msaaSamples == vk::SampleCountFlagBits{}) {
-        // validation gets angry when setting it to 1, not entirely sure why
-        // can't really do anything else though?
-        context.msaaSamples = vk::SampleCountFlagBits::e1;
-      }
-      return physicalDevice;
+  if (!best) {
+    throw std::runtime_error("failed to find a suitable GPU.");
+  }
+
+  const auto physicalDevice = best.value();
+  const auto props = physicalDevice.getProperties();
+  LOG_INFO("using " << props.deviceName << " ("
+                    << vk::to_string(props.deviceType) << ")");
+  const auto counts = props.limits.framebufferColorSampleCounts &
+                      props.limits.framebufferDepthSampleCounts;
+  const std::array<vk::SampleCountFlagBits, 6> sampleCounts = {
+      vk::SampleCountFlagBits::e64, vk::SampleCountFlagBits::e32,
+      vk::SampleCountFlagBits::e16, vk::SampleCountFlagBits::e8,
+      vk::SampleCountFlagBits::e4,  vk::SampleCountFlagBits::e2,
+  };
+
+  for (const auto sampleCount : sampleCounts) {
+    if (counts & sampleCount) {
+      context.msaaSamples = sampleCount;
+      break;
     }
   }
 
-  throw std::runtime_error("failed to find a suitable GPU.");
+  if (context.msaaSamples == vk::SampleCountFlagBits{}) {
+    // validation gets angry when setting it to 1, not entirely sure why
+    // can't really do anything else though?
+    context.msaaSamples = vk::SampleCountFlagBits::e1;
+  }
+  return physicalDevice;
 }
 
 bool Engine::isDeviceSuitable(vk::PhysicalDevice physicalDevice) const {
@@ -197,9 +338,50 @@ bool Engine::isDeviceSuitable(vk::PhysicalDevice physicalDevice) const {
   LOG_INFO("\t apiVersion = " << props.apiVersion);
   LOG_INFO("\t driverVersion = " << props.driverVersion);
   LOG_INFO("\t deviceName = " << props.deviceName);
+  LOG_INFO("\t deviceType = " << vk::to_string(props.deviceType));
+
+  if (getDeviceTypeRank(props.deviceType) == 0) {
+    return false;
+  }
+
+  const auto indices = findQueueFamilies(physicalDevice, context.surface.get());
+  if (!indices.isComplete()) {
+    return false;
+  }
+
+  const auto supportedExtensions =
+      physicalDevice.enumerateDeviceExtensionProperties();
+  return std::ranges::all_of(getDeviceExtensions(), [&](const char *ext) {
+    return std::ranges::any_of(supportedExtensions, [&](const auto &e) {
+      return strcmp(ext, e.extensionName) == 0;
+    });
+  });
+}
+
+uint32_t Engine::getDeviceTypeRank(vk::PhysicalDeviceType type) {
+  // CPU implementations like lavapipe are a last resort, but they are what
+  // headless machines without a GPU have
+  switch (type) {
+  case vk::PhysicalDeviceType::eDiscreteGpu:
+    return 4;
+  case vk::PhysicalDeviceType::eIntegratedGpu:
+    return 3;
+  case vk::PhysicalDeviceType::eVirtualGpu:
+    return 2;
+  case vk::PhysicalDeviceType::eCpu:
+    return 1;
+  default:
+    return 0;
+  }
+}
 
-  return props.deviceType == vk::PhysicalDeviceType::eDiscreteGpu ||
-         props.deviceType == vk::PhysicalDeviceType::eIntegratedGpu;
+std::vector<const char *> Engine::getDeviceExtensions() const {
+  auto extensions = DEVICE_EXTENSIONS;
+  if (!context.isHeadless()) {
+    extensions.insert(extensions.end(), PRESENT_DEVICE_EXTENSIONS.begin(),
+                      PRESENT_DEVICE_EXTENSIONS.end());
+  }
+  return extensions;
 }
 
 vk::UniqueDevice Engine::createDevice() {
@@ -207,11 +389,14 @@ vk::UniqueDevice Engine::createDevice() {
       findQueueFamilies(context.physicalDevice, context.surface.get());
   context.graphicsQueueFamily = indices.graphicsFamily.value();
   context.presentQueueFamily = indices.presentFamily.value();
+  context.transferQueueFamily =
+      indices.transferFamily.value_or(context.graphicsQueueFamily);
 
   vk::ArrayProxy<float> queuePriorities = 1.0f;
   std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueFamilies = {context.graphicsQueueFamily,
-                                       context.presentQueueFamily};
+                                       context.presentQueueFamily,
+                                       context.transferQueueFamily};
 
   for (uint32_t queueFamily : uniqueFamilies) {
     vk::DeviceQueueCreateInfo queueCreateInfo{};
@@ -228,6 +413,21 @@ vk::UniqueDevice Engine::createDevice() {
   if (ENABLE_SAMPLE_SHADING && !supportedFeatures.sampleRateShading) {
     throw std::runtime_error("Device doesn't support sample rate shading");
   }
+  const auto supported12Features =
+      context.physicalDevice
+          .getFeatures2<vk::PhysicalDeviceFeatures2,
+                        vk::PhysicalDeviceVulkan12Features>()
+          .get<vk::PhysicalDeviceVulkan12Features>();
+  if (!supported12Features.runtimeDescriptorArray ||
+      !supported12Features.descriptorBindingPartiallyBound ||
+      !supported12Features.descriptorBindingUpdateUnusedWhilePending ||
+      !supported12Features.descriptorBindingSampledImageUpdateAfterBind ||
+      !supported12Features.descriptorBindingStorageBufferUpdateAfterBind ||
+      !supported12Features.shaderSampledImageArrayNonUniformIndexing ||
+      !supported12Features.shaderStorageBufferArrayNonUniformIndexing) {
+    throw std::runtime_error(
+        "Device doesn't support the descriptor indexing BindlessTable needs");
+  }
 
   vk::PhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
@@ -235,25 +435,52 @@ vk::UniqueDevice Engine::createDevice() {
     deviceFeatures.sampleRateShading = VK_TRUE;
   }
 
+  auto deviceExtensions = getDeviceExtensions();
   const auto supportedExtensions =
       context.physicalDevice.enumerateDeviceExtensionProperties();
-  for (const auto &ext : DEVICE_EXTENSIONS) {
-    bool found = std::ranges::any_of(supportedExtensions, [&](const auto &e) {
+  const auto isSupported = [&](const char *ext) {
+    return std::ranges::any_of(supportedExtensions, [&](const auto &e) {
       return strcmp(ext, e.extensionName) == 0;
     });
-    if (!found) {
+  };
+  for (const auto &ext : deviceExtensions) {
+    if (!isSupported(ext)) {
       throw std::runtime_error(std::string("Missing required extension: ") +
                                ext);
     }
   }
+  // Optional, only a faster path for DescriptorTemplate::push
+  context.pushDescriptors = isSupported(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  if (context.pushDescriptors) {
+    deviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  } else {
+    LOG_INFO("no push descriptors, DescriptorTemplate::push binds "
+             "transient sets instead");
+  }
 
+  // Optional, GpuProfiler resets its queries on the device without it
+  context.hostQueryReset = supported12Features.hostQueryReset;
+
+  // Descriptor indexing is for BindlessTable
+  auto vulkan12Features =
+      vk::PhysicalDeviceVulkan12Features{}
+          .setTimelineSemaphore(vk::True)
+          .setHostQueryReset(context.hostQueryReset)
+          .setRuntimeDescriptorArray(vk::True)
+          .setDescriptorBindingPartiallyBound(vk::True)
+          .setDescriptorBindingUpdateUnusedWhilePending(vk::True)
+          .setDescriptorBindingSampledImageUpdateAfterBind(vk::True)
+          .setDescriptorBindingStorageBufferUpdateAfterBind(vk::True)
+          .setShaderSampledImageArrayNonUniformIndexing(vk::True)
+          .setShaderStorageBufferArrayNonUniformIndexing(vk::True);
   const auto sync2Features =
-      vk::PhysicalDeviceSynchronization2FeaturesKHR{}.setSynchronization2(
-          vk::True);
+      vk::PhysicalDeviceSynchronization2FeaturesKHR{}
+          .setSynchronization2(vk::True)
+          .setPNext(&vulkan12Features);
   const auto createInfo = vk::DeviceCreateInfo()
                               .setQueueCreateInfos(queueCreateInfos)
                               .setPEnabledFeatures(&deviceFeatures)
-                              .setPEnabledExtensionNames(DEVICE_EXTENSIONS)
+                              .setPEnabledExtensionNames(deviceExtensions)
                               .setPNext(&sync2Features);
 
   auto device = context.physicalDevice.createDeviceUnique(createInfo);
@@ -263,11 +490,13 @@ vk::UniqueDevice Engine::createDevice() {
 
   context.graphicsQueue = device->getQueue(context.graphicsQueueFamily, 0);
   context.presentQueue = device->getQueue(context.presentQueueFamily, 0);
+  context.transferQueue = device->getQueue(context.transferQueueFamily, 0);
 
   return device;
 }
 
-vk::UniqueSwapchainKHR Engine::createSwapchain() {
+vk::UniqueSwapchainKHR
+Engine::createSwapchain(vk::SwapchainKHR oldSwapchain) {
   auto caps = context.physicalDevice.getSurfaceCapabilitiesKHR(context.surface);
   auto formats = context.physicalDevice.getSurfaceFormatsKHR(context.surface);
   auto presentModes =
@@ -275,11 +504,12 @@ vk::UniqueSwapchainKHR Engine::createSwapchain() {
 
   auto extent = chooseSwapExtent(caps);
   auto format = chooseSwapSurfaceFormat(formats);
+  // One more than the minimum so acquire doesn't wait on the presentation
+  // engine. How far the CPU runs ahead is up to framesInFlight.
   auto imageCount = caps.minImageCount + 1;
   if (caps.maxImageCount > 0 && imageCount > caps.maxImageCount) {
     imageCount = caps.maxImageCount;
   }
-  context.swapchain.imageCount = imageCount;
 
   vk::SwapchainCreateInfoKHR info{};
   info.setImageFormat(format.format)
@@ -303,7 +533,7 @@ vk::UniqueSwapchainKHR Engine::createSwapchain() {
   info.setPreTransform(caps.currentTransform);
   info.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque);
   info.setClipped(vk::True);
-  info.setOldSwapchain(VK_NULL_HANDLE);
+  info.setOldSwapchain(oldSwapchain);
 
   context.swapchain.imageFormat = format.format;
   context.swapchain.extent = extent;
@@ -375,10 +605,13 @@ QueueFamilyIndices findQueueFamilies(vk::PhysicalDevice physicalDevice,
        std::ranges::views::enumerate(queueFamilies)) {
     if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
       indices.graphicsFamily = i;
+      // Headless, nothing is presented so don't create a separate queue
+      if (!surface) {
+        indices.presentFamily = i;
+      }
     }
 
-    const auto presentSupport = physicalDevice.getSurfaceSupportKHR(i, surface);
-    if (presentSupport) {
+    if (surface && physicalDevice.getSurfaceSupportKHR(i, surface)) {
       indices.presentFamily = i;
     }
 
@@ -387,5 +620,29 @@ QueueFamilyIndices findQueueFamilies(vk::PhysicalDevice physicalDevice,
     }
   }
 
+  // Prefer a transfer only family (the copy engine), then any non-graphics
+  // family that can transfer
+  for (const auto [i, queueFamily] :
+       std::ranges::views::enumerate(queueFamilies)) {
+    const auto flags = queueFamily.queueFlags;
+    if ((flags & vk::QueueFlagBits::eTransfer) &&
+        !(flags & vk::QueueFlagBits::eGraphics) &&
+        !(flags & vk::QueueFlagBits::eCompute)) {
+      indices.transferFamily = i;
+      break;
+    }
+  }
+  if (!indices.transferFamily) {
+    for (const auto [i, queueFamily] :
+         std::ranges::views::enumerate(queueFamilies)) {
+      const auto flags = queueFamily.queueFlags;
+      if ((flags & vk::QueueFlagBits::eTransfer) &&
+          !(flags & vk::QueueFlagBits::eGraphics)) {
+        indices.transferFamily = i;
+        break;
+      }
+    }
+  }
+
   return indices;
 }
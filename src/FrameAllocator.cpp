@@ -0,0 +1,68 @@
+#include "FrameAllocator.hpp"
+
+#include "Buffer.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Vulking {
+void FrameAllocator::init(uint32_t frameCount, vk::DeviceSize frameSize) {
+  auto &ctx = Engine::ctx();
+  const auto &limits = ctx.physicalDevice.getProperties().limits;
+  alignment = std::max({limits.minUniformBufferOffsetAlignment,
+                        limits.minStorageBufferOffsetAlignment,
+                        vk::DeviceSize{16}});
+  this->frameSize = alignUp(frameSize, alignment);
+  // Dynamic offsets are 32 bits
+  assert(this->frameSize * frameCount <= UINT32_MAX);
+
+  buffer = ctx.device->createBufferUnique(
+      vk::BufferCreateInfo{}
+          .setSize(this->frameSize * frameCount)
+          .setUsage(vk::BufferUsageFlagBits::eUniformBuffer |
+                    vk::BufferUsageFlagBits::eStorageBuffer)
+          .setSharingMode(vk::SharingMode::eExclusive));
+  memory = ctx.allocator.allocate(buffer.get(), BufferMemory::UNIFORM,
+                                  "frame_allocator");
+  ctx.device->bindBufferMemory(buffer.get(), memory.getMemory(),
+                               memory.getOffset());
+  NAME_OBJECT(ctx.device, buffer.get(), "frame_allocator_buffer");
+
+  pData = static_cast<char *>(memory.getMappedData());
+  assert(pData != nullptr);
+  frameBegin = 0;
+  head = 0;
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex) {
+  frameBegin = frameIndex * frameSize;
+  head.store(frameBegin, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameAllocator::allocate(vk::DeviceSize size) {
+  const auto aligned = alignUp(size, alignment);
+  // Only moves head once the allocation fits, so a failed one doesn't eat
+  // the rest of the frame
+  auto offset = head.load(std::memory_order_relaxed);
+  do {
+    if (offset + aligned > frameBegin + frameSize) {
+      throw std::runtime_error(
+          std::format("frame allocator is out of memory, {} bytes requested "
+                      "with {} of {} used this frame",
+                      size, offset - frameBegin, frameSize));
+    }
+  } while (!head.compare_exchange_weak(offset, offset + aligned,
+                                       std::memory_order_relaxed));
+  return FrameAllocation{
+      .buffer = buffer.get(),
+      .offset = static_cast<uint32_t>(offset),
+      .size = size,
+      .pData = pData + offset,
+  };
+}
+
+vk::DeviceSize FrameAllocator::getUsed() const {
+  return head.load(std::memory_order_relaxed) - frameBegin;
+}
+} // namespace Vulking
@@ -70,7 +70,7 @@ vk::AttachmentDescription ColorResolveAttachmentDescription(vk::Format format) {
       .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
       .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
       .setInitialLayout(vk::ImageLayout::eUndefined)
-      .setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+      .setFinalLayout(Engine::ctx().swapchain.presentLayout);
 }
 
 vk::UniqueDescriptorPool createDescriptorPool(
@@ -122,63 +122,72 @@ vk::UniqueSampler createSampler() {
   return Vulking::Engine::ctx().device->createSamplerUnique(info);
 }
 
-void copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width,
-                       uint32_t height) {
+void copyBufferToImage(vk::Buffer buffer, vk::DeviceSize bufferOffset,
+                       vk::Image image, uint32_t width, uint32_t height) {
   auto cmd = Engine::ctx().beginCommand("copy_buffer_to_image");
-  {
-    const auto region =
-        vk::BufferImageCopy()
-            .setImageSubresource(
-                vk::ImageSubresourceLayers()
-                    .setAspectMask(vk::ImageAspectFlagBits::eColor)
-                    .setLayerCount(1))
-            .setImageExtent({width, height, 1});
-
-    cmd.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal,
-                          region);
-  }
+  recordCopyBufferToImage(cmd, buffer, bufferOffset, image, width, height);
   Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd));
 }
 
+void recordCopyBufferToImage(vk::CommandBuffer cmd, vk::Buffer buffer,
+                             vk::DeviceSize bufferOffset, vk::Image image,
+                             uint32_t width, uint32_t height) {
+  const auto region =
+      vk::BufferImageCopy()
+          .setBufferOffset(bufferOffset)
+          .setImageSubresource(
+              vk::ImageSubresourceLayers()
+                  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                  .setLayerCount(1))
+          .setImageExtent({width, height, 1});
+
+  cmd.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal,
+                        region);
+}
+
 void transitionImageLayout(vk::Image image, vk::Format format,
                            uint32_t mipLevels, vk::ImageLayout from,
                            vk::ImageLayout to) {
   auto cmd = Engine::ctx().beginCommand("transition_layout");
   assert(cmd);
-  {
-    auto barrier = vk::ImageMemoryBarrier2KHR()
-                       .setOldLayout(from)
-                       .setNewLayout(to)
-                       .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
-                       .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
-                       .setImage(image)
-                       .setSubresourceRange(
-                           vk::ImageSubresourceRange()
-                               .setAspectMask(vk::ImageAspectFlagBits::eColor)
-                               .setLevelCount(mipLevels)
-                               .setLayerCount(1));
-
-    if (from == vk::ImageLayout::eUndefined &&
-        to == vk::ImageLayout::eTransferDstOptimal) {
-      barrier.setSrcAccessMask(vk::AccessFlagBits2::eNone)
-          .setDstAccessMask(vk::AccessFlagBits2::eTransferWrite)
-          .setSrcStageMask(vk::PipelineStageFlagBits2::eTopOfPipe)
-          .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer);
-    } else if (from == vk::ImageLayout::eTransferDstOptimal &&
-               to == vk::ImageLayout::eShaderReadOnlyOptimal) {
-      barrier.setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
-          .setDstAccessMask(vk::AccessFlagBits2::eShaderRead)
-          .setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
-          .setDstStageMask(vk::PipelineStageFlagBits2::eFragmentShader);
-    } else {
-      throw std::invalid_argument("unsupported layout transition");
-    }
+  recordTransitionImageLayout(cmd, image, format, mipLevels, from, to);
+  Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd));
+}
 
-    auto dependencyInfo =
-        vk::DependencyInfoKHR().setImageMemoryBarriers({barrier});
-    cmd.pipelineBarrier2(dependencyInfo, DYNAMIC_DISPATCHER);
+void recordTransitionImageLayout(vk::CommandBuffer cmd, vk::Image image,
+                                 vk::Format format, uint32_t mipLevels,
+                                 vk::ImageLayout from, vk::ImageLayout to) {
+  auto barrier = vk::ImageMemoryBarrier2KHR()
+                     .setOldLayout(from)
+                     .setNewLayout(to)
+                     .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                     .setImage(image)
+                     .setSubresourceRange(
+                         vk::ImageSubresourceRange()
+                             .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                             .setLevelCount(mipLevels)
+                             .setLayerCount(1));
+
+  if (from == vk::ImageLayout::eUndefined &&
+      to == vk::ImageLayout::eTransferDstOptimal) {
+    barrier.setSrcAccessMask(vk::AccessFlagBits2::eNone)
+        .setDstAccessMask(vk::AccessFlagBits2::eTransferWrite)
+        .setSrcStageMask(vk::PipelineStageFlagBits2::eTopOfPipe)
+        .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer);
+  } else if (from == vk::ImageLayout::eTransferDstOptimal &&
+             to == vk::ImageLayout::eShaderReadOnlyOptimal) {
+    barrier.setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+        .setDstAccessMask(vk::AccessFlagBits2::eShaderRead)
+        .setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+        .setDstStageMask(vk::PipelineStageFlagBits2::eFragmentShader);
+  } else {
+    throw std::invalid_argument("unsupported layout transition");
   }
-  Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd));
+
+  auto dependencyInfo =
+      vk::DependencyInfoKHR().setImageMemoryBarriers({barrier});
+  cmd.pipelineBarrier2(dependencyInfo, DYNAMIC_DISPATCHER);
 }
 
 // https://vulkan-tutorial.com/Generating_Mipmaps#page_Linear-filtering-support
@@ -189,6 +198,14 @@ void transitionImageLayout(vk::Image image, vk::Format format,
 void generateMipmaps(const vk::Image image, const vk::Format format,
                      const int32_t width, const int32_t height,
                      const uint32_t mipLevels) {
+  auto cmd = Engine::ctx().beginCommand("generate_mipmaps");
+  recordGenerateMipmaps(cmd, image, format, width, height, mipLevels);
+  Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd));
+}
+
+void recordGenerateMipmaps(vk::CommandBuffer cmd, const vk::Image image,
+                           const vk::Format format, const int32_t width,
+                           const int32_t height, const uint32_t mipLevels) {
   const auto formatProperties =
       Engine::ctx().physicalDevice.getFormatProperties(format);
 
@@ -197,7 +214,6 @@ void generateMipmaps(const vk::Image image, const vk::Format format,
     throw std::runtime_error("image format does not support linear blitting");
   }
 
-  auto cmd = Engine::ctx().beginCommand("generate_mipmaps");
   {
     auto barrier = vk::ImageMemoryBarrier2KHR()
                        .setImage(image)
@@ -289,7 +305,6 @@ void generateMipmaps(const vk::Image image, const vk::Format format,
     cmd.pipelineBarrier2KHR(dependencyInfo.setImageMemoryBarriers({barrier}),
                             DYNAMIC_DISPATCHER);
   }
-  Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd));
 }
 
 /* tuple(data, width, height) */
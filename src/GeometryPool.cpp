@@ -0,0 +1,122 @@
+#include "GeometryPool.hpp"
+
+#include "Buffer.hpp"
+#include "Engine.hpp"
+
+namespace Vulking {
+void GeometryRange::reset() {
+  if (pool) {
+    pool->free(*this);
+    pool = nullptr;
+  }
+}
+
+void GeometryPool::init(uint32_t vertexStride,
+                        vk::DeviceSize vertexCapacity,
+                        vk::DeviceSize indexCapacity) {
+  auto &ctx = Engine::ctx();
+  this->vertexStride = vertexStride;
+  // Whole vertices only, offsets into it are handed out in vertices
+  vertexCapacity = vertexCapacity / vertexStride * vertexStride;
+
+  vertexBuffer = ctx.device->createBufferUnique(
+      vk::BufferCreateInfo{}
+          .setSize(vertexCapacity)
+          .setUsage(BufferUsage::FINAL_VERTEX_BUFFER)
+          .setSharingMode(vk::SharingMode::eExclusive));
+  vertexMemory = ctx.allocator.allocate(vertexBuffer.get(), BufferMemory::FINAL,
+                                        "geometry_pool_vertices");
+  ctx.device->bindBufferMemory(vertexBuffer.get(), vertexMemory.getMemory(),
+                               vertexMemory.getOffset());
+  NAME_OBJECT(ctx.device, vertexBuffer.get(), "geometry_pool_vertex_buffer");
+
+  indexBuffer = ctx.device->createBufferUnique(
+      vk::BufferCreateInfo{}
+          .setSize(indexCapacity)
+          .setUsage(BufferUsage::FINAL_INDEX_BUFFER)
+          .setSharingMode(vk::SharingMode::eExclusive));
+  indexMemory = ctx.allocator.allocate(indexBuffer.get(), BufferMemory::FINAL,
+                                       "geometry_pool_indices");
+  ctx.device->bindBufferMemory(indexBuffer.get(), indexMemory.getMemory(),
+                               indexMemory.getOffset());
+  NAME_OBJECT(ctx.device, indexBuffer.get(), "geometry_pool_index_buffer");
+
+  vertexRanges = RangeAllocator(vertexCapacity);
+  indexRanges = RangeAllocator(indexCapacity);
+}
+
+GeometryRange GeometryPool::allocate(uint32_t vertexCount,
+                                     uint32_t indexCount,
+                                     vk::IndexType indexType) {
+  const vk::DeviceSize indexSize =
+      indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  const vk::DeviceSize vertexBytes = vk::DeviceSize{vertexCount} * vertexStride;
+  const vk::DeviceSize indexBytes = vk::DeviceSize{indexCount} * indexSize;
+  assert(vertexBytes != 0 && indexBytes != 0);
+
+  std::lock_guard lock(mutex);
+  reclaim();
+  const auto vertexByteOffset = vertexRanges.allocate(vertexBytes,
+                                                      vertexStride);
+  if (!vertexByteOffset) {
+    throw std::runtime_error(std::format(
+        "geometry pool is out of vertex memory, {} bytes requested with {} "
+        "of {} used",
+        vertexBytes, vertexRanges.getUsed(), vertexRanges.getSize()));
+  }
+  const auto indexByteOffset = indexRanges.allocate(indexBytes,
+                                                    INDEX_ALIGNMENT);
+  if (!indexByteOffset) {
+    vertexRanges.free(*vertexByteOffset);
+    throw std::runtime_error(std::format(
+        "geometry pool is out of index memory, {} bytes requested with {} of "
+        "{} used",
+        indexBytes, indexRanges.getUsed(), indexRanges.getSize()));
+  }
+
+  GeometryRange range;
+  range.pool = this;
+  range.vertexByteOffset = *vertexByteOffset;
+  range.indexByteOffset = *indexByteOffset;
+  range.vertexOffset = static_cast<int32_t>(*vertexByteOffset / vertexStride);
+  range.firstIndex = static_cast<uint32_t>(*indexByteOffset / indexSize);
+  return range;
+}
+
+void GeometryPool::bind(vk::CommandBuffer cmd, vk::IndexType indexType) const {
+  vk::Buffer vertexBuffers[] = {vertexBuffer.get()};
+  vk::DeviceSize offsets[] = {0};
+  cmd.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+  cmd.bindIndexBuffer(indexBuffer.get(), 0, indexType);
+}
+
+vk::DeviceSize GeometryPool::getVertexBytesUsed() const {
+  std::lock_guard lock(mutex);
+  return vertexRanges.getUsed();
+}
+
+vk::DeviceSize GeometryPool::getIndexBytesUsed() const {
+  std::lock_guard lock(mutex);
+  return indexRanges.getUsed();
+}
+
+void GeometryPool::free(const GeometryRange &range) {
+  std::lock_guard lock(mutex);
+  retired.push_back(Retired{
+      .vertexByteOffset = range.vertexByteOffset,
+      .indexByteOffset = range.indexByteOffset,
+      .frame = Engine::ctx().frame,
+  });
+}
+
+void GeometryPool::reclaim() {
+  // The frame a range was freed in may still draw it, see
+  // Context::completedFrames
+  const auto completed = Engine::ctx().completedFrames.load();
+  while (!retired.empty() && retired.front().frame < completed) {
+    vertexRanges.free(retired.front().vertexByteOffset);
+    indexRanges.free(retired.front().indexByteOffset);
+    retired.pop_front();
+  }
+}
+} // namespace Vulking
@@ -0,0 +1,219 @@
+#include "GpuProfiler.hpp"
+
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <ranges>
+
+namespace Vulking {
+void GpuProfiler::init(uint32_t framesInFlight) {
+  auto &ctx = Engine::ctx();
+  const auto limits = ctx.physicalDevice.getProperties().limits;
+  const auto family = ctx.physicalDevice.getQueueFamilyProperties().at(
+      ctx.graphicsQueueFamily);
+  supported = family.timestampValidBits != 0;
+  if (!supported) {
+    LOG_WARNING("graphics queue doesn't support timestamps, GPU profiling "
+                "is disabled");
+    return;
+  }
+  hostReset = ctx.hostQueryReset;
+  timestampPeriod = limits.timestampPeriod;
+  if (family.timestampValidBits < 64) {
+    timestampMask = (1ull << family.timestampValidBits) - 1;
+  }
+
+  frames = std::vector<Frame>(framesInFlight);
+  for (auto &&[i, frame] : std::ranges::views::enumerate(frames)) {
+    frame.pool = ctx.device->createQueryPoolUnique(
+        vk::QueryPoolCreateInfo{}
+            .setQueryType(vk::QueryType::eTimestamp)
+            .setQueryCount(MAX_SCOPES_PER_FRAME * 2));
+    NAME_OBJECT(ctx.device, frame.pool.get(),
+                std::format("gpu_profiler_queries_{}", i));
+    if (hostReset) {
+      ctx.device->resetQueryPool(frame.pool.get(), 0,
+                                 MAX_SCOPES_PER_FRAME * 2);
+    } else {
+      frame.pendingReset = MAX_SCOPES_PER_FRAME * 2;
+    }
+  }
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex, uint64_t frame) {
+  if (!supported) {
+    return;
+  }
+  this->frameIndex = frameIndex;
+  auto &current = frames[frameIndex];
+  collect(current);
+  current.frame = frame;
+}
+
+bool GpuProfiler::recordReset(vk::CommandBuffer cmd) {
+  if (!supported) {
+    return false;
+  }
+  auto &current = frames[frameIndex];
+  if (current.pendingReset == 0) {
+    return false;
+  }
+  cmd.resetQueryPool(current.pool.get(), 0, current.pendingReset);
+  current.pendingReset = 0;
+  return true;
+}
+
+GpuScopeId GpuProfiler::beginScope(vk::CommandBuffer cmd, const char *name,
+                                   vk::PipelineStageFlags2 stage) {
+  if (!supported) {
+    return {};
+  }
+  auto &frame = frames[frameIndex];
+  const auto scope = frame.scopeCount.fetch_add(1, std::memory_order_relaxed);
+  if (scope >= MAX_SCOPES_PER_FRAME) {
+    if (!overflowLogged.exchange(true)) {
+      LOG_WARNING("more than " << MAX_SCOPES_PER_FRAME
+                               << " GPU scopes in a frame, dropping the rest");
+    }
+    return {};
+  }
+  frame.names[scope] = name;
+  cmd.writeTimestamp2KHR(stage, frame.pool.get(), scope * 2,
+                         DYNAMIC_DISPATCHER);
+  return GpuScopeId{.value = scope};
+}
+
+void GpuProfiler::endScope(vk::CommandBuffer cmd, GpuScopeId scope,
+                           vk::PipelineStageFlags2 stage) {
+  if (scope.value == UINT32_MAX) {
+    return;
+  }
+  cmd.writeTimestamp2KHR(stage, frames[frameIndex].pool.get(),
+                         scope.value * 2 + 1, DYNAMIC_DISPATCHER);
+}
+
+void GpuProfiler::collect(Frame &frame) {
+  const auto count = std::min(frame.scopeCount.load(), MAX_SCOPES_PER_FRAME);
+  if (count == 0) {
+    return;
+  }
+
+  const auto device = Engine::ctx().device.get();
+  // value, availability pairs, so scopes from command buffers that were never
+  // submitted are skipped instead of waited on
+  std::vector<uint64_t> results(count * 2 * 2);
+  const auto result = device.getQueryPoolResults(
+      frame.pool.get(), 0, count * 2, results.size() * sizeof(uint64_t),
+      results.data(), sizeof(uint64_t) * 2,
+      vk::QueryResultFlagBits::e64 |
+          vk::QueryResultFlagBits::eWithAvailability);
+  if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+    CHK(result, "failed reading GPU timestamps");
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    for (uint32_t scope = 0; scope < count; scope++) {
+      const auto *begin = &results[scope * 4];
+      const auto *end = begin + 2;
+      if (begin[1] == 0 || end[1] == 0) {
+        continue;
+      }
+
+      const auto beginTicks = begin[0] & timestampMask;
+      const auto endTicks = end[0] & timestampMask;
+      const auto ticks = (endTicks - beginTicks) & timestampMask;
+      const auto ms = static_cast<double>(ticks) * timestampPeriod / 1e6;
+
+      auto &samples = history[frame.names[scope]];
+      samples.push_back(ms);
+      if (samples.size() > STATS_WINDOW) {
+        samples.pop_front();
+      }
+
+      events.push_back(Event{
+          .name = frame.names[scope],
+          .frame = frame.frame,
+          .begin = beginTicks,
+          .end = beginTicks + ticks,
+      });
+      if (events.size() > TRACE_EVENTS) {
+        events.pop_front();
+      }
+    }
+  }
+
+  if (hostReset) {
+    device.resetQueryPool(frame.pool.get(), 0, count * 2);
+  } else {
+    frame.pendingReset = std::max(frame.pendingReset, count * 2);
+  }
+  frame.scopeCount = 0;
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getStats() const {
+  std::lock_guard lock(mutex);
+  std::vector<GpuScopeStats> stats;
+  stats.reserve(history.size());
+  for (const auto &[name, samples] : history) {
+    if (samples.empty()) {
+      continue;
+    }
+    std::vector<double> sorted(samples.begin(), samples.end());
+    std::ranges::sort(sorted);
+    double sum = 0;
+    for (const auto ms : sorted) {
+      sum += ms;
+    }
+    const auto p99Index = static_cast<size_t>(sorted.size() * 0.99);
+    const auto p99 = sorted[std::min(sorted.size() - 1, p99Index)];
+    stats.push_back(GpuScopeStats{
+        .name = name,
+        .lastMs = samples.back(),
+        .minMs = sorted.front(),
+        .avgMs = sum / sorted.size(),
+        .p99Ms = p99,
+        .samples = sorted.size(),
+    });
+  }
+  return stats;
+}
+
+void GpuProfiler::logStats() const {
+  for (const auto &s : getStats()) {
+    LOG_INFO(std::format("gpu {:<24} last {:7.3f}ms  min {:7.3f}ms  avg "
+                         "{:7.3f}ms  p99 {:7.3f}ms  ({} samples)",
+                         s.name, s.lastMs, s.minMs, s.avgMs, s.p99Ms,
+                         s.samples));
+  }
+}
+
+void GpuProfiler::writeChromeTrace(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error(std::format("failed to open file '{}'", path));
+  }
+
+  std::lock_guard lock(mutex);
+  const auto origin =
+      events.empty() ? 0
+                     : std::ranges::min(events, {}, &Event::begin).begin;
+  const auto toUs = [&](uint64_t ticks) {
+    return static_cast<double>(ticks - origin) * timestampPeriod / 1e3;
+  };
+
+  file << "{\"traceEvents\":[\n";
+  file << R"({"name":"thread_name","ph":"M","pid":1,"tid":1,)"
+       << R"("args":{"name":"GPU graphics queue"}})";
+  for (const auto &event : events) {
+    file << std::format(",\n{{\"name\":\"{}\",\"cat\":\"gpu\",\"ph\":\"X\","
+                        "\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f},"
+                        "\"args\":{{\"frame\":{}}}}}",
+                        Profiler::escapeJson(event.name), toUs(event.begin),
+                        toUs(event.end) - toUs(event.begin), event.frame);
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  LOG_INFO("wrote " << events.size() << " GPU events to " << path);
+}
+} // namespace Vulking
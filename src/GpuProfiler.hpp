@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace Vulking {
+struct GpuScopeId {
+  uint32_t value = UINT32_MAX;
+};
+
+struct GpuScopeStats {
+  std::string name;
+  double lastMs;
+  double minMs;
+  double avgMs;
+  double p99Ms;
+  /* samples the above are computed over */
+  size_t samples;
+};
+
+/// Measures how long named scopes take on the GPU with timestamp queries.
+///
+/// Every frame in flight has its own query pool. Scopes get their queries
+/// from an atomic counter, so they can be opened on any command buffer from
+/// any thread, including secondaries recorded by ParallelRecorder. Results are
+/// read back when Context::beginRender has waited for the frame's fence, so
+/// reading them never stalls, and the pool is reset from the host right after.
+/// Without hostQueryReset the reset is recorded by recordReset instead, which
+/// Context::endRender submits ahead of the frame's commands.
+///
+/// Keeps a rolling window of durations per scope name for min/avg/p99, and
+/// the most recent events for writeChromeTrace.
+class GpuProfiler {
+public:
+  static constexpr uint32_t MAX_SCOPES_PER_FRAME = 256;
+  /* Samples per scope name the stats are computed over */
+  static constexpr size_t STATS_WINDOW = 256;
+  /* Events kept for the trace export */
+  static constexpr size_t TRACE_EVENTS = 16384;
+
+  GpuProfiler() = default;
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+  GpuProfiler(GpuProfiler &&) = delete;
+  GpuProfiler &operator=(GpuProfiler &&) = delete;
+
+  void init(uint32_t framesInFlight);
+
+  /* Called by Context::beginRender once the frame's fence has signaled.
+   * Collects that frame's previous results and resets its queries, or
+   * leaves that to recordReset. */
+  void beginFrame(uint32_t frameIndex, uint64_t frame);
+
+  /* Records the current frame's query reset into cmd when the device lacks
+   * hostQueryReset. cmd must run before any of the frame's scopes. Returns
+   * whether anything was recorded. */
+  bool recordReset(vk::CommandBuffer cmd);
+
+  /* name must outlive the frame, string literals are the intended use. The
+   * scope must be ended on the same command buffer. */
+  GpuScopeId beginScope(vk::CommandBuffer cmd, const char *name,
+                        vk::PipelineStageFlags2 stage =
+                            vk::PipelineStageFlagBits2::eTopOfPipe);
+  void endScope(vk::CommandBuffer cmd, GpuScopeId scope,
+                vk::PipelineStageFlags2 stage =
+                    vk::PipelineStageFlagBits2::eBottomOfPipe);
+
+  bool isSupported() const { return supported; }
+
+  std::vector<GpuScopeStats> getStats() const;
+  void logStats() const;
+
+  /* Writes the recent events as Chrome trace event JSON, loadable in
+   * chrome://tracing and Perfetto */
+  void writeChromeTrace(const std::string &path) const;
+
+private:
+  struct Frame {
+    vk::UniqueQueryPool pool;
+    std::atomic<uint32_t> scopeCount = 0;
+    std::array<const char *, MAX_SCOPES_PER_FRAME> names;
+    uint64_t frame = 0;
+    /* Queries recordReset still has to reset, without hostQueryReset */
+    uint32_t pendingReset = 0;
+  };
+
+  struct Event {
+    const char *name;
+    uint64_t frame;
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  void collect(Frame &frame);
+
+  bool supported = false;
+  bool hostReset = false;
+  /* ns per tick */
+  double timestampPeriod = 1.0;
+  uint64_t timestampMask = ~0ull;
+
+  std::vector<Frame> frames;
+  uint32_t frameIndex = 0;
+  std::atomic<bool> overflowLogged = false;
+
+  mutable std::mutex mutex;
+  std::map<std::string, std::deque<double>> history;
+  std::deque<Event> events;
+};
+
+/// Opens a GPU scope for as long as it lives
+class GpuScope {
+public:
+  GpuScope(GpuProfiler &profiler, vk::CommandBuffer cmd, const char *name)
+      : profiler(profiler), cmd(cmd), id(profiler.beginScope(cmd, name)) {}
+  GpuScope(const GpuScope &) = delete;
+  GpuScope &operator=(const GpuScope &) = delete;
+  ~GpuScope() { profiler.endScope(cmd, id); }
+
+private:
+  GpuProfiler &profiler;
+  vk::CommandBuffer cmd;
+  GpuScopeId id;
+};
+} // namespace Vulking
@@ -1,6 +1,5 @@
 #include "Image.hpp"
 
-#include "Buffer.hpp"
 #include "Common.hpp"
 #include "Engine.hpp"
 #include "Functions.hpp"
@@ -8,6 +7,26 @@
 #include <vulkan/vulkan_structs.hpp>
 
 namespace Vulking {
+Image::~Image() {
+  if (image) {
+    Engine::ctx().uploader.cancel(image.get());
+  }
+}
+
+Image &Image::operator=(Image &&other) noexcept {
+  if (this != &other) {
+    if (image) {
+      Engine::ctx().uploader.cancel(image.get());
+    }
+    image = std::move(other.image);
+    memory = std::move(other.memory);
+    mipLevels = other.mipLevels;
+    width = other.width;
+    height = other.height;
+  }
+  return *this;
+}
+
 Image::Image(vk::ImageCreateInfo info, vk::MemoryPropertyFlags memoryProperties,
              const char *name) {
   init(info, memoryProperties, name);
@@ -34,6 +53,14 @@ Image::Image(uint32_t width, uint32_t height, uint32_t mipLevels,
 
 Image::Image(const std::string &path, vk::SampleCountFlagBits samples,
              vk::Format format, const char *name) {
+  UploadBatch batch(std::format("{}_upload", name).c_str());
+  *this = Image(path, samples, format, batch, name);
+  batch.submit();
+}
+
+Image::Image(const std::string &path, vk::SampleCountFlagBits samples,
+             vk::Format format, UploadBatch &batch, const char *name) {
+  PROFILE_ZONE("Image::Image");
   // loading and mipmapping should be separated into their own functions or
   // something loading should probably go in Common.hpp or Util.hpp
   const auto [data, width, height] = loadRgba8888Texture(path.c_str());
@@ -55,16 +82,9 @@ Image::Image(const std::string &path, vk::SampleCountFlagBits samples,
           .setSharingMode(vk::SharingMode::eExclusive);
   init(info, vk::MemoryPropertyFlagBits::eDeviceLocal, name);
 #undef Usage
-  Buffer<char> buffer(data, BufferUsage::STAGING, BufferMemory::STAGING);
 
-  transitionImageLayout(image.get(), format, mipLevels,
-                        vk::ImageLayout::eUndefined,
-                        vk::ImageLayout::eTransferDstOptimal);
-  copyBufferToImage(buffer.getBuffer(), image.get(), width, height);
-  // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating
-  // mipmaps
-  generateMipmaps(image.get(), format, static_cast<int32_t>(width),
-                  static_cast<int32_t>(height), mipLevels);
+  batch.copyToImage(data.data(), data.size(), image.get(), format, width,
+                    height, mipLevels);
 }
 
 void Image::init(vk::ImageCreateInfo info,
@@ -72,19 +92,11 @@ void Image::init(vk::ImageCreateInfo info,
   image = Engine::ctx().device->createImageUnique(info);
   NAME_OBJECT(Engine::ctx().device, image.get(), name);
 
-  auto memoryRequirements =
-      Engine::ctx().device->getImageMemoryRequirements(image.get());
-
-  vk::MemoryAllocateInfo allocInfo;
-  allocInfo.setAllocationSize(memoryRequirements.size);
-  allocInfo.setMemoryTypeIndex(findMemoryType(Engine::ctx().physicalDevice,
-                                              memoryRequirements.memoryTypeBits,
-                                              memoryProperties));
-
-  memory = Engine::ctx().device->allocateMemoryUnique(allocInfo);
-  NAME_OBJECT(Engine::ctx().device, memory.get(), name);
+  memory = Engine::ctx().allocator.allocate(image.get(), info.tiling,
+                                            memoryProperties, name);
 
-  Engine::ctx().device->bindImageMemory(image.get(), memory.get(), 0);
+  Engine::ctx().device->bindImageMemory(image.get(), memory.getMemory(),
+                                        memory.getOffset());
   mipLevels = info.mipLevels;
   width = info.extent.width;
   height = info.extent.height;
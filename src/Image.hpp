@@ -1,6 +1,8 @@
 #pragma once
 
+#include "Allocator.hpp"
 #include "Common.hpp"
+#include "UploadBatch.hpp"
 
 namespace Vulking {
 class Image {
@@ -8,25 +10,22 @@ public:
   Image(const Image &) = delete;
   Image &operator=(const Image &) = delete;
   Image(Image &&other) noexcept
-      : image(std::move(other.image)), memory(std::move(other.memory)),
+      : memory(std::move(other.memory)), image(std::move(other.image)),
         mipLevels(other.mipLevels), width(other.width), height(other.height) {}
-  Image &operator=(Image &&other) noexcept {
-    if (this != &other) {
-      image = std::move(other.image);
-      memory = std::move(other.memory);
-      mipLevels = other.mipLevels;
-      width = other.width;
-      height = other.height;
-    }
-    return *this;
-  }
+  Image &operator=(Image &&other) noexcept;
 
   Image() = default;
+  /* Cancels any AsyncUploader acquire still pending for the image */
+  ~Image();
   Image(vk::ImageCreateInfo info, vk::MemoryPropertyFlags memoryProperties,
         const char *name = "unnamed");
 
   Image(const std::string &path, vk::SampleCountFlagBits samples,
         vk::Format format, const char *name = "unnamed");
+  /* Records the upload into batch instead of submitting it right away. The
+   * image is ready once the batch has been submitted. */
+  Image(const std::string &path, vk::SampleCountFlagBits samples,
+        vk::Format format, UploadBatch &batch, const char *name = "unnamed");
 
   Image(uint32_t width, uint32_t height, uint32_t mipLevels,
         vk::SampleCountFlagBits samples, vk::Format format,
@@ -37,8 +36,10 @@ public:
   uint32_t getWidth() const { return width; }
   uint32_t getHeight() const { return height; }
 
+  // memory before image, so the image is destroyed before its memory is
+  // handed back to the allocator
+  Allocation memory;
   vk::UniqueImage image;
-  vk::UniqueDeviceMemory memory;
 
 private:
   void init(vk::ImageCreateInfo info, vk::MemoryPropertyFlags memoryProperties,
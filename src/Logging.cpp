@@ -0,0 +1,520 @@
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace Vulking {
+namespace {
+constexpr std::array<const char *, 6> LEVEL_TAGS = {
+    "[trce]", "[dbug]", "[info]", "[warn]", "[erro]", "[off ]",
+};
+
+LogRule getDefaultRule() {
+#ifdef NDEBUG
+  return LogRule{.module = "", .level = LogLevel::Info};
+#else
+  return LogRule{.module = "", .level = LogLevel::Trace};
+#endif
+}
+
+std::string_view trim(std::string_view text) {
+  const auto begin = text.find_first_not_of(" \t");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+LogLevel parseLevel(std::string_view name) {
+  constexpr std::array<std::pair<std::string_view, LogLevel>, 7> LEVELS = {{
+      {"trace", LogLevel::Trace},
+      {"debug", LogLevel::Debug},
+      {"info", LogLevel::Info},
+      {"warn", LogLevel::Warning},
+      {"warning", LogLevel::Warning},
+      {"error", LogLevel::Error},
+      {"off", LogLevel::Off},
+  }};
+  for (const auto &[levelName, level] : LEVELS) {
+    if (name == levelName) {
+      return level;
+    }
+  }
+  throw std::runtime_error(std::format("unknown log level '{}'", name));
+}
+
+uint32_t parseCount(std::string_view text) {
+  text = trim(text);
+  uint32_t value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size()) {
+    throw std::runtime_error(std::format("invalid log rule count '{}'", text));
+  }
+  return value;
+}
+
+/* User code compiles the engine's headers from their copies in
+ * includes/vulking/, the engine from src/. Both are matched as src/. */
+std::string normalizeModule(std::string_view module) {
+  constexpr std::string_view INSTALLED = "includes/vulking/";
+  if (module.starts_with(INSTALLED)) {
+    return "src/" + std::string(module.substr(INSTALLED.size()));
+  }
+  return std::string(module);
+}
+
+void upsertRule(std::vector<LogRule> &rules, LogRule rule) {
+  rule.module = normalizeModule(rule.module);
+  const auto existing = std::ranges::find(rules, rule.module, &LogRule::module);
+  if (existing != rules.end()) {
+    *existing = rule;
+  } else {
+    rules.push_back(rule);
+  }
+}
+
+std::vector<LogRule> parseSpec(std::string_view spec) {
+  std::vector<LogRule> rules = {getDefaultRule()};
+  while (!spec.empty()) {
+    const auto comma = spec.find(',');
+    auto entry = trim(spec.substr(0, comma));
+    spec = comma == std::string_view::npos ? std::string_view{}
+                                           : spec.substr(comma + 1);
+    if (entry.empty()) {
+      continue;
+    }
+
+    LogRule rule{};
+    if (const auto equals = entry.find('='); equals != entry.npos) {
+      rule.module = trim(entry.substr(0, equals));
+      entry = entry.substr(equals + 1);
+    }
+    if (const auto percent = entry.find('%'); percent != entry.npos) {
+      rule.sampleEvery = parseCount(entry.substr(percent + 1));
+      if (rule.sampleEvery == 0) {
+        throw std::runtime_error("log sampling must keep one in at least 1");
+      }
+      entry = entry.substr(0, percent);
+    }
+    if (const auto slash = entry.find('/'); slash != entry.npos) {
+      rule.maxPerSecond = parseCount(entry.substr(slash + 1));
+      entry = entry.substr(0, slash);
+    }
+    rule.level = parseLevel(trim(entry));
+    upsertRule(rules, rule);
+  }
+  return rules;
+}
+
+/// Rules and every site reached so far
+struct Registry {
+  Registry() {
+    rules = {getDefaultRule()};
+    if (const auto *spec = std::getenv("VULKING_LOG")) {
+      try {
+        rules = parseSpec(spec);
+      } catch (const std::exception &e) {
+        // Logging from here would resolve a site against us mid-construction
+        std::cerr << "ignoring VULKING_LOG: " << e.what() << "\n";
+      }
+    }
+  }
+
+  static Registry &get() {
+    // Leaked for the same reason as Backend
+    static Registry *registry = new Registry();
+    return *registry;
+  }
+
+  std::mutex mutex;
+  std::vector<LogRule> rules;
+  LogSite *sites = nullptr;
+};
+
+/* How often the logging thread drains the rings when nobody asks it to */
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(5);
+
+struct RecordHeader {
+  const LogSite *site;
+  uint64_t time;
+  uint32_t size;
+};
+
+/// Single producer, single consumer byte ring. head and tail only ever grow
+/// and are masked on access.
+struct Ring {
+  static constexpr uint64_t CAPACITY = 1 << 18;
+
+  void copyIn(uint64_t at, const void *src, size_t size) {
+    const auto offset = at & (CAPACITY - 1);
+    const auto first = std::min<size_t>(size, CAPACITY - offset);
+    const auto *bytes = static_cast<const std::byte *>(src);
+    std::memcpy(&data[offset], bytes, first);
+    std::memcpy(&data[0], bytes + first, size - first);
+  }
+
+  void copyOut(uint64_t at, void *dst, size_t size) const {
+    const auto offset = at & (CAPACITY - 1);
+    const auto first = std::min<size_t>(size, CAPACITY - offset);
+    auto *bytes = static_cast<std::byte *>(dst);
+    std::memcpy(bytes, &data[offset], first);
+    std::memcpy(bytes + first, &data[0], size - first);
+  }
+
+  std::unique_ptr<std::byte[]> data =
+      std::make_unique_for_overwrite<std::byte[]>(CAPACITY);
+  /* Written by the owning thread */
+  alignas(64) std::atomic<uint64_t> head = 0;
+  /* Written by the logging thread */
+  alignas(64) std::atomic<uint64_t> tail = 0;
+  /* Rings of exited threads are handed to new ones */
+  std::atomic<bool> owned = true;
+};
+
+struct Pending {
+  uint64_t time;
+  const LogSite *site;
+  size_t offset;
+  uint32_t size;
+};
+
+class Backend {
+public:
+  Backend() {
+    consumer = std::thread([this] { run(); });
+    std::atexit([] { get().stop(); });
+  }
+
+  static Backend &get() {
+    // Leaked, records logged from static destructors still need it
+    static Backend *backend = new Backend();
+    return *backend;
+  }
+
+  void write(const LogSite *site, const std::byte *args, size_t size) {
+    const RecordHeader header{
+        .site = site,
+        .time = static_cast<uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count()),
+        .size = static_cast<uint32_t>(size),
+    };
+    const auto needed = sizeof(header) + size;
+    if (needed > Ring::CAPACITY / 2) {
+      // Would starve the ring, keep the order and write it from here
+      flush();
+      writeNow(*site, args, size);
+      return;
+    }
+
+    auto &ring = getThreadRing();
+    const auto head = ring.head.load(std::memory_order_relaxed);
+    auto tail = ring.tail.load(std::memory_order_acquire);
+    while (Ring::CAPACITY - (head - tail) < needed) {
+      if (stopped.load(std::memory_order_acquire)) {
+        writeNow(*site, args, size);
+        return;
+      }
+      wake.notify_one();
+      std::this_thread::yield();
+      tail = ring.tail.load(std::memory_order_acquire);
+    }
+    if (stopped.load(std::memory_order_acquire)) {
+      writeNow(*site, args, size);
+      return;
+    }
+
+    ring.copyIn(head, &header, sizeof(header));
+    ring.copyIn(head + sizeof(header), args, size);
+    ring.head.store(head + needed, std::memory_order_release);
+
+    if (head + needed - tail > Ring::CAPACITY / 2) {
+      wake.notify_one();
+    }
+    if (site->level >= LogLevel::Error) {
+      flush();
+    }
+  }
+
+  void flush() {
+    std::unique_lock lock(mutex);
+    if (stopping) {
+      return;
+    }
+    const auto request = ++flushRequested;
+    wake.notify_one();
+    flushed.wait(lock, [&] { return flushCompleted >= request; });
+  }
+
+  void setOutput(std::ostream &stream) {
+    flush();
+    std::lock_guard lock(outputMutex);
+    output = &stream;
+  }
+
+private:
+  struct RingHandle {
+    Ring *ring = nullptr;
+    ~RingHandle() {
+      if (ring) {
+        ring->owned.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  Ring &getThreadRing() {
+    thread_local RingHandle handle;
+    if (!handle.ring) {
+      std::lock_guard lock(mutex);
+      for (const auto &ring : rings) {
+        if (!ring->owned.exchange(true, std::memory_order_acq_rel)) {
+          handle.ring = ring.get();
+          break;
+        }
+      }
+      if (!handle.ring) {
+        handle.ring = rings.emplace_back(std::make_unique<Ring>()).get();
+      }
+    }
+    return *handle.ring;
+  }
+
+  void writeNow(const LogSite &site, const std::byte *args, size_t size) {
+    std::lock_guard lock(outputMutex);
+    Logger::format(*output, site, args, size);
+    output->flush();
+  }
+
+  void run() {
+    std::vector<Pending> pending;
+    std::vector<std::byte> bytes;
+    std::unique_lock lock(mutex);
+    while (true) {
+      wake.wait_for(lock, DRAIN_INTERVAL, [&] {
+        return stopping || flushRequested != flushCompleted;
+      });
+      const auto request = flushRequested;
+      const auto stop = stopping;
+
+      collect(pending, bytes);
+      lock.unlock();
+      writePending(pending, bytes);
+      lock.lock();
+
+      flushCompleted = request;
+      flushed.notify_all();
+      if (stop) {
+        return;
+      }
+    }
+  }
+
+  void writePending(std::vector<Pending> &pending,
+                    std::vector<std::byte> &bytes) {
+    if (pending.empty()) {
+      return;
+    }
+    // Rings are drained one after another, interleave them again
+    std::ranges::stable_sort(pending, {}, &Pending::time);
+    std::lock_guard lock(outputMutex);
+    for (const auto &record : pending) {
+      Logger::format(*output, *record.site, bytes.data() + record.offset,
+                     record.size);
+    }
+    output->flush();
+    pending.clear();
+    bytes.clear();
+  }
+
+  /* Copies every published record out and frees its ring space */
+  void collect(std::vector<Pending> &pending, std::vector<std::byte> &bytes) {
+    for (const auto &ring : rings) {
+      auto tail = ring->tail.load(std::memory_order_relaxed);
+      const auto head = ring->head.load(std::memory_order_acquire);
+      while (tail < head) {
+        RecordHeader header;
+        ring->copyOut(tail, &header, sizeof(header));
+        const auto offset = bytes.size();
+        bytes.resize(offset + header.size);
+        ring->copyOut(tail + sizeof(header), bytes.data() + offset,
+                      header.size);
+        pending.push_back(Pending{
+            .time = header.time,
+            .site = header.site,
+            .offset = offset,
+            .size = header.size,
+        });
+        tail += sizeof(header) + header.size;
+      }
+      ring->tail.store(tail, std::memory_order_release);
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    consumer.join();
+    // From here on records are written as they come. Pick up whatever raced
+    // the last drain.
+    stopped.store(true, std::memory_order_release);
+    std::vector<Pending> pending;
+    std::vector<std::byte> bytes;
+    {
+      std::lock_guard lock(mutex);
+      collect(pending, bytes);
+    }
+    writePending(pending, bytes);
+  }
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable flushed;
+  std::vector<std::unique_ptr<Ring>> rings;
+  uint64_t flushRequested = 0;
+  uint64_t flushCompleted = 0;
+  bool stopping = false;
+  std::atomic<bool> stopped = false;
+  std::thread consumer;
+
+  std::mutex outputMutex;
+  std::ostream *output = &std::cout;
+};
+
+template <typename T> T read(const std::byte *args, size_t &at) {
+  T value;
+  std::memcpy(&value, args + at, sizeof(T));
+  at += sizeof(T);
+  return value;
+}
+} // namespace
+
+void Logger::write(const LogSite *site, const std::byte *args, size_t size) {
+  Backend::get().write(site, args, size);
+}
+
+void Logger::flush() { Backend::get().flush(); }
+
+void Logger::setOutput(std::ostream &output) {
+  Backend::get().setOutput(output);
+}
+
+void Logger::configure(std::string_view spec) {
+  auto rules = parseSpec(spec);
+  auto &registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  registry.rules = std::move(rules);
+  generation.fetch_add(1, std::memory_order_release);
+}
+
+void Logger::setRule(const LogRule &rule) {
+  if (rule.sampleEvery == 0) {
+    throw std::runtime_error("log sampling must keep one in at least 1");
+  }
+  auto &registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  upsertRule(registry.rules, rule);
+  generation.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<const LogSite *> Logger::getSites() {
+  auto &registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  std::vector<const LogSite *> sites;
+  for (auto *site = registry.sites; site; site = site->next) {
+    sites.push_back(site);
+  }
+  return sites;
+}
+
+void Logger::resolve(LogSite &site) {
+  auto &registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  const auto current = generation.load(std::memory_order_acquire);
+  if (site.generation.load(std::memory_order_relaxed) == 0) {
+    site.next = registry.sites;
+    registry.sites = &site;
+  }
+
+  const auto module = normalizeModule(site.prefix);
+  const LogRule *best = nullptr;
+  for (const auto &rule : registry.rules) {
+    if (module.starts_with(rule.module) &&
+        (!best || rule.module.size() > best->module.size())) {
+      best = &rule;
+    }
+  }
+  const auto rule = best ? *best : getDefaultRule();
+  site.enabled.store(site.level >= rule.level, std::memory_order_relaxed);
+  site.maxPerSecond.store(rule.maxPerSecond, std::memory_order_relaxed);
+  site.sampleEvery.store(rule.sampleEvery, std::memory_order_relaxed);
+  site.generation.store(current, std::memory_order_release);
+}
+
+bool Logger::admit(LogSite &site) {
+  const auto second = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  auto window = site.window.load(std::memory_order_relaxed);
+  if (window != second &&
+      site.window.compare_exchange_strong(window, second,
+                                          std::memory_order_relaxed)) {
+    site.windowCount.store(0, std::memory_order_relaxed);
+  }
+  if (site.windowCount.fetch_add(1, std::memory_order_relaxed) <
+      site.maxPerSecond.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  site.suppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void Logger::format(std::ostream &output, const LogSite &site,
+                    const std::byte *args, size_t size) {
+  output << site.prefix << LEVEL_TAGS[static_cast<size_t>(site.level)]
+         << ": ";
+  size_t at = 0;
+  while (at < size) {
+    switch (read<LogArg>(args, at)) {
+    case LogArg::Bool:
+      output << read<bool>(args, at);
+      break;
+    case LogArg::Char:
+      output << read<char>(args, at);
+      break;
+    case LogArg::Int:
+      output << read<int64_t>(args, at);
+      break;
+    case LogArg::Uint:
+      output << read<uint64_t>(args, at);
+      break;
+    case LogArg::Float:
+      output << read<double>(args, at);
+      break;
+    case LogArg::Pointer:
+      output << read<const void *>(args, at);
+      break;
+    case LogArg::String: {
+      const auto length = read<uint32_t>(args, at);
+      output.write(reinterpret_cast<const char *>(args + at), length);
+      at += length;
+      break;
+    }
+    }
+  }
+  output << "\n";
+}
+} // namespace Vulking
@@ -0,0 +1,85 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Vulking {
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path &path) {
+  const auto file =
+      CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error(
+        std::format("failed to open file '{}'", path.string()));
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(file, &fileSize);
+  length = static_cast<size_t>(fileSize.QuadPart);
+  if (length != 0) {
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+      bytes = static_cast<const std::byte *>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+  }
+  CloseHandle(file);
+  if (length != 0 && !bytes) {
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    throw std::runtime_error(
+        std::format("failed to map file '{}'", path.string()));
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (bytes) {
+    UnmapViewOfFile(bytes);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path &path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(
+        std::format("failed to open file '{}'", path.string()));
+  }
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error(
+        std::format("failed to stat file '{}'", path.string()));
+  }
+  length = static_cast<size_t>(info.st_size);
+  if (length != 0) {
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error(
+          std::format("failed to map file '{}'", path.string()));
+    }
+    bytes = static_cast<const std::byte *>(address);
+  }
+  // The mapping keeps the file alive
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (bytes) {
+    munmap(const_cast<std::byte *>(bytes), length);
+  }
+}
+#endif
+} // namespace Vulking
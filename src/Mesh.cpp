@@ -1,6 +1,10 @@
 #include "Mesh.hpp"
 #include "Buffer.hpp"
+#include "Engine.hpp"
 #include "Functions.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "ObjParser.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -12,9 +16,15 @@ static void loadModel(const std::string &path,
 
 Mesh::Mesh() {}
 
-Mesh::Mesh(const std::string &path, const char *name) {
-  loadModel(path, cpuVertices, cpuIndices);
-  init(name);
+Mesh::Mesh(const std::string &path, const char *name,
+           const MeshOptimization &optimization) {
+  UploadBatch batch(std::format("{}_upload", name).c_str());
+  load(path, batch, name, optimization);
+}
+
+Mesh::Mesh(const std::string &path, UploadBatch &batch, const char *name,
+           const MeshOptimization &optimization) {
+  load(path, batch, name, optimization);
 }
 
 Mesh::Mesh(const std::vector<Vertex> &vertices,
@@ -23,6 +33,69 @@ Mesh::Mesh(const std::vector<Vertex> &vertices,
   cpuIndices = indices;
 }
 
+Mesh::Bounds Mesh::computeBounds(std::span<const Vertex> vertices) {
+  if (vertices.empty()) {
+    return {};
+  }
+  Bounds bounds{vertices[0].pos, vertices[0].pos};
+  for (const auto &vertex : vertices) {
+    bounds.min = glm::min(bounds.min, vertex.pos);
+    bounds.max = glm::max(bounds.max, vertex.pos);
+  }
+  return bounds;
+}
+
+Mesh::PackedVertex
+Mesh::PackedVertex::pack(const Vertex &vertex,
+                         const VertexQuantization &quantization) {
+  return {
+      Snorm16x4::pack(glm::vec4(quantization.quantize(vertex.pos), 0.0f)),
+      Unorm8x4::pack(glm::vec4(vertex.color, 1.0f)),
+      Half2::pack(vertex.texCoord),
+  };
+}
+
+Mesh::Vertex
+Mesh::PackedVertex::unpack(const VertexQuantization &quantization) const {
+  return {
+      quantization.dequantize(glm::vec3(pos.unpack())),
+      glm::vec3(color.unpack()),
+      texCoord.unpack(),
+  };
+}
+
+vk::IndexType Mesh::getIndexType(size_t vertexCount) {
+  // 0xffff is left out, it restarts primitives when restart is enabled
+  return vertexCount <= UINT16_MAX ? vk::IndexType::eUint16
+                                   : vk::IndexType::eUint32;
+}
+
+Mesh::Packed Mesh::pack(std::span<const Vertex> vertices,
+                        std::span<const Index> indices) {
+  PROFILE_FUNCTION();
+  Packed packed;
+  packed.bounds = computeBounds(vertices);
+  packed.quantization =
+      VertexQuantization::fromBounds(packed.bounds.min, packed.bounds.max);
+  packed.vertices.reserve(vertices.size());
+  for (const auto &vertex : vertices) {
+    packed.vertices.push_back(PackedVertex::pack(vertex, packed.quantization));
+  }
+
+  packed.indexType = getIndexType(vertices.size());
+  if (packed.indexType == vk::IndexType::eUint16) {
+    packed.indices.resize(indices.size() * sizeof(uint16_t));
+    auto *narrow = reinterpret_cast<uint16_t *>(packed.indices.data());
+    for (size_t i = 0; i < indices.size(); i++) {
+      narrow[i] = static_cast<uint16_t>(indices[i]);
+    }
+  } else {
+    packed.indices.resize(indices.size_bytes());
+    std::memcpy(packed.indices.data(), indices.data(), indices.size_bytes());
+  }
+  return packed;
+}
+
 void Mesh::releaseCPUResources() {
   cpuVertices.clear();
   cpuVertices.shrink_to_fit();
@@ -31,37 +104,79 @@ void Mesh::releaseCPUResources() {
 }
 
 void Mesh::bind(vk::CommandBuffer cmd) {
-  vk::Buffer vertexBuffers[] = {vertices.getBuffer()};
-  vk::DeviceSize offsets[] = {0};
-  cmd.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-  cmd.bindIndexBuffer(indices.getBuffer(), 0, IndexType);
+  Engine::ctx().geometry.bind(cmd, indexType);
 }
 
-void Mesh::init(const char *name) {
-  numVertices = static_cast<uint32_t>(cpuVertices.size());
-  numIndices = static_cast<uint32_t>(cpuIndices.size());
+vk::DrawIndexedIndirectCommand
+Mesh::getDrawCommand(uint32_t instanceCount, uint32_t firstInstance) const {
+  return vk::DrawIndexedIndirectCommand{}
+      .setIndexCount(numIndices)
+      .setInstanceCount(instanceCount)
+      .setFirstIndex(getFirstIndex())
+      .setVertexOffset(getVertexOffset())
+      .setFirstInstance(firstInstance);
+}
+
+void Mesh::load(const std::string &path, UploadBatch &batch, const char *name,
+                const MeshOptimization &optimization) {
+  PROFILE_FUNCTION();
+  std::unique_ptr<MeshCache> cache;
+  try {
+    cache = MeshCache::open(path, optimization);
+  } catch (const std::exception &e) {
+    LOG_WARNING("failed reading mesh cache for " << path << ": " << e.what()
+                                                 << ", importing it again");
+  }
+  if (cache) {
+    // Straight from the mapping into the staging ring, the data never
+    // passes through cpuVertices and cpuIndices
+    bounds = cache->getBounds();
+    quantization = cache->getQuantization();
+    upload(batch, cache->getVertices(), cache->getIndexData(),
+           cache->getIndexType(), name);
+    return;
+  }
+
+  loadModel(path, cpuVertices, cpuIndices);
+  optimizeMesh(cpuVertices, cpuIndices, optimization);
+  const auto packed = pack(cpuVertices, cpuIndices);
+  try {
+    MeshCache::write(path, optimization, packed);
+  } catch (const std::exception &e) {
+    LOG_WARNING("failed saving mesh cache for " << path << ": " << e.what());
+  }
+  bounds = packed.bounds;
+  quantization = packed.quantization;
+  upload(batch, packed.vertices, packed.indices, packed.indexType, name);
+}
+
+void Mesh::upload(UploadBatch &batch, std::span<const PackedVertex> vertexData,
+                  std::span<const std::byte> indexData, vk::IndexType type,
+                  const char *name) {
+  indexType = type;
+  numVertices = static_cast<uint32_t>(vertexData.size());
+  numIndices = static_cast<uint32_t>(
+      indexData.size() /
+      (type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)));
   assert(numVertices != 0);
   assert(numIndices != 0);
-  auto verticesStaging =
-      Buffer<Vertex>(cpuVertices, BufferUsage::STAGING, BufferMemory::STAGING,
-                     std::format("{}_vertex_staging", name).c_str());
-  vertices = Buffer<Vertex>(
-      verticesStaging.getSize(), BufferUsage::FINAL_VERTEX_BUFFER,
-      BufferMemory::FINAL, std::format("{}_vertex", name).c_str());
-  verticesStaging.copyTo(vertices);
-
-  auto indicesStaging =
-      Buffer<Index>(cpuIndices, BufferUsage::STAGING, BufferMemory::STAGING,
-                    std::format("{}_index_staging", name).c_str());
-  indices =
-      Buffer<Index>(indicesStaging.getSize(), BufferUsage::FINAL_INDEX_BUFFER,
-                    BufferMemory::FINAL, std::format("{}_index", name).c_str());
-  indicesStaging.copyTo(indices);
+  auto &pool = Engine::ctx().geometry;
+  geometry = pool.allocate(numVertices, numIndices, type);
+  LOG_DEBUG("mesh " << name << " at vertex " << geometry.getVertexOffset()
+                    << ", index " << geometry.getFirstIndex()
+                    << " of the geometry pool");
+
+  batch.copyToBuffer(vertexData.data(), vertexData.size_bytes(),
+                     pool.getVertexBuffer(), geometry.getVertexByteOffset());
+  batch.copyToBuffer(indexData.data(), indexData.size_bytes(),
+                     pool.getIndexBuffer(), geometry.getIndexByteOffset());
 }
 
-static void loadModel(const std::string &path,
-                      std::vector<Mesh::Vertex> &vertices,
-                      std::vector<Mesh::Index> &indices) {
+/* Reference loader, used for what parseObj doesn't triangulate itself */
+static void loadModelTinyObj(const std::string &path,
+                             std::vector<Mesh::Vertex> &vertices,
+                             std::vector<Mesh::Index> &indices) {
+  PROFILE_ZONE("loadModelTinyObj");
   vertices.clear();
   indices.clear();
   tinyobj::attrib_t attrib;
@@ -101,4 +216,20 @@ static void loadModel(const std::string &path,
     }
   }
 }
+
+/* Also safe from the engine's workers, parseObj then runs on the caller */
+static void loadModel(const std::string &path,
+                      std::vector<Mesh::Vertex> &vertices,
+                      std::vector<Mesh::Index> &indices) {
+  PROFILE_ZONE("loadModel");
+  auto mesh = loadObj(path, Engine::ctx().workers);
+  if (!mesh) {
+    LOG_WARNING(path << " has faces with more than 4 corners, loading it "
+                        "with tinyobj");
+    loadModelTinyObj(path, vertices, indices);
+    return;
+  }
+  vertices = std::move(mesh->vertices);
+  indices = std::move(mesh->indices);
+}
 } // namespace Vulking
@@ -2,50 +2,43 @@
 
 #include "Buffer.hpp"
 #include "Common.hpp"
+#include "GeometryPool.hpp"
+#include "UploadBatch.hpp"
+#include "VertexLayout.hpp"
+
+#include <span>
 
 namespace Vulking {
+/* Passes Mesh runs on imported geometry, see MeshOptimizer.hpp */
+struct MeshOptimization {
+  bool vertexCache = true;
+  /* Trades a little of vertexCache's gain for less overdraw */
+  bool overdraw = false;
+  bool vertexFetch = true;
+
+  /* For MeshCache to tell meshes imported with different options apart */
+  uint32_t getFlags() const {
+    return (vertexCache ? 1u : 0u) | (overdraw ? 2u : 0u) |
+           (vertexFetch ? 4u : 0u);
+  }
+};
+
 class Mesh {
 public:
+  /* What importing produces, at full precision */
   using Index = uint32_t;
-  vk::IndexType IndexType = vk::IndexType::eUint32;
 
   struct Vertex {
     glm::vec3 pos;
     glm::vec3 color;
     glm::vec2 texCoord;
 
-    static vk::VertexInputBindingDescription getBindingDescription() {
-      auto bindingDescription = vk::VertexInputBindingDescription{}
-                                    .setBinding(0)
-                                    .setStride(sizeof(Vertex))
-                                    .setInputRate(vk::VertexInputRate::eVertex);
-
-      return bindingDescription;
-    }
-
-    static std::vector<vk::VertexInputAttributeDescription>
-    getAttributeDescriptions() {
-      auto vec3 = vk::Format::eR32G32B32Sfloat;
-      auto vec2 = vk::Format::eR32G32Sfloat;
-      std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(3);
-
-      attributeDescriptions[0] = vk::VertexInputAttributeDescription()
-                                     .setBinding(0)
-                                     .setLocation(0)
-                                     .setFormat(vec3)
-                                     .setOffset(offsetof(Vertex, pos));
-      attributeDescriptions[1] = vk::VertexInputAttributeDescription()
-                                     .setBinding(0)
-                                     .setLocation(1)
-                                     .setFormat(vec3)
-                                     .setOffset(offsetof(Vertex, color));
-      attributeDescriptions[2] = vk::VertexInputAttributeDescription()
-                                     .setBinding(0)
-                                     .setLocation(2)
-                                     .setFormat(vec2)
-                                     .setOffset(offsetof(Vertex, texCoord));
-
-      return attributeDescriptions;
+    static constexpr auto getAttributes() {
+      return std::array{
+          vertexAttribute<decltype(pos)>(0, offsetof(Vertex, pos)),
+          vertexAttribute<decltype(color)>(1, offsetof(Vertex, color)),
+          vertexAttribute<decltype(texCoord)>(2, offsetof(Vertex, texCoord)),
+      };
     }
 
     bool operator==(const Vertex &other) const {
@@ -54,28 +47,97 @@ public:
     }
   };
 
+  /* What is uploaded, half the size of Vertex. Positions are quantized into
+   * the mesh's bounds, see getQuantization(). */
+  struct PackedVertex {
+    Snorm16x4 pos;
+    Unorm8x4 color;
+    Half2 texCoord;
+
+    static constexpr auto getAttributes() {
+      return std::array{
+          vertexAttribute<decltype(pos)>(0, offsetof(PackedVertex, pos)),
+          vertexAttribute<decltype(color)>(1, offsetof(PackedVertex, color)),
+          vertexAttribute<decltype(texCoord)>(
+              2, offsetof(PackedVertex, texCoord)),
+      };
+    }
+
+    static PackedVertex pack(const Vertex &vertex,
+                             const VertexQuantization &quantization);
+    Vertex unpack(const VertexQuantization &quantization) const;
+
+    bool operator==(const PackedVertex &) const = default;
+  };
+
+  /* Axis aligned, in model space */
+  struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  /* GPU ready geometry, as MeshCache stores it */
+  struct Packed {
+    std::vector<PackedVertex> vertices;
+    /* uint16_t when the vertex count allows, uint32_t otherwise */
+    std::vector<std::byte> indices;
+    vk::IndexType indexType;
+    VertexQuantization quantization;
+    Bounds bounds;
+  };
+
+  static Bounds computeBounds(std::span<const Vertex> vertices);
+  /* The smallest index type that can address vertexCount vertices */
+  static vk::IndexType getIndexType(size_t vertexCount);
+  static Packed pack(std::span<const Vertex> vertices,
+                     std::span<const Index> indices);
+
 public:
   Mesh();
-  Mesh(const std::string &path, const char *name = "unnamed");
+  /* Loads path's MeshCache if it is up to date, otherwise imports path,
+   * optimizes it and writes the cache for the next load */
+  Mesh(const std::string &path, const char *name = "unnamed",
+       const MeshOptimization &optimization = {});
+  /* Records the upload into batch instead of submitting it right away */
+  Mesh(const std::string &path, UploadBatch &batch,
+       const char *name = "unnamed",
+       const MeshOptimization &optimization = {});
   Mesh(const std::vector<Vertex> &vertices, const std::vector<Index> &indices,
        const char *name = "unnamed");
 
   void releaseCPUResources();
+  /* Binds the GeometryPool, which serves every mesh with the same index
+   * type. Draw with getFirstIndex() and getVertexOffset(). */
   void bind(vk::CommandBuffer cmd);
+  /* For recording the draw into an indirect buffer */
+  vk::DrawIndexedIndirectCommand
+  getDrawCommand(uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
 
   uint32_t getNumVertices() const { return numVertices; }
   uint32_t getNumIndices() const { return numIndices; }
+  uint32_t getFirstIndex() const { return geometry.getFirstIndex(); }
+  int32_t getVertexOffset() const { return geometry.getVertexOffset(); }
+  vk::IndexType getIndexType() const { return indexType; }
+  const Bounds &getBounds() const { return bounds; }
+  /* The model matrix has to be multiplied with its getTransform() */
+  const VertexQuantization &getQuantization() const { return quantization; }
 
 private:
-  void init(const char *name = "unnamed");
+  void load(const std::string &path, UploadBatch &batch, const char *name,
+            const MeshOptimization &optimization);
+  void upload(UploadBatch &batch, std::span<const PackedVertex> vertexData,
+              std::span<const std::byte> indexData, vk::IndexType type,
+              const char *name);
 
   std::vector<Vertex> cpuVertices;
   uint32_t numVertices;
   std::vector<Index> cpuIndices;
   uint32_t numIndices;
+  vk::IndexType indexType = vk::IndexType::eUint32;
+  Bounds bounds{};
+  VertexQuantization quantization;
 
-  Buffer<Vertex> vertices;
-  Buffer<Index> indices;
+  GeometryRange geometry;
 };
 } // namespace Vulking
 
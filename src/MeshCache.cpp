@@ -0,0 +1,207 @@
+#include "MeshCache.hpp"
+
+#include <cstring>
+
+namespace Vulking {
+namespace {
+template <typename T> void hashCombine(uint64_t &seed, const T &value) {
+  seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) +
+          (seed >> 2);
+}
+
+/* Word at a time, so hashing keeps up with the disk */
+void hashBytes(uint64_t &hash, const void *data, size_t size) {
+  const auto *bytes = static_cast<const std::byte *>(data);
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    bytes += sizeof(word);
+    hash = (hash ^ word) * 0x9fb21c651e98df25ull;
+    hash ^= hash >> 29;
+  }
+  for (; size > 0; size--) {
+    hash = (hash ^ static_cast<uint64_t>(*bytes++)) * 0x100000001b3ull;
+  }
+}
+
+int64_t getWriteTime(const std::filesystem::path &path) {
+  return std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+uint64_t getContentHash(std::span<const Mesh::PackedVertex> vertices,
+                        std::span<const std::byte> indices) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hashBytes(hash, vertices.data(), vertices.size_bytes());
+  hashBytes(hash, indices.data(), indices.size_bytes());
+  return hash;
+}
+
+size_t getDataSize(const MeshCache::Header &header) {
+  return sizeof(header) + header.vertexCount * sizeof(Mesh::PackedVertex) +
+         header.indexCount * header.indexSize;
+}
+} // namespace
+
+std::filesystem::path MeshCache::getPath(const std::filesystem::path &source) {
+  auto path = source;
+  path += EXTENSION;
+  return path;
+}
+
+uint64_t MeshCache::getLayoutHash() {
+  uint64_t seed = 0;
+  hashCombine(seed, sizeof(Mesh::PackedVertex));
+  for (const auto &attribute : Mesh::PackedVertex::getAttributes()) {
+    hashCombine(seed, attribute.location);
+    hashCombine(seed, static_cast<uint64_t>(attribute.format));
+    hashCombine(seed, attribute.offset);
+  }
+  return seed;
+}
+
+std::unique_ptr<MeshCache>
+MeshCache::open(const std::filesystem::path &source,
+                const MeshOptimization &optimization) {
+  const auto path = getPath(source);
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    return nullptr;
+  }
+
+  Header header{};
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+      LOG_INFO("discarding mesh cache " << path.string() << ": truncated");
+      return nullptr;
+    }
+  }
+
+  // Compared field by field to say why it was thrown away
+  const char *reason = nullptr;
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION ||
+      (header.indexSize != sizeof(uint16_t) &&
+       header.indexSize != sizeof(uint32_t))) {
+    reason = "unknown format";
+  } else if (header.layoutHash != getLayoutHash() ||
+             header.vertexStride != sizeof(Mesh::PackedVertex)) {
+    reason = "different vertex layout";
+  } else if (header.optimization != optimization.getFlags()) {
+    reason = "different optimizations";
+  } else if (!std::filesystem::exists(source, error)) {
+    // Shipping only the cache is fine
+  } else if (header.sourceSize != std::filesystem::file_size(source) ||
+             header.sourceWriteTime != getWriteTime(source)) {
+    reason = "source changed";
+  } else if (std::filesystem::file_size(path) != getDataSize(header)) {
+    reason = "truncated";
+  }
+  if (reason) {
+    LOG_INFO("discarding mesh cache " << path.string() << ": " << reason);
+    return nullptr;
+  }
+
+  auto cache = std::unique_ptr<MeshCache>(new MeshCache(path, header));
+  // Checked on the mapping, the file may have changed after it was read
+  // above. Hashing touches every page, which the upload does anyway.
+  if (cache->file.size() != getDataSize(header) ||
+      std::memcmp(cache->file.data(), &header, sizeof(header)) != 0) {
+    reason = "changed while opening";
+  } else if (getContentHash(cache->getVertices(), cache->getIndexData()) !=
+             header.contentHash) {
+    reason = "corrupted";
+  }
+  if (reason) {
+    LOG_INFO("discarding mesh cache " << path.string() << ": " << reason);
+    return nullptr;
+  }
+  return cache;
+}
+
+MeshCache::MeshCache(const std::filesystem::path &path, const Header &header)
+    : file(path), header(header) {}
+
+void MeshCache::write(const std::filesystem::path &source,
+                      const MeshOptimization &optimization,
+                      const Mesh::Packed &mesh) {
+  PROFILE_FUNCTION();
+  const std::span<const Mesh::PackedVertex> vertices = mesh.vertices;
+  const std::span<const std::byte> indices = mesh.indices;
+  Header header;
+  // Padding included, so the same mesh always writes the same bytes
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.layoutHash = getLayoutHash();
+  header.vertexStride = sizeof(Mesh::PackedVertex);
+  header.indexSize = mesh.indexType == vk::IndexType::eUint16
+                         ? sizeof(uint16_t)
+                         : sizeof(uint32_t);
+  header.vertexCount = vertices.size();
+  header.indexCount = indices.size() / header.indexSize;
+  for (int i = 0; i < 3; i++) {
+    header.boundsMin[i] = mesh.bounds.min[i];
+    header.boundsMax[i] = mesh.bounds.max[i];
+    header.quantizationOffset[i] = mesh.quantization.offset[i];
+    header.quantizationScale[i] = mesh.quantization.scale[i];
+  }
+  header.sourceSize = std::filesystem::file_size(source);
+  header.sourceWriteTime = getWriteTime(source);
+  header.contentHash = getContentHash(vertices, indices);
+  header.optimization = optimization.getFlags();
+
+  const auto path = getPath(source);
+  auto temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error(
+          std::format("failed to open file '{}'", temporary.string()));
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vertices.data()),
+               vertices.size_bytes());
+    file.write(reinterpret_cast<const char *>(indices.data()),
+               indices.size_bytes());
+    if (!file) {
+      throw std::runtime_error(
+          std::format("failed writing '{}'", temporary.string()));
+    }
+  }
+  std::filesystem::rename(temporary, path);
+  LOG_INFO("saved mesh cache " << path.string() << ": " << vertices.size()
+                               << " vertices, " << header.indexCount
+                               << " indices");
+}
+
+Mesh::Bounds MeshCache::getBounds() const {
+  return {{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]},
+          {header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]}};
+}
+
+VertexQuantization MeshCache::getQuantization() const {
+  return {{header.quantizationOffset[0], header.quantizationOffset[1],
+           header.quantizationOffset[2]},
+          {header.quantizationScale[0], header.quantizationScale[1],
+           header.quantizationScale[2]}};
+}
+
+std::span<const Mesh::PackedVertex> MeshCache::getVertices() const {
+  return {reinterpret_cast<const Mesh::PackedVertex *>(file.data() +
+                                                       sizeof(Header)),
+          header.vertexCount};
+}
+
+vk::IndexType MeshCache::getIndexType() const {
+  return header.indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16
+                                              : vk::IndexType::eUint32;
+}
+
+std::span<const std::byte> MeshCache::getIndexData() const {
+  return {file.data() + sizeof(Header) +
+              header.vertexCount * sizeof(Mesh::PackedVertex),
+          header.indexCount * header.indexSize};
+}
+} // namespace Vulking
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Common.hpp"
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace Vulking {
+/// Imported mesh data saved next to its source so later loads skip parsing.
+///
+/// The file is a Header followed by the Mesh::Packed vertex array and then
+/// the index array, exactly as Mesh uploads them, in native byte order. It
+/// is memory mapped and handed to the upload as is, so loading is one copy
+/// from the page cache into the staging ring.
+///
+/// The header ties the file to the source's size and write time, to the
+/// MeshOptimization it was imported with and to the current Mesh::Vertex
+/// layout, and carries a hash of the arrays that is checked on open. A file
+/// that doesn't match is ignored and rewritten by the next import.
+class MeshCache {
+public:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    /* of Mesh::PackedVertex's stride and attribute descriptions */
+    uint64_t layoutHash;
+    uint32_t vertexStride;
+    /* 2 or 4 */
+    uint32_t indexSize;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float quantizationOffset[3];
+    float quantizationScale[3];
+    uint64_t sourceSize;
+    int64_t sourceWriteTime;
+    /* of the vertex and index arrays, identifies the geometry */
+    uint64_t contentHash;
+    /* MeshOptimization::getFlags() */
+    uint32_t optimization;
+  };
+
+  static constexpr char MAGIC[4] = {'V', 'K', 'M', 'C'};
+  static constexpr uint32_t VERSION = 3;
+  static constexpr const char *EXTENSION = ".vkmesh";
+
+  MeshCache(const MeshCache &) = delete;
+  MeshCache &operator=(const MeshCache &) = delete;
+  MeshCache(MeshCache &&) = delete;
+  MeshCache &operator=(MeshCache &&) = delete;
+
+  /* source with EXTENSION appended */
+  static std::filesystem::path getPath(const std::filesystem::path &source);
+
+  /* Maps the cache of source. nullptr if there is none or it is stale,
+   * truncated, corrupted or for other optimizations or another vertex
+   * layout. Throws only if the file can't be read or mapped. */
+  static std::unique_ptr<MeshCache>
+  open(const std::filesystem::path &source,
+       const MeshOptimization &optimization = {});
+
+  /* Writes the cache of source through a temporary file that is renamed
+   * over the old one, so a crash never leaves a truncated cache behind */
+  static void write(const std::filesystem::path &source,
+                    const MeshOptimization &optimization,
+                    const Mesh::Packed &mesh);
+
+  static uint64_t getLayoutHash();
+
+  const Header &getHeader() const { return header; }
+  Mesh::Bounds getBounds() const;
+  VertexQuantization getQuantization() const;
+  std::span<const Mesh::PackedVertex> getVertices() const;
+  vk::IndexType getIndexType() const;
+  std::span<const std::byte> getIndexData() const;
+
+private:
+  MeshCache(const std::filesystem::path &path, const Header &header);
+
+  MappedFile file;
+  Header header;
+};
+} // namespace Vulking
@@ -0,0 +1,376 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Vulking {
+namespace {
+constexpr uint32_t UNUSED = UINT32_MAX;
+
+/* FIFO cache as found in hardware, one time stamp per vertex */
+class CacheSimulator {
+public:
+  CacheSimulator(size_t vertexCount, uint32_t cacheSize)
+      : stamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {}
+
+  /* Returns whether the vertex had to be transformed */
+  bool access(Mesh::Index vertex) {
+    if (time - stamps[vertex] > cacheSize) {
+      stamps[vertex] = time++;
+      return true;
+    }
+    return false;
+  }
+
+  /* Forgets everything, for starting a new cluster */
+  void flush() { time += cacheSize + 1; }
+
+private:
+  std::vector<uint32_t> stamps;
+  uint32_t time;
+  uint32_t cacheSize;
+};
+
+/* Every vertex's triangles, as one array sliced by offsets */
+struct Adjacency {
+  Adjacency(std::span<const Mesh::Index> indices, size_t vertexCount)
+      : offsets(vertexCount + 1, 0), triangles(indices.size()) {
+    for (const auto index : indices) {
+      offsets[index + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+      triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  uint32_t getValence(Mesh::Index vertex) const {
+    return offsets[vertex + 1] - offsets[vertex];
+  }
+
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+/* Forsyth's scoring, the cache is an LRU of this size */
+constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+constexpr uint32_t VALENCE_TABLE_SIZE = 64;
+
+struct ScoreTables {
+  ScoreTables() {
+    for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+      // The last triangle's vertices get a fixed score so it isn't
+      // immediately reused from the other side
+      cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                       : std::pow(1.0f - float(i - 3) /
+                                             float(FORSYTH_CACHE_SIZE - 3),
+                                  CACHE_DECAY_POWER);
+    }
+    for (uint32_t i = 0; i < VALENCE_TABLE_SIZE; i++) {
+      valence[i] = getValenceScore(i);
+    }
+  }
+
+  static float getValenceScore(uint32_t remaining) {
+    return remaining == 0 ? 0.0f
+                          : VALENCE_BOOST_SCALE *
+                                std::pow(float(remaining),
+                                         -VALENCE_BOOST_POWER);
+  }
+
+  float get(uint32_t cachePosition, uint32_t remaining) const {
+    if (remaining == 0) {
+      // No triangles left to pull in
+      return -1.0f;
+    }
+    const float valenceScore = remaining < VALENCE_TABLE_SIZE
+                                   ? valence[remaining]
+                                   : getValenceScore(remaining);
+    return valenceScore +
+           (cachePosition < FORSYTH_CACHE_SIZE ? cache[cachePosition] : 0.0f);
+  }
+
+  float cache[FORSYTH_CACHE_SIZE];
+  float valence[VALENCE_TABLE_SIZE];
+};
+} // namespace
+
+VertexCacheStats analyzeVertexCache(std::span<const Mesh::Index> indices,
+                                    size_t vertexCount, uint32_t cacheSize) {
+  VertexCacheStats stats;
+  if (indices.empty()) {
+    return stats;
+  }
+  CacheSimulator cache(vertexCount, cacheSize);
+  for (const auto index : indices) {
+    stats.transformed += cache.access(index);
+  }
+  stats.acmr = float(stats.transformed) / float(indices.size() / 3);
+  stats.atvr = float(stats.transformed) / float(vertexCount);
+  return stats;
+}
+
+void optimizeVertexCache(std::span<Mesh::Index> indices, size_t vertexCount) {
+  PROFILE_FUNCTION();
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  static const ScoreTables scores;
+
+  // Each vertex's slice of adjacency.triangles keeps its live triangles
+  // first, remaining[vertex] of them
+  Adjacency adjacency(indices, vertexCount);
+  std::vector<uint32_t> remaining(vertexCount);
+  std::vector<uint32_t> cachePosition(vertexCount, UNUSED);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+    remaining[vertex] = adjacency.getValence(Mesh::Index(vertex));
+    vertexScores[vertex] = scores.get(UNUSED, remaining[vertex]);
+  }
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  uint32_t best = 0;
+  for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+    triangleScores[triangle] = vertexScores[indices[triangle * 3 + 0]] +
+                               vertexScores[indices[triangle * 3 + 1]] +
+                               vertexScores[indices[triangle * 3 + 2]];
+    if (triangleScores[triangle] > triangleScores[best]) {
+      best = uint32_t(triangle);
+    }
+  }
+
+  std::vector<Mesh::Index> output;
+  output.reserve(indices.size());
+  // Most recent first, with room for the 3 vertices pushed in per triangle
+  std::vector<Mesh::Index> cache, nextCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+  size_t cursor = 0;
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount;
+       emittedCount++) {
+    const Mesh::Index *corners = &indices[size_t(best) * 3];
+    output.insert(output.end(), corners, corners + 3);
+    emitted[best] = true;
+
+    nextCache.clear();
+    for (int i = 0; i < 3; i++) {
+      // Degenerate triangles repeat a corner
+      if (std::ranges::find(nextCache, corners[i]) == nextCache.end()) {
+        nextCache.push_back(corners[i]);
+      }
+    }
+    for (int i = 0; i < 3; i++) {
+      const auto vertex = corners[i];
+      // Move the triangle out of the vertex's live slice
+      auto *begin = &adjacency.triangles[adjacency.offsets[vertex]];
+      auto *last = begin + remaining[vertex] - 1;
+      std::iter_swap(std::find(begin, last, best), last);
+      remaining[vertex]--;
+    }
+    for (const auto vertex : cache) {
+      if (vertex != corners[0] && vertex != corners[1] &&
+          vertex != corners[2]) {
+        nextCache.push_back(vertex);
+      }
+    }
+    std::swap(cache, nextCache);
+
+    // Rescore every vertex that moved in the cache, including the ones that
+    // fell out of it
+    for (uint32_t position = 0; position < cache.size(); position++) {
+      const auto vertex = cache[position];
+      cachePosition[vertex] =
+          position < FORSYTH_CACHE_SIZE ? position : UNUSED;
+      const float score = scores.get(cachePosition[vertex], remaining[vertex]);
+      const float delta = score - vertexScores[vertex];
+      vertexScores[vertex] = score;
+      const auto *live = &adjacency.triangles[adjacency.offsets[vertex]];
+      for (uint32_t i = 0; i < remaining[vertex]; i++) {
+        triangleScores[live[i]] += delta;
+      }
+    }
+    if (cache.size() > FORSYTH_CACHE_SIZE) {
+      cache.resize(FORSYTH_CACHE_SIZE);
+    }
+
+    // Continue with the best triangle that has a vertex in the cache
+    float bestScore = -1.0f;
+    best = UNUSED;
+    for (const auto vertex : cache) {
+      const auto *live = &adjacency.triangles[adjacency.offsets[vertex]];
+      for (uint32_t i = 0; i < remaining[vertex]; i++) {
+        if (triangleScores[live[i]] > bestScore) {
+          bestScore = triangleScores[live[i]];
+          best = live[i];
+        }
+      }
+    }
+
+    if (best == UNUSED) {
+      // Dead end, carry on with the first triangle not emitted yet
+      while (cursor < triangleCount && emitted[cursor]) {
+        cursor++;
+      }
+      best = uint32_t(cursor);
+    }
+  }
+
+  std::ranges::copy(output, indices.begin());
+}
+
+void optimizeOverdraw(std::span<Mesh::Index> indices,
+                      std::span<const Mesh::Vertex> vertices,
+                      float threshold) {
+  PROFILE_FUNCTION();
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Hard boundaries, where all 3 vertices of a triangle miss the cache and
+  // the order restarts anyway
+  std::vector<uint32_t> hard;
+  {
+    CacheSimulator cache(vertices.size(), VERTEX_CACHE_SIZE);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+      uint32_t misses = 0;
+      for (int i = 0; i < 3; i++) {
+        misses += cache.access(indices[triangle * 3 + i]);
+      }
+      if (triangle == 0 || misses == 3) {
+        hard.push_back(uint32_t(triangle));
+      }
+    }
+    hard.push_back(uint32_t(triangleCount));
+  }
+
+  // Soft boundaries, wherever the cluster so far is within threshold of the
+  // ACMR of the hard cluster it is cut from
+  std::vector<uint32_t> clusters;
+  {
+    CacheSimulator cache(vertices.size(), VERTEX_CACHE_SIZE);
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+      const auto begin = hard[h];
+      const auto end = hard[h + 1];
+      cache.flush();
+      uint32_t misses = 0;
+      for (auto i = size_t(begin) * 3; i < size_t(end) * 3; i++) {
+        misses += cache.access(indices[i]);
+      }
+      const float target = threshold * float(misses) / float(end - begin);
+
+      cache.flush();
+      clusters.push_back(begin);
+      uint32_t start = begin;
+      misses = 0;
+      for (auto triangle = begin; triangle < end; triangle++) {
+        for (int i = 0; i < 3; i++) {
+          misses += cache.access(indices[size_t(triangle) * 3 + i]);
+        }
+        if (triangle + 1 < end &&
+            float(misses) <= target * float(triangle + 1 - start)) {
+          clusters.push_back(triangle + 1);
+          start = triangle + 1;
+          misses = 0;
+          cache.flush();
+        }
+      }
+    }
+    clusters.push_back(uint32_t(triangleCount));
+  }
+
+  // Area weighted centroid and normal of the mesh and of every cluster
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    float sortKey;
+  };
+  std::vector<Cluster> sorted(clusters.size() - 1);
+  std::vector<glm::vec3> centroids(sorted.size()), normals(sorted.size());
+  glm::vec3 meshCentroid{0.0f};
+  float meshArea = 0.0f;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    glm::vec3 centroid{0.0f}, normal{0.0f};
+    float area = 0.0f;
+    for (auto triangle = clusters[i]; triangle < clusters[i + 1];
+         triangle++) {
+      const auto &a = vertices[indices[size_t(triangle) * 3 + 0]].pos;
+      const auto &b = vertices[indices[size_t(triangle) * 3 + 1]].pos;
+      const auto &c = vertices[indices[size_t(triangle) * 3 + 2]].pos;
+      // Twice the area, the factor cancels out
+      const auto scaledNormal = glm::cross(b - a, c - a);
+      const float triangleArea = glm::length(scaledNormal);
+      centroid += (a + b + c) * (triangleArea / 3.0f);
+      normal += scaledNormal;
+      area += triangleArea;
+    }
+    meshCentroid += centroid;
+    meshArea += area;
+    centroids[i] = area > 0.0f ? centroid / area : centroid;
+    const float length = glm::length(normal);
+    normals[i] = length > 0.0f ? normal / length : normal;
+    sorted[i] = {clusters[i], clusters[i + 1], 0.0f};
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+  for (size_t i = 0; i < sorted.size(); i++) {
+    sorted[i].sortKey = glm::dot(centroids[i] - meshCentroid, normals[i]);
+  }
+  // Facing furthest out first, those are the likeliest occluders
+  std::ranges::stable_sort(sorted, std::ranges::greater{}, &Cluster::sortKey);
+
+  std::vector<Mesh::Index> output;
+  output.reserve(indices.size());
+  for (const auto &cluster : sorted) {
+    output.insert(output.end(), indices.begin() + size_t(cluster.begin) * 3,
+                  indices.begin() + size_t(cluster.end) * 3);
+  }
+  std::ranges::copy(output, indices.begin());
+}
+
+void optimizeVertexFetch(std::vector<Mesh::Vertex> &vertices,
+                         std::span<Mesh::Index> indices) {
+  PROFILE_FUNCTION();
+  std::vector<Mesh::Index> remap(vertices.size(), UNUSED);
+  std::vector<Mesh::Vertex> reordered;
+  reordered.reserve(vertices.size());
+  for (auto &index : indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = Mesh::Index(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(reordered);
+}
+
+void optimizeMesh(std::vector<Mesh::Vertex> &vertices,
+                  std::vector<Mesh::Index> &indices,
+                  const MeshOptimization &options) {
+  PROFILE_FUNCTION();
+  const auto before = analyzeVertexCache(indices, vertices.size());
+  if (options.vertexCache) {
+    optimizeVertexCache(indices, vertices.size());
+  }
+  if (options.overdraw) {
+    optimizeOverdraw(indices, vertices);
+  }
+  if (options.vertexFetch) {
+    optimizeVertexFetch(vertices, indices);
+  }
+  const auto after = analyzeVertexCache(indices, vertices.size());
+  LOG_INFO("optimized " << indices.size() / 3 << " triangles: ACMR "
+                        << before.acmr << " -> " << after.acmr << ", ATVR "
+                        << before.atvr << " -> " << after.atvr);
+}
+} // namespace Vulking
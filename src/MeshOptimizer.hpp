@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+
+#include <span>
+
+namespace Vulking {
+/* Post-transform cache size analyzeVertexCache simulates by default */
+inline constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+/// Efficiency of a triangle order for a FIFO post-transform vertex cache.
+struct VertexCacheStats {
+  /* vertex shader invocations */
+  uint32_t transformed = 0;
+  /* transformed per triangle: 0.5 is ideal for large grids, 3 is the worst */
+  float acmr = 0;
+  /* transformed per vertex, 1 is ideal */
+  float atvr = 0;
+};
+
+VertexCacheStats analyzeVertexCache(std::span<const Mesh::Index> indices,
+                                    size_t vertexCount,
+                                    uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+/// Reorders triangles so consecutive ones share vertices, using Forsyth's
+/// linear-speed vertex cache optimisation. Every triangle keeps its corners
+/// in order, so winding is preserved.
+void optimizeVertexCache(std::span<Mesh::Index> indices, size_t vertexCount);
+
+/// Reorders the clusters of a cache optimized triangle order so outward
+/// facing ones come first and occlude the rest (Sander, Nehab and Barczak,
+/// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+/// Clusters are cut where the order is cheapest to restart, and only as long
+/// as their ACMR stays within threshold times the unsplit order's.
+void optimizeOverdraw(std::span<Mesh::Index> indices,
+                      std::span<const Mesh::Vertex> vertices,
+                      float threshold = 1.05f);
+
+/// Moves vertices into the order the indices first use them, so vertex
+/// fetch walks memory forward. Unreferenced vertices are dropped.
+void optimizeVertexFetch(std::vector<Mesh::Vertex> &vertices,
+                         std::span<Mesh::Index> indices);
+
+/* Runs the passes options enables in order and logs the ACMR and ATVR
+ * before and after */
+void optimizeMesh(std::vector<Mesh::Vertex> &vertices,
+                  std::vector<Mesh::Index> &indices,
+                  const MeshOptimization &options = {});
+} // namespace Vulking
@@ -0,0 +1,599 @@
+#include "ObjParser.hpp"
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace Vulking {
+namespace {
+/* An index into positions or texture coordinates. Negative OBJ indices
+ * count back from the line they are on, which a chunk can only express
+ * relative to its own first element until the chunks before it are known. */
+struct Ref {
+  int64_t index = -1;
+  bool relative = false;
+};
+
+struct Corner {
+  Ref position;
+  Ref texCoord;
+};
+
+struct Chunk {
+  std::string_view text;
+
+  std::vector<float> positions;
+  std::vector<float> texCoords;
+  std::vector<Corner> corners;
+  /* Corners of each face, 3 or 4 */
+  std::vector<uint8_t> faceSizes;
+  bool hasPolygons = false;
+
+  /* Elements in the chunks before this one */
+  size_t positionBase = 0;
+  size_t texCoordBase = 0;
+  size_t indexBase = 0;
+
+  /* This chunk's unique vertices and its indices into them */
+  std::vector<Mesh::Vertex> vertices;
+  std::vector<Mesh::Index> indices;
+  /* From vertices to the merged vertex list */
+  std::vector<Mesh::Index> remap;
+};
+
+/* Open addressing tables, since node based maps spend most of their time
+ * allocating at millions of vertices. Both keep the load factor at or below
+ * one half and probe linearly. */
+constexpr uint32_t EMPTY = UINT32_MAX;
+
+uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  return h ^ (h >> 33);
+}
+
+size_t getTableSize(size_t expected) {
+  return std::bit_ceil(std::max<size_t>(expected * 2, 16));
+}
+
+/* Unique vertices by value, as indices into the vertex list it appends to.
+ * Slots keep the upper half of the hash next to the index, so probing past
+ * other vertices rarely has to load them. */
+class VertexSet {
+public:
+  explicit VertexSet(size_t expected)
+      : slots(getTableSize(expected), EMPTY_SLOT) {}
+
+  Mesh::Index insert(const Mesh::Vertex &vertex,
+                     std::vector<Mesh::Vertex> &vertices) {
+    if ((vertices.size() + 1) * 2 > slots.size()) {
+      grow(vertices);
+    }
+    const auto h = hash(vertex);
+    const auto tag = h & ~uint64_t{UINT32_MAX};
+    const size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      const auto slot = slots[i];
+      if (slot == EMPTY_SLOT) {
+        const auto index = static_cast<uint32_t>(vertices.size());
+        slots[i] = tag | index;
+        vertices.push_back(vertex);
+        return index;
+      }
+      const auto index = static_cast<uint32_t>(slot);
+      if ((slot & ~uint64_t{UINT32_MAX}) == tag && vertices[index] == vertex) {
+        return index;
+      }
+    }
+  }
+
+private:
+  static uint64_t hash(const Mesh::Vertex &vertex) {
+    uint64_t h = 0;
+    for (const float f : {vertex.pos.x, vertex.pos.y, vertex.pos.z,
+                          vertex.color.x, vertex.color.y, vertex.color.z,
+                          vertex.texCoord.x, vertex.texCoord.y}) {
+      // + 0.0f so that -0 and 0, which compare equal, hash equal too
+      h = mix(h ^ std::bit_cast<uint32_t>(f + 0.0f));
+    }
+    return h;
+  }
+
+  void grow(const std::vector<Mesh::Vertex> &vertices) {
+    slots.assign(slots.size() * 2, EMPTY_SLOT);
+    const size_t mask = slots.size() - 1;
+    for (uint32_t index = 0; index < vertices.size(); index++) {
+      const auto h = hash(vertices[index]);
+      size_t i = h & mask;
+      while (slots[i] != EMPTY_SLOT) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = (h & ~uint64_t{UINT32_MAX}) | index;
+    }
+  }
+
+  static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+  std::vector<uint64_t> slots;
+};
+
+/* (position, texture coordinate) pairs already turned into a vertex, which
+ * skips building and hashing the vertex for every corner sharing them */
+class CornerMap {
+public:
+  explicit CornerMap(size_t expected)
+      : keys(getTableSize(expected), EMPTY_KEY), values(keys.size()) {}
+
+  /* The value stored for key, or EMPTY with slot set to where it goes */
+  uint32_t find(uint64_t key, size_t &slot) const {
+    const size_t mask = keys.size() - 1;
+    for (slot = mix(key) & mask; keys[slot] != EMPTY_KEY;
+         slot = (slot + 1) & mask) {
+      if (keys[slot] == key) {
+        return values[slot];
+      }
+    }
+    return EMPTY;
+  }
+
+  void insert(uint64_t key, size_t slot, uint32_t value) {
+    keys[slot] = key;
+    values[slot] = value;
+    if (++count * 2 > keys.size()) {
+      grow();
+    }
+  }
+
+private:
+  static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+
+  void grow() {
+    auto oldKeys = std::move(keys);
+    auto oldValues = std::move(values);
+    keys.assign(oldKeys.size() * 2, EMPTY_KEY);
+    values.assign(keys.size(), 0);
+    const size_t mask = keys.size() - 1;
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+      if (oldKeys[i] == EMPTY_KEY) {
+        continue;
+      }
+      size_t slot = mix(oldKeys[i]) & mask;
+      while (keys[slot] != EMPTY_KEY) {
+        slot = (slot + 1) & mask;
+      }
+      keys[slot] = oldKeys[i];
+      values[slot] = oldValues[i];
+    }
+  }
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> values;
+  size_t count = 0;
+};
+
+bool isSpace(char c) { return c == ' ' || c == '\t'; }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+const char *skipSpaces(const char *s, const char *end) {
+  while (s != end && isSpace(*s)) {
+    s++;
+  }
+  return s;
+}
+
+/* tinyobj's tryParseDouble, kept to the same arithmetic so that both give
+ * bit identical floats. Unlike strtod it ignores the locale. */
+bool tryParseDouble(const char *s, const char *end, double &result) {
+  if (s >= end) {
+    return false;
+  }
+  double mantissa = 0.0;
+  int exponent = 0;
+  char sign = '+';
+  char expSign = '+';
+  const char *curr = s;
+  int read = 0;
+  bool leadingDecimalDots = false;
+
+  if (*curr == '+' || *curr == '-') {
+    sign = *curr;
+    curr++;
+    if (curr != end && *curr == '.') {
+      leadingDecimalDots = true;
+    }
+  } else if (isDigit(*curr)) {
+  } else if (*curr == '.') {
+    leadingDecimalDots = true;
+  } else {
+    return false;
+  }
+
+  if (!leadingDecimalDots) {
+    while (curr != end && isDigit(*curr)) {
+      mantissa *= 10;
+      mantissa += static_cast<int>(*curr - '0');
+      curr++;
+      read++;
+    }
+    if (read == 0) {
+      return false;
+    }
+  }
+
+  if (curr != end && *curr == '.') {
+    curr++;
+    read = 1;
+    while (curr != end && isDigit(*curr)) {
+      static constexpr double POW_LUT[] = {
+          1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+      };
+      constexpr int LUT_ENTRIES = sizeof POW_LUT / sizeof POW_LUT[0];
+      mantissa += static_cast<int>(*curr - '0') *
+                  (read < LUT_ENTRIES ? POW_LUT[read] : std::pow(10.0, -read));
+      read++;
+      curr++;
+    }
+  } else if (curr != end && (*curr == 'e' || *curr == 'E')) {
+  } else {
+    curr = end;
+  }
+
+  if (curr != end && (*curr == 'e' || *curr == 'E')) {
+    curr++;
+    if (curr != end && (*curr == '+' || *curr == '-')) {
+      expSign = *curr;
+      curr++;
+    } else if (curr != end && isDigit(*curr)) {
+    } else {
+      return false;
+    }
+    read = 0;
+    while (curr != end && isDigit(*curr)) {
+      if (exponent > 2147483647 / 10) {
+        return false;
+      }
+      exponent *= 10;
+      exponent += static_cast<int>(*curr - '0');
+      curr++;
+      read++;
+    }
+    exponent *= expSign == '+' ? 1 : -1;
+    if (read == 0) {
+      return false;
+    }
+  }
+
+  result = (sign == '+' ? 1 : -1) *
+           (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
+                     : mantissa);
+  return true;
+}
+
+/* Parses the whitespace separated number at s into out, 0 if it isn't one,
+ * and returns where it ended */
+const char *parseReal(const char *s, const char *end, float &out) {
+  s = skipSpaces(s, end);
+  const char *tokenEnd = s;
+  while (tokenEnd != end && !isSpace(*tokenEnd) && *tokenEnd != '\r') {
+    tokenEnd++;
+  }
+  double value = 0.0;
+  tryParseDouble(s, tokenEnd, value);
+  out = static_cast<float>(value);
+  return tokenEnd;
+}
+
+/* atoi, without needing a terminator */
+const char *parseInt(const char *s, const char *end, int64_t &out) {
+  bool negative = false;
+  if (s != end && (*s == '+' || *s == '-')) {
+    negative = *s == '-';
+    s++;
+  }
+  out = 0;
+  while (s != end && isDigit(*s)) {
+    out = out * 10 + (*s - '0');
+    s++;
+  }
+  if (negative) {
+    out = -out;
+  }
+  return s;
+}
+
+const char *skipToSeparator(const char *s, const char *end) {
+  while (s != end && *s != '/' && !isSpace(*s) && *s != '\r') {
+    s++;
+  }
+  return s;
+}
+
+/* OBJ indices are 1 based, negative ones count back from count, the number
+ * of elements so far in this chunk */
+Ref makeRef(int64_t index, size_t count) {
+  if (index > 0) {
+    return {index - 1, false};
+  }
+  if (index < 0) {
+    return {static_cast<int64_t>(count) + index, true};
+  }
+  return {};
+}
+
+/* One v/vt/vn corner of a face line, tinyobj's parseTriple */
+const char *parseCorner(const char *s, const char *end, const Chunk &chunk,
+                        Corner &corner) {
+  int64_t index;
+  s = parseInt(s, end, index);
+  if (index == 0) {
+    throw std::runtime_error("OBJ face with a missing or zero vertex index");
+  }
+  corner.position = makeRef(index, chunk.positions.size() / 3);
+  s = skipToSeparator(s, end);
+  if (s == end || *s != '/') {
+    return s;
+  }
+  s++;
+  if (s != end && *s == '/') {
+    // v//vn, normals aren't used
+    return skipToSeparator(s + 1, end);
+  }
+  s = parseInt(s, end, index);
+  corner.texCoord = makeRef(index, chunk.texCoords.size() / 2);
+  s = skipToSeparator(s, end);
+  if (s != end && *s == '/') {
+    s = skipToSeparator(s + 1, end);
+  }
+  return s;
+}
+
+void parseLine(const char *s, const char *end, Chunk &chunk) {
+  s = skipSpaces(s, end);
+  if (end - s < 2) {
+    return;
+  }
+  if (s[0] == 'v' && isSpace(s[1])) {
+    float x, y, z;
+    s = parseReal(s + 2, end, x);
+    s = parseReal(s, end, y);
+    parseReal(s, end, z);
+    chunk.positions.insert(chunk.positions.end(), {x, y, z});
+  } else if (s[0] == 'v' && s[1] == 't' && end - s > 2 && isSpace(s[2])) {
+    float u, v;
+    s = parseReal(s + 3, end, u);
+    parseReal(s, end, v);
+    chunk.texCoords.insert(chunk.texCoords.end(), {u, v});
+  } else if (s[0] == 'f' && isSpace(s[1])) {
+    s = skipSpaces(s + 2, end);
+    size_t count = 0;
+    while (s != end && *s != '\r') {
+      Corner corner;
+      s = parseCorner(s, end, chunk, corner);
+      chunk.corners.push_back(corner);
+      count++;
+      s = skipSpaces(s, end);
+    }
+    if (count < 3) {
+      // Degenerate, tinyobj drops these too
+      chunk.corners.resize(chunk.corners.size() - count);
+    } else if (count > 4) {
+      chunk.hasPolygons = true;
+    } else {
+      chunk.faceSizes.push_back(static_cast<uint8_t>(count));
+    }
+  }
+}
+
+void parseChunk(Chunk &chunk) {
+  const char *s = chunk.text.data();
+  const char *const end = s + chunk.text.size();
+  while (s != end && !chunk.hasPolygons) {
+    const char *lineEnd = s;
+    while (lineEnd != end && *lineEnd != '\n') {
+      lineEnd++;
+    }
+    parseLine(s, lineEnd, chunk);
+    s = lineEnd == end ? end : lineEnd + 1;
+  }
+}
+
+size_t resolve(const Ref &ref, size_t base, size_t count) {
+  const auto index = ref.relative ? static_cast<int64_t>(base) + ref.index
+                                  : ref.index;
+  if (index < 0 || static_cast<size_t>(index) >= count) {
+    throw std::runtime_error(std::format(
+        "OBJ face index {} is out of range, there are {}", index + 1, count));
+  }
+  return static_cast<size_t>(index);
+}
+
+/* Builds the chunk's triangles from the merged positions and texture
+ * coordinates and deduplicates their corners */
+void triangulateChunk(Chunk &chunk, const std::vector<float> &positions,
+                      const std::vector<float> &texCoords) {
+  const auto positionCount = positions.size() / 3;
+  const auto texCoordCount = texCoords.size() / 2;
+  // Most corners repeat a pair seen before, far fewer are new vertices
+  CornerMap corners(chunk.corners.size() / 4);
+  VertexSet unique(chunk.corners.size() / 8);
+
+  const auto emit = [&](const Corner &corner, size_t position) {
+    const bool hasTexCoord =
+        corner.texCoord.index != -1 || corner.texCoord.relative;
+    const size_t texCoord =
+        hasTexCoord
+            ? resolve(corner.texCoord, chunk.texCoordBase, texCoordCount)
+            : texCoordCount;
+    const uint64_t key = position * (texCoordCount + 1) + texCoord;
+    size_t slot;
+    if (const auto index = corners.find(key, slot); index != EMPTY) {
+      chunk.indices.push_back(index);
+      return;
+    }
+
+    Mesh::Vertex vertex{};
+    vertex.pos = {
+        positions[3 * position + 0],
+        positions[3 * position + 1],
+        positions[3 * position + 2],
+    };
+    if (hasTexCoord) {
+      vertex.texCoord = {
+          texCoords[2 * texCoord + 0],
+          1.0f - texCoords[2 * texCoord + 1],
+      };
+    } else {
+      vertex.texCoord = {0.0f, 1.0f};
+    }
+    vertex.color = {1.0f, 1.0f, 1.0f};
+
+    const auto index = unique.insert(vertex, chunk.vertices);
+    corners.insert(key, slot, index);
+    chunk.indices.push_back(index);
+  };
+
+  chunk.indices.reserve(chunk.corners.size() * 3 / 2);
+  const Corner *corner = chunk.corners.data();
+  for (const auto size : chunk.faceSizes) {
+    std::array<size_t, 4> p;
+    for (uint8_t i = 0; i < size; i++) {
+      p[i] = resolve(corner[i].position, chunk.positionBase, positionCount);
+    }
+    if (size == 3) {
+      emit(corner[0], p[0]);
+      emit(corner[1], p[1]);
+      emit(corner[2], p[2]);
+    } else {
+      // Split along the shorter diagonal, in float like tinyobj
+      const auto squaredDistance = [&](size_t a, size_t b) {
+        const float x = positions[3 * b + 0] - positions[3 * a + 0];
+        const float y = positions[3 * b + 1] - positions[3 * a + 1];
+        const float z = positions[3 * b + 2] - positions[3 * a + 2];
+        return x * x + y * y + z * z;
+      };
+      if (squaredDistance(p[0], p[2]) < squaredDistance(p[1], p[3])) {
+        for (const auto i : {0, 1, 2, 0, 2, 3}) {
+          emit(corner[i], p[i]);
+        }
+      } else {
+        for (const auto i : {0, 1, 3, 1, 2, 3}) {
+          emit(corner[i], p[i]);
+        }
+      }
+    }
+    corner += size;
+  }
+}
+} // namespace
+
+std::optional<ObjMesh> parseObj(std::string_view text, ThreadPool &pool,
+                                size_t minChunkBytes) {
+  PROFILE_FUNCTION();
+
+  // Line aligned chunks, one per worker unless that would make them small
+  const size_t chunkCount = std::clamp<size_t>(
+      text.size() / std::max<size_t>(minChunkBytes, 1), 1,
+      std::max(pool.getThreadCount(), 1u));
+  std::vector<Chunk> chunks(chunkCount);
+  size_t begin = 0;
+  for (size_t i = 0; i < chunkCount; i++) {
+    size_t end = text.size();
+    if (i + 1 < chunkCount) {
+      end = std::max(begin, text.size() * (i + 1) / chunkCount);
+      const auto newline = text.find('\n', end);
+      end = newline == std::string_view::npos ? text.size() : newline + 1;
+    }
+    chunks[i].text = text.substr(begin, end - begin);
+    begin = end;
+  }
+
+  const auto forEachChunk = [&](const auto &fn) {
+    pool.parallelFor(chunks.size(), 1,
+                     [&](size_t first, size_t last, uint32_t) {
+                       for (size_t i = first; i < last; i++) {
+                         fn(chunks[i]);
+                       }
+                     });
+  };
+
+  {
+    PROFILE_ZONE("parseObj parse");
+    forEachChunk(parseChunk);
+  }
+  if (std::ranges::any_of(chunks, &Chunk::hasPolygons)) {
+    return std::nullopt;
+  }
+
+  size_t positionCount = 0;
+  size_t texCoordCount = 0;
+  for (auto &chunk : chunks) {
+    chunk.positionBase = positionCount;
+    chunk.texCoordBase = texCoordCount;
+    positionCount += chunk.positions.size() / 3;
+    texCoordCount += chunk.texCoords.size() / 2;
+  }
+  std::vector<float> positions(positionCount * 3);
+  std::vector<float> texCoords(texCoordCount * 2);
+
+  {
+    PROFILE_ZONE("parseObj triangulate");
+    forEachChunk([&](Chunk &chunk) {
+      std::ranges::copy(chunk.positions,
+                        positions.begin() + chunk.positionBase * 3);
+      std::ranges::copy(chunk.texCoords,
+                        texCoords.begin() + chunk.texCoordBase * 2);
+    });
+    forEachChunk([&](Chunk &chunk) {
+      triangulateChunk(chunk, positions, texCoords);
+      chunk.corners = {};
+      chunk.positions = {};
+      chunk.texCoords = {};
+    });
+  }
+
+  ObjMesh mesh;
+  if (chunks.size() == 1) {
+    // Already unique and in first use order
+    mesh.vertices = std::move(chunks[0].vertices);
+    mesh.indices = std::move(chunks[0].indices);
+  } else {
+    // Chunks in order and each chunk's vertices in first use order, so the
+    // merged list is in first use order over the whole file
+    PROFILE_ZONE("parseObj merge");
+    size_t uniqueCount = 0;
+    size_t indexCount = 0;
+    for (auto &chunk : chunks) {
+      uniqueCount += chunk.vertices.size();
+      chunk.indexBase = indexCount;
+      indexCount += chunk.indices.size();
+    }
+    VertexSet unique(uniqueCount);
+    mesh.vertices.reserve(uniqueCount);
+    for (auto &chunk : chunks) {
+      chunk.remap.resize(chunk.vertices.size());
+      for (size_t i = 0; i < chunk.vertices.size(); i++) {
+        chunk.remap[i] = unique.insert(chunk.vertices[i], mesh.vertices);
+      }
+    }
+
+    mesh.indices.resize(indexCount);
+    forEachChunk([&](Chunk &chunk) {
+      auto out = mesh.indices.begin() + chunk.indexBase;
+      for (const auto index : chunk.indices) {
+        *out++ = chunk.remap[index];
+      }
+    });
+  }
+  return mesh;
+}
+
+std::optional<ObjMesh> loadObj(const std::filesystem::path &path,
+                               ThreadPool &pool) {
+  const MappedFile file(path);
+  return parseObj(file.getText(), pool);
+}
+} // namespace Vulking
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+#include "ThreadPool.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace Vulking {
+struct ObjMesh {
+  std::vector<Mesh::Vertex> vertices;
+  std::vector<Mesh::Index> indices;
+};
+
+/* Below this many bytes per chunk a file isn't worth splitting further */
+inline constexpr size_t OBJ_MIN_CHUNK_BYTES = 1024 * 1024;
+
+/// Parses the positions, texture coordinates and faces of a Wavefront OBJ,
+/// everything else is skipped. The text is split into line aligned chunks
+/// that pool's workers parse, triangulate and deduplicate independently,
+/// and only the chunks' unique vertices are merged on the calling thread.
+///
+/// The result is the same, vertex for vertex and index for index, as
+/// loading the file with tinyobj::LoadObj and deduplicating its corners in
+/// face order: numbers are parsed with tinyobj's arithmetic and quads are
+/// split along the same diagonal. tinyobj ear clips larger polygons, so for
+/// those this returns nullopt and the caller should fall back to it.
+///
+/// Throws on face indices that are zero or out of range.
+std::optional<ObjMesh> parseObj(std::string_view text, ThreadPool &pool,
+                                size_t minChunkBytes = OBJ_MIN_CHUNK_BYTES);
+
+/* Memory maps path and parses it with parseObj */
+std::optional<ObjMesh> loadObj(const std::filesystem::path &path,
+                               ThreadPool &pool);
+} // namespace Vulking
@@ -0,0 +1,78 @@
+#include "ParallelRecorder.hpp"
+
+#include "Engine.hpp"
+
+namespace Vulking {
+void ParallelRecorder::init(ThreadPool &workers, uint32_t frameCount) {
+  auto &ctx = Engine::ctx();
+  this->workers = &workers;
+  frames.resize(frameCount);
+  for (uint32_t frame = 0; frame < frameCount; frame++) {
+    frames[frame].resize(workers.getThreadCount());
+    for (uint32_t worker = 0; worker < workers.getThreadCount(); worker++) {
+      auto &pool = frames[frame][worker].pool;
+      pool = ctx.device->createCommandPoolUnique(
+          vk::CommandPoolCreateInfo{}
+              .setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+              .setQueueFamilyIndex(ctx.graphicsQueueFamily));
+      NAME_OBJECT(ctx.device, pool.get(),
+                  std::format("parallel_command_pool_{}_{}", frame, worker));
+    }
+  }
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex) {
+  const auto device = Engine::ctx().device.get();
+  this->frameIndex = frameIndex;
+  for (auto &pool : frames[frameIndex]) {
+    if (pool.used != 0) {
+      device.resetCommandPool(pool.pool.get());
+      pool.used = 0;
+    }
+  }
+}
+
+std::vector<vk::CommandBuffer>
+ParallelRecorder::record(const vk::CommandBufferInheritanceInfo &inheritance,
+                         size_t count, const RecordFn &fn, size_t minChunk) {
+  std::vector<vk::CommandBuffer> recorded(
+      workers->getChunkCount(count, minChunk));
+  auto &pools = frames[frameIndex];
+  const auto chunks = recorded.size();
+
+  workers->parallelFor(
+      count, minChunk, [&](size_t begin, size_t end, uint32_t worker) {
+        PROFILE_ZONE("ParallelRecorder::record");
+        // Only this worker touches its own pool, so no locking
+        auto cmd = acquire(pools[worker], worker);
+        cmd.begin(
+            vk::CommandBufferBeginInfo{}
+                .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                          vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+                .setPInheritanceInfo(&inheritance));
+        fn(cmd, begin, end);
+        cmd.end();
+        // parallelFor starts chunk c at floor(c * count / chunks), invert it
+        recorded[(begin * chunks + count - 1) / count] = cmd;
+      });
+  return recorded;
+}
+
+vk::CommandBuffer ParallelRecorder::acquire(WorkerPool &pool, uint32_t worker) {
+  if (pool.used == pool.buffers.size()) {
+    auto &ctx = Engine::ctx();
+    const auto cmd = ctx.device
+                         ->allocateCommandBuffers(
+                             vk::CommandBufferAllocateInfo{}
+                                 .setCommandPool(pool.pool.get())
+                                 .setLevel(vk::CommandBufferLevel::eSecondary)
+                                 .setCommandBufferCount(1))
+                         .front();
+    NAME_OBJECT(ctx.device, cmd,
+                std::format("parallel_secondary_{}_{}_{}", frameIndex, worker,
+                            pool.buffers.size()));
+    pool.buffers.push_back(cmd);
+  }
+  return pool.buffers[pool.used++];
+}
+} // namespace Vulking
@@ -0,0 +1,193 @@
+#include "PipelineCache.hpp"
+
+#include "Engine.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Vulking {
+namespace {
+/* FNV-1a, only has to catch truncated and corrupted files */
+uint64_t checksum(const std::vector<uint8_t> &data) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const auto byte : data) {
+    hash = (hash ^ byte) * 0x100000001b3ull;
+  }
+  return hash;
+}
+} // namespace
+
+PipelineCache::~PipelineCache() {
+  if (!main) {
+    return;
+  }
+  try {
+    save();
+  } catch (const std::exception &e) {
+    LOG_WARNING("failed saving pipeline cache: " << e.what());
+  }
+}
+
+void PipelineCache::init(std::filesystem::path path) {
+  auto &ctx = Engine::ctx();
+  this->path = std::move(path);
+  device = ctx.device.get();
+  properties = ctx.physicalDevice.getProperties();
+
+  const auto data = load();
+  main = ctx.device->createPipelineCacheUnique(
+      vk::PipelineCacheCreateInfo{}
+          .setInitialDataSize(data.size())
+          .setPInitialData(data.data()));
+  NAME_OBJECT(ctx.device, main.get(), "pipeline_cache");
+}
+
+vk::PipelineCache PipelineCache::get() {
+  auto &ctx = Engine::ctx();
+  std::lock_guard lock(mutex);
+  const auto id = std::this_thread::get_id();
+  const auto it = threadCaches.find(id);
+  if (it != threadCaches.end() && !it->second.thread.expired()) {
+    return it->second.cache.get();
+  }
+
+  // A new thread, or one that got the id of a thread that exited
+  pruneExited();
+  // Start from everything known so far, a thread's cache only serves the
+  // pipelines created with it
+  const auto data = ctx.device->getPipelineCacheData(main.get());
+  auto &entry = threadCaches[id];
+  entry.cache = ctx.device->createPipelineCacheUnique(
+      vk::PipelineCacheCreateInfo{}
+          .setInitialDataSize(data.size())
+          .setPInitialData(data.data()));
+  entry.thread = getThreadLifetime();
+  NAME_OBJECT(ctx.device, entry.cache.get(),
+              std::format("thread_pipeline_cache_{}",
+                          threadCaches.size() - 1));
+  return entry.cache.get();
+}
+
+void PipelineCache::pruneExited() {
+  // Moved out in the same pass that checks them, a thread may exit while
+  // this runs
+  std::vector<vk::UniquePipelineCache> exited;
+  for (auto it = threadCaches.begin(); it != threadCaches.end();) {
+    if (it->second.thread.expired()) {
+      exited.push_back(std::move(it->second.cache));
+      it = threadCaches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (exited.empty()) {
+    return;
+  }
+  // Keep what they compiled before letting them go
+  std::vector<vk::PipelineCache> sources;
+  for (const auto &cache : exited) {
+    sources.push_back(cache.get());
+  }
+  device.mergePipelineCaches(main.get(), sources);
+}
+
+void PipelineCache::save() {
+  std::lock_guard lock(mutex);
+  if (!threadCaches.empty()) {
+    std::vector<vk::PipelineCache> sources;
+    for (const auto &[thread, entry] : threadCaches) {
+      sources.push_back(entry.cache.get());
+    }
+    device.mergePipelineCaches(main.get(), sources);
+  }
+  if (path.empty()) {
+    return;
+  }
+
+  const auto data = device.getPipelineCacheData(main.get());
+  const auto header = makeHeader(data);
+  auto temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error(
+          std::format("failed to open file '{}'", temporary.string()));
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!file) {
+      throw std::runtime_error(
+          std::format("failed writing '{}'", temporary.string()));
+    }
+  }
+  std::filesystem::rename(temporary, path);
+  LOG_INFO("saved " << data.size() << " bytes of pipeline cache to "
+                    << path.string());
+}
+
+PipelineCache::Header
+PipelineCache::makeHeader(const std::vector<uint8_t> &data) const {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  header.driverVersion = properties.driverVersion;
+  std::ranges::copy(properties.pipelineCacheUUID, header.pipelineCacheUUID);
+  header.dataSize = data.size();
+  header.checksum = checksum(data);
+  return header;
+}
+
+std::vector<uint8_t> PipelineCache::load() const {
+  if (path.empty() || !std::filesystem::exists(path)) {
+    return {};
+  }
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    LOG_WARNING("failed to open pipeline cache " << path.string());
+    return {};
+  }
+  const auto fileSize = static_cast<size_t>(file.tellg());
+  file.seekg(0);
+
+  Header header{};
+  if (fileSize < sizeof(header) ||
+      !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    LOG_WARNING("discarding truncated pipeline cache " << path.string());
+    return {};
+  }
+  std::vector<uint8_t> data(fileSize - sizeof(header));
+  file.read(reinterpret_cast<char *>(data.data()), data.size());
+
+  // Compared field by field to say why it was thrown away
+  const auto expected = makeHeader(data);
+  const char *reason = nullptr;
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION) {
+    reason = "unknown format";
+  } else if (header.vendorID != expected.vendorID ||
+             header.deviceID != expected.deviceID) {
+    reason = "different device";
+  } else if (header.driverVersion != expected.driverVersion) {
+    reason = "different driver version";
+  } else if (std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID,
+                         VK_UUID_SIZE) != 0) {
+    reason = "different pipelineCacheUUID";
+  } else if (header.dataSize != data.size() ||
+             header.checksum != expected.checksum) {
+    reason = "corrupted";
+  }
+  if (reason) {
+    LOG_INFO("discarding pipeline cache " << path.string() << ": " << reason);
+    return {};
+  }
+
+  LOG_INFO("loaded " << data.size() << " bytes of pipeline cache from "
+                     << path.string());
+  return data;
+}
+} // namespace Vulking
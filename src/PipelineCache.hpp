@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Vulking {
+/// VkPipelineCache persisted across runs.
+///
+/// The file is our own header followed by the driver's cache data. The header
+/// records the vendor, device, driver version and pipelineCacheUUID the data
+/// came from plus a checksum, and anything that doesn't match the current
+/// device is thrown away instead of handed to the driver.
+///
+/// Every thread compiles into its own cache, so threads never contend on the
+/// driver's cache lock. save() merges them into the main cache before writing
+/// it, which happens on destruction and whenever save() is called. Caches of
+/// threads that have exited are merged and destroyed when the next new thread
+/// asks for one, so short-lived threads don't pile up.
+class PipelineCache {
+public:
+  PipelineCache() = default;
+  PipelineCache(const PipelineCache &) = delete;
+  PipelineCache &operator=(const PipelineCache &) = delete;
+  PipelineCache(PipelineCache &&) = delete;
+  PipelineCache &operator=(PipelineCache &&) = delete;
+  ~PipelineCache();
+
+  /* An empty path keeps the cache in memory only */
+  void init(std::filesystem::path path);
+
+  /* The calling thread's cache, pass it to every pipeline creation */
+  vk::PipelineCache get();
+
+  /* Merges every thread's cache and writes the result to a temporary file
+   * that is then renamed over the old one, so a crash never leaves a
+   * truncated cache behind. Not safe to call while pipelines are being
+   * created. */
+  void save();
+
+private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t checksum;
+  };
+
+  static constexpr char MAGIC[4] = {'V', 'K', 'P', 'C'};
+  static constexpr uint32_t VERSION = 1;
+
+  Header makeHeader(const std::vector<uint8_t> &data) const;
+  std::vector<uint8_t> load() const;
+  /* Callers hold mutex */
+  void pruneExited();
+
+  std::filesystem::path path;
+  /* Kept so saving on destruction doesn't go through Engine */
+  vk::Device device;
+  vk::PhysicalDeviceProperties properties;
+
+  vk::UniquePipelineCache main;
+  struct ThreadCache {
+    vk::UniquePipelineCache cache;
+    std::weak_ptr<const void> thread;
+  };
+  std::unordered_map<std::thread::id, ThreadCache> threadCaches;
+  std::mutex mutex;
+};
+} // namespace Vulking
@@ -0,0 +1,353 @@
+#include "PipelineRegistry.hpp"
+
+#include "Engine.hpp"
+
+#include <algorithm>
+
+namespace Vulking {
+namespace {
+template <typename T> void hashCombine(size_t &seed, const T &value) {
+  seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) +
+          (seed >> 2);
+}
+
+template <typename T> void hashEnum(size_t &seed, T value) {
+  hashCombine(seed, static_cast<uint64_t>(value));
+}
+
+template <typename T> void hashFlags(size_t &seed, vk::Flags<T> flags) {
+  hashCombine(seed, static_cast<uint64_t>(
+                        static_cast<typename vk::Flags<T>::MaskType>(flags)));
+}
+
+template <typename T> void hashHandle(size_t &seed, const T &handle) {
+  hashCombine(seed, getVulkanHandle(handle));
+}
+} // namespace
+
+size_t Specialization::hash() const {
+  size_t seed = 0;
+  for (const auto &[constantId, value] : values) {
+    hashCombine(seed, constantId);
+    hashCombine(seed, value);
+  }
+  return seed;
+}
+
+size_t PipelineLayoutDesc::hash() const {
+  size_t seed = 0;
+  for (const auto &setLayout : setLayouts) {
+    hashHandle(seed, setLayout);
+  }
+  for (const auto &range : pushConstantRanges) {
+    hashFlags(seed, range.stageFlags);
+    hashCombine(seed, range.offset);
+    hashCombine(seed, range.size);
+  }
+  return seed;
+}
+
+RenderPassDesc
+RenderPassDesc::fromCreateInfo(vk::RenderPass renderPass,
+                               const vk::RenderPassCreateInfo &info,
+                               uint32_t subpass) {
+  RenderPassDesc desc{.renderPass = renderPass, .subpass = subpass};
+  for (uint32_t i = 0; i < info.attachmentCount; i++) {
+    desc.attachments.emplace_back(info.pAttachments[i].format,
+                                  info.pAttachments[i].samples);
+  }
+  const auto indices = [](const vk::AttachmentReference *refs,
+                          uint32_t count) {
+    std::vector<uint32_t> result;
+    if (refs != nullptr) {
+      for (uint32_t i = 0; i < count; i++) {
+        result.push_back(refs[i].attachment);
+      }
+    }
+    return result;
+  };
+  for (uint32_t i = 0; i < info.subpassCount; i++) {
+    const auto &subpass = info.pSubpasses[i];
+    desc.subpasses.push_back(Subpass{
+        .inputs = indices(subpass.pInputAttachments,
+                          subpass.inputAttachmentCount),
+        .colors = indices(subpass.pColorAttachments,
+                          subpass.colorAttachmentCount),
+        .resolves = indices(subpass.pResolveAttachments,
+                            subpass.colorAttachmentCount),
+        .depth = subpass.pDepthStencilAttachment != nullptr
+                     ? subpass.pDepthStencilAttachment->attachment
+                     : vk::AttachmentUnused,
+    });
+  }
+  return desc;
+}
+
+size_t RenderPassDesc::hash() const {
+  size_t seed = 0;
+  for (const auto &[format, samples] : attachments) {
+    hashEnum(seed, format);
+    hashEnum(seed, samples);
+  }
+  for (const auto &description : subpasses) {
+    for (const auto *refs : {&description.inputs, &description.colors,
+                             &description.resolves}) {
+      hashCombine(seed, refs->size());
+      for (const auto attachment : *refs) {
+        hashCombine(seed, attachment);
+      }
+    }
+    hashCombine(seed, description.depth);
+  }
+  hashCombine(seed, subpass);
+  return seed;
+}
+
+size_t GraphicsPipelineDesc::hash() const {
+  size_t seed = 0;
+  for (const auto &stage : stages) {
+    hashEnum(seed, stage.stage);
+    hashCombine(seed, stage.code.hash());
+    hashCombine(seed, stage.entrypoint);
+    hashCombine(seed, stage.specialization.hash());
+  }
+  for (const auto &binding : bindings) {
+    hashCombine(seed, binding.binding);
+    hashCombine(seed, binding.stride);
+    hashEnum(seed, binding.inputRate);
+  }
+  for (const auto &attribute : attributes) {
+    hashCombine(seed, attribute.location);
+    hashCombine(seed, attribute.binding);
+    hashEnum(seed, attribute.format);
+    hashCombine(seed, attribute.offset);
+  }
+  hashEnum(seed, topology);
+  hashEnum(seed, polygonMode);
+  hashFlags(seed, cullMode);
+  hashEnum(seed, frontFace);
+  hashCombine(seed, depthTest);
+  hashCombine(seed, depthWrite);
+  hashEnum(seed, depthCompare);
+  hashEnum(seed, samples);
+  hashCombine(seed, sampleShading);
+  hashCombine(seed, minSampleShading);
+  for (const auto &blend : blendAttachments) {
+    hashCombine(seed, static_cast<bool>(blend.blendEnable));
+    hashEnum(seed, blend.srcColorBlendFactor);
+    hashEnum(seed, blend.dstColorBlendFactor);
+    hashEnum(seed, blend.colorBlendOp);
+    hashEnum(seed, blend.srcAlphaBlendFactor);
+    hashEnum(seed, blend.dstAlphaBlendFactor);
+    hashEnum(seed, blend.alphaBlendOp);
+    hashFlags(seed, blend.colorWriteMask);
+  }
+  hashCombine(seed, layout.hash());
+  hashCombine(seed, renderPass.hash());
+  return seed;
+}
+
+vk::Pipeline GraphicsPipeline::get() const {
+  if (state.load(std::memory_order_acquire) == State::Ready) {
+    return pipeline.get();
+  }
+  return fallback ? fallback->get() : vk::Pipeline{};
+}
+
+void GraphicsPipeline::wait() const {
+  state.wait(State::Pending, std::memory_order_acquire);
+  if (state.load(std::memory_order_acquire) == State::Failed) {
+    std::rethrow_exception(error);
+  }
+}
+
+void GraphicsPipeline::compile() {
+  PROFILE_ZONE("GraphicsPipeline::compile");
+  auto &ctx = Engine::ctx();
+
+  struct StageSpecialization {
+    std::vector<vk::SpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    vk::SpecializationInfo info;
+  };
+  /* Sized up front, stage infos point into them */
+  std::vector<StageSpecialization> specializations(desc.stages.size());
+  std::vector<vk::UniqueShaderModule> modules(desc.stages.size());
+  std::vector<vk::PipelineShaderStageCreateInfo> stageInfos;
+  stageInfos.reserve(desc.stages.size());
+  for (size_t i = 0; i < desc.stages.size(); i++) {
+    const auto &stage = desc.stages[i];
+    // Only needed until the pipeline is created
+    modules[i] = ctx.device->createShaderModuleUnique(
+        stage.code.getCreateInfo());
+    auto stageInfo = vk::PipelineShaderStageCreateInfo{}
+                         .setStage(stage.stage)
+                         .setModule(modules[i].get())
+                         .setPName(stage.entrypoint.c_str());
+    if (!stage.specialization.empty()) {
+      auto &specialization = specializations[i];
+      for (const auto &[constantId, value] :
+           stage.specialization.getValues()) {
+        specialization.entries.push_back(
+            vk::SpecializationMapEntry{}
+                .setConstantID(constantId)
+                .setOffset(static_cast<uint32_t>(specialization.data.size() *
+                                                 sizeof(uint32_t)))
+                .setSize(sizeof(uint32_t)));
+        specialization.data.push_back(value);
+      }
+      specialization.info =
+          vk::SpecializationInfo{}
+              .setMapEntries(specialization.entries)
+              .setDataSize(specialization.data.size() * sizeof(uint32_t))
+              .setPData(specialization.data.data());
+      stageInfo.setPSpecializationInfo(&specialization.info);
+    }
+    stageInfos.push_back(stageInfo);
+  }
+
+  const auto vertexInputInfo =
+      vk::PipelineVertexInputStateCreateInfo{}
+          .setVertexBindingDescriptions(desc.bindings)
+          .setVertexAttributeDescriptions(desc.attributes);
+  const auto inputAssemblyInfo =
+      vk::PipelineInputAssemblyStateCreateInfo{}
+          .setTopology(desc.topology)
+          .setPrimitiveRestartEnable(vk::False);
+  const auto viewportInfo =
+      vk::PipelineViewportStateCreateInfo{}.setViewportCount(1).setScissorCount(
+          1);
+  const auto rasterizationInfo =
+      vk::PipelineRasterizationStateCreateInfo{}
+          .setDepthClampEnable(vk::False)
+          .setDepthBiasEnable(vk::False)
+          .setRasterizerDiscardEnable(vk::False)
+          .setPolygonMode(desc.polygonMode)
+          .setCullMode(desc.cullMode)
+          .setFrontFace(desc.frontFace)
+          .setLineWidth(1.0f);
+  const auto depthStencilInfo =
+      vk::PipelineDepthStencilStateCreateInfo{}
+          .setDepthTestEnable(desc.depthTest)
+          .setDepthWriteEnable(desc.depthWrite)
+          .setDepthCompareOp(desc.depthCompare)
+          .setDepthBoundsTestEnable(vk::False)
+          .setStencilTestEnable(vk::False);
+  const auto multisampleInfo =
+      vk::PipelineMultisampleStateCreateInfo{}
+          .setRasterizationSamples(desc.samples)
+          .setSampleShadingEnable(desc.sampleShading)
+          .setMinSampleShading(desc.minSampleShading);
+  const auto colorBlendInfo = vk::PipelineColorBlendStateCreateInfo{}
+                                  .setLogicOpEnable(vk::False)
+                                  .setLogicOp(vk::LogicOp::eCopy)
+                                  .setAttachments(desc.blendAttachments)
+                                  .setBlendConstants({0.0f, 0.0f, 0.0f, 0.0f});
+  const std::array<vk::DynamicState, 2> dynamicStates = {
+      vk::DynamicState::eViewport,
+      vk::DynamicState::eScissor,
+  };
+  const auto dynamicInfo =
+      vk::PipelineDynamicStateCreateInfo{}.setDynamicStates(dynamicStates);
+
+  const auto pipelineInfo = vk::GraphicsPipelineCreateInfo{}
+                                .setStages(stageInfos)
+                                .setPVertexInputState(&vertexInputInfo)
+                                .setPInputAssemblyState(&inputAssemblyInfo)
+                                .setPViewportState(&viewportInfo)
+                                .setPRasterizationState(&rasterizationInfo)
+                                .setPMultisampleState(&multisampleInfo)
+                                .setPDepthStencilState(&depthStencilInfo)
+                                .setPColorBlendState(&colorBlendInfo)
+                                .setPDynamicState(&dynamicInfo)
+                                .setLayout(layout)
+                                .setRenderPass(desc.renderPass.renderPass)
+                                .setSubpass(desc.renderPass.subpass);
+
+  try {
+    auto result = ctx.device->createGraphicsPipelineUnique(
+        ctx.pipelineCache.get(), pipelineInfo);
+    if (result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed creating graphics pipeline {}: {}", name,
+                      vk::to_string(result.result)));
+    }
+    pipeline = std::move(result.value);
+    NAME_OBJECT(ctx.device, pipeline.get(), name);
+    state.store(State::Ready, std::memory_order_release);
+  } catch (const std::exception &e) {
+    LOG_ERROR("failed compiling pipeline " << name << ": " << e.what());
+    error = std::current_exception();
+    state.store(State::Failed, std::memory_order_release);
+  }
+  state.notify_all();
+}
+
+void PipelineRegistry::init(uint32_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+  }
+  compiler.init(threadCount);
+}
+
+std::shared_ptr<GraphicsPipeline>
+PipelineRegistry::request(const GraphicsPipelineDesc &desc, const char *name,
+                          std::shared_ptr<GraphicsPipeline> fallback) {
+  requests.fetch_add(1, std::memory_order_relaxed);
+  std::shared_ptr<GraphicsPipeline> pipeline;
+  {
+    std::lock_guard lock(mutex);
+    if (const auto found = pipelines.find(desc); found != pipelines.end()) {
+      return found->second;
+    }
+    pipeline = std::make_shared<GraphicsPipeline>(
+        desc, getLayoutLocked(desc.layout), name, std::move(fallback));
+    pipelines.emplace(desc, pipeline);
+  }
+
+  pending.fetch_add(1);
+  compiler.submit([this, pipeline](uint32_t) {
+    pipeline->compile();
+    if (pending.fetch_sub(1) == 1) {
+      pending.notify_all();
+    }
+  });
+  return pipeline;
+}
+
+std::shared_ptr<GraphicsPipeline>
+PipelineRegistry::get(const GraphicsPipelineDesc &desc, const char *name) {
+  auto pipeline = request(desc, name);
+  pipeline->wait();
+  return pipeline;
+}
+
+vk::PipelineLayout
+PipelineRegistry::getLayout(const PipelineLayoutDesc &desc) {
+  std::lock_guard lock(mutex);
+  return getLayoutLocked(desc);
+}
+
+vk::PipelineLayout
+PipelineRegistry::getLayoutLocked(const PipelineLayoutDesc &desc) {
+  if (const auto found = layouts.find(desc); found != layouts.end()) {
+    return found->second.get();
+  }
+  auto layout = Engine::ctx().device->createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo{}
+          .setSetLayouts(desc.setLayouts)
+          .setPushConstantRanges(desc.pushConstantRanges));
+  return layouts.emplace(desc, std::move(layout)).first->second.get();
+}
+
+void PipelineRegistry::waitIdle() const {
+  for (auto count = pending.load(); count != 0; count = pending.load()) {
+    pending.wait(count);
+  }
+}
+
+size_t PipelineRegistry::getUniqueCount() const {
+  std::lock_guard lock(mutex);
+  return pipelines.size();
+}
+} // namespace Vulking
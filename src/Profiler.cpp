@@ -0,0 +1,189 @@
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace Vulking {
+namespace {
+struct Event {
+  const ZoneSite *site;
+  uint64_t begin;
+  /* The frame number for frame markers */
+  uint64_t end;
+};
+
+struct Chunk {
+  std::array<Event, Profiler::EVENTS_PER_CHUNK> events;
+};
+
+struct ThreadBuffer {
+  uint32_t id;
+  /* Guarded by Registry::mutex */
+  std::string name;
+  /* Only the owning thread writes, readers stop at count */
+  std::array<std::unique_ptr<Chunk>, Profiler::MAX_CHUNKS_PER_THREAD> chunks;
+  std::atomic<size_t> count = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::atomic<uint64_t> dropped = 0;
+  const std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+Registry &getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+constexpr ZoneSite FRAME_SITE{.name = "frame", .location = ""};
+
+ThreadBuffer &getThreadBuffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (!buffer) {
+    auto &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    auto &entry =
+        registry.buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    entry->id = static_cast<uint32_t>(registry.buffers.size());
+    entry->name = std::format("thread {}", entry->id);
+    buffer = entry.get();
+  }
+  return *buffer;
+}
+
+/* Log prefixes are padded for alignment, the trace doesn't want that */
+std::string_view trimLocation(const char *location) {
+  std::string_view view(location);
+  while (!view.empty() && view.back() == ' ') {
+    view.remove_suffix(1);
+  }
+  return view;
+}
+} // namespace
+
+std::string Profiler::escapeJson(std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (const auto c : text) {
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      escaped += std::format("\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+uint64_t Profiler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - getRegistry().epoch)
+      .count();
+}
+
+void Profiler::record(const ZoneSite *site, uint64_t begin, uint64_t end) {
+  auto &buffer = getThreadBuffer();
+  const auto count = buffer.count.load(std::memory_order_relaxed);
+  const auto chunk = count / EVENTS_PER_CHUNK;
+  if (chunk >= MAX_CHUNKS_PER_THREAD) {
+    getRegistry().dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (!buffer.chunks[chunk]) {
+    // Left uninitialized, only the published part is ever read
+    buffer.chunks[chunk].reset(new Chunk);
+  }
+  buffer.chunks[chunk]->events[count % EVENTS_PER_CHUNK] = Event{
+      .site = site,
+      .begin = begin,
+      .end = end,
+  };
+  buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void Profiler::markFrame(uint64_t frame) { record(&FRAME_SITE, now(), frame); }
+
+void Profiler::setThreadName(const std::string &name) {
+  auto &buffer = getThreadBuffer();
+  std::lock_guard lock(getRegistry().mutex);
+  buffer.name = name;
+}
+
+uint64_t Profiler::getDroppedEvents() { return getRegistry().dropped; }
+
+void Profiler::writeChromeTrace(const std::string &path) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error(std::format("failed to open file '{}'", path));
+  }
+
+  auto &registry = getRegistry();
+  std::lock_guard lock(registry.mutex);
+
+  const auto toUs = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+  size_t written = 0;
+  bool first = true;
+  const auto separator = [&] {
+    const auto *text = first ? "\n" : ",\n";
+    first = false;
+    return text;
+  };
+
+  file << "{\"traceEvents\":[";
+  for (const auto &buffer : registry.buffers) {
+    file << separator()
+         << std::format(R"({{"name":"thread_name","ph":"M","pid":0,"tid":{},)"
+                        R"("args":{{"name":"{}"}}}})",
+                        buffer->id, escapeJson(buffer->name));
+
+    const auto count = buffer->count.load(std::memory_order_acquire);
+    std::optional<Event> lastFrame;
+    for (size_t i = 0; i < count; i++) {
+      const auto &event =
+          buffer->chunks[i / EVENTS_PER_CHUNK]->events[i % EVENTS_PER_CHUNK];
+      if (event.site == &FRAME_SITE) {
+        file << separator()
+             << std::format(R"({{"name":"frame {}","ph":"i","s":"t",)"
+                            R"("pid":0,"tid":{},"ts":{:.3f}}})",
+                            event.end, buffer->id, toUs(event.begin));
+        if (lastFrame) {
+          file << separator()
+               << std::format(R"({{"name":"frame","cat":"frame","ph":"X",)"
+                              R"("pid":0,"tid":{},"ts":{:.3f},"dur":{:.3f},)"
+                              R"("args":{{"frame":{}}}}})",
+                              buffer->id, toUs(lastFrame->begin),
+                              toUs(event.begin - lastFrame->begin),
+                              lastFrame->end);
+        }
+        lastFrame = event;
+      } else {
+        file << separator()
+             << std::format(R"({{"name":"{}","cat":"cpu","ph":"X","pid":0,)"
+                            R"("tid":{},"ts":{:.3f},"dur":{:.3f},)"
+                            R"("args":{{"location":"{}"}}}})",
+                            escapeJson(event.site->name), buffer->id,
+                            toUs(event.begin), toUs(event.end - event.begin),
+                            escapeJson(trimLocation(event.site->location)));
+      }
+      written++;
+    }
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  LOG_INFO("wrote " << written << " CPU events from "
+                    << registry.buffers.size() << " threads to " << path
+                    << " (" << registry.dropped << " dropped)");
+}
+} // namespace Vulking
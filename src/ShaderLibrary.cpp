@@ -0,0 +1,76 @@
+#include "ShaderLibrary.hpp"
+
+#include "Engine.hpp"
+
+namespace Vulking {
+namespace {
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+/* FNV-1a over whole words, shaders are small */
+size_t hashWords(std::span<const uint32_t> words) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const auto word : words) {
+    hash = (hash ^ word) * 0x100000001b3ull;
+  }
+  return static_cast<size_t>(hash);
+}
+} // namespace
+
+ShaderCode::ShaderCode(std::span<const uint32_t> words,
+                       std::shared_ptr<const MappedFile> file)
+    : words(words), file(std::move(file)), contentHash(hashWords(words)) {
+  if (words.empty() || words[0] != SPIRV_MAGIC) {
+    throw std::runtime_error("not SPIR-V, or not in host byte order");
+  }
+}
+
+vk::UniqueShaderModule ShaderCode::createModule(const char *name) const {
+  auto &ctx = Engine::ctx();
+  auto module = ctx.device->createShaderModuleUnique(getCreateInfo());
+  NAME_OBJECT(ctx.device, module.get(), name);
+  return module;
+}
+
+void ShaderLibrary::addPack(std::filesystem::path directory) {
+  if (!std::filesystem::is_directory(directory)) {
+    throw std::runtime_error(std::format("shader pack '{}' is not a directory",
+                                         directory.string()));
+  }
+  std::lock_guard lock(mutex);
+  packs.push_back(std::move(directory));
+}
+
+ShaderCode ShaderLibrary::load(const std::string &name) {
+  std::lock_guard lock(mutex);
+  if (const auto found = embedded.find(name); found != embedded.end()) {
+    return found->second;
+  }
+  if (const auto found = mapped.find(name); found != mapped.end()) {
+    return found->second;
+  }
+
+  for (const auto &pack : packs) {
+    const auto path = pack / name;
+    if (!std::filesystem::exists(path)) {
+      continue;
+    }
+    auto file = std::make_shared<const MappedFile>(path);
+    if (file->size() % sizeof(uint32_t) != 0) {
+      throw std::runtime_error(std::format(
+          "'{}' is not SPIR-V, its size isn't a multiple of 4", path.string()));
+    }
+    // Mappings are page aligned, so the words can be used in place
+    const std::span<const uint32_t> words(
+        reinterpret_cast<const uint32_t *>(file->data()),
+        file->size() / sizeof(uint32_t));
+    try {
+      return mapped.emplace(name, ShaderCode(words, std::move(file)))
+          .first->second;
+    } catch (const std::runtime_error &e) {
+      throw std::runtime_error(
+          std::format("'{}': {}", path.string(), e.what()));
+    }
+  }
+  throw std::runtime_error(std::format("shader '{}' not found", name));
+}
+} // namespace Vulking
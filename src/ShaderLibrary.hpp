@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Common.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+
+namespace Vulking {
+/// SPIR-V words ready for vkCreateShaderModule. Points straight at an
+/// embedded array or at a file mapping it keeps alive, never at a copy.
+/// Compares and hashes by the words, so the same shader loaded twice or from
+/// different sources is the same code.
+class ShaderCode {
+public:
+  ShaderCode() = default;
+  /* Throws unless words start with the SPIR-V magic number */
+  ShaderCode(std::span<const uint32_t> words,
+             std::shared_ptr<const MappedFile> file = nullptr);
+
+  std::span<const uint32_t> getWords() const { return words; }
+  size_t hash() const { return contentHash; }
+  vk::ShaderModuleCreateInfo getCreateInfo() const {
+    return vk::ShaderModuleCreateInfo{}
+        .setCodeSize(words.size_bytes())
+        .setPCode(words.data());
+  }
+  vk::UniqueShaderModule createModule(const char *name = "unnamed") const;
+
+  bool operator==(const ShaderCode &other) const {
+    return contentHash == other.contentHash &&
+           std::ranges::equal(words, other.words);
+  }
+
+private:
+  std::span<const uint32_t> words;
+  std::shared_ptr<const MappedFile> file;
+  size_t contentHash = 0;
+};
+
+/// Finds shaders by name, first among the arrays embedded in the binary by
+/// vulking_embed_shaders (see cmake/VulkingShaders.cmake) and then in shader
+/// pack directories, whose .spv files are memory mapped on first use.
+class ShaderLibrary {
+public:
+  ShaderLibrary() = default;
+  ShaderLibrary(const ShaderLibrary &) = delete;
+  ShaderLibrary &operator=(const ShaderLibrary &) = delete;
+  ShaderLibrary(ShaderLibrary &&) = delete;
+  ShaderLibrary &operator=(ShaderLibrary &&) = delete;
+
+  /* Takes EmbeddedShaders::ALL from the generated embedded_shaders.hpp, or
+   * any other range of (name, words) pairs that outlives the library */
+  template <typename Range> void addEmbedded(const Range &shaders) {
+    std::lock_guard lock(mutex);
+    for (const auto &[name, words] : shaders) {
+      embedded.insert_or_assign(std::string(name), ShaderCode(words));
+    }
+  }
+
+  /* Searched in the order added, after the embedded shaders */
+  void addPack(std::filesystem::path directory);
+
+  /* name is relative to the pack directories, e.g. "test.vert.spv". Throws
+   * if no source has it. Thread safe. */
+  ShaderCode load(const std::string &name);
+
+private:
+  std::mutex mutex;
+  std::map<std::string, ShaderCode, std::less<>> embedded;
+  std::vector<std::filesystem::path> packs;
+  /* Files mapped so far, kept so loading a shader twice maps it once */
+  std::map<std::string, ShaderCode, std::less<>> mapped;
+};
+} // namespace Vulking
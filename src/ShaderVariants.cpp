@@ -0,0 +1,113 @@
+#include "ShaderVariants.hpp"
+
+#include "Engine.hpp"
+
+namespace Vulking {
+ShaderVariants::Variant &ShaderVariants::Variant::enable(
+    std::string_view feature, bool enabled) {
+  specialization.set(find(feature, true), enabled);
+  return *this;
+}
+
+ShaderVariants::Variant &
+ShaderVariants::Variant::set(std::string_view constant, int32_t value) {
+  specialization.set(find(constant, false), value);
+  return *this;
+}
+
+ShaderVariants::Variant &
+ShaderVariants::Variant::set(std::string_view constant, uint32_t value) {
+  specialization.set(find(constant, false), value);
+  return *this;
+}
+
+ShaderVariants::Variant &
+ShaderVariants::Variant::set(std::string_view constant, float value) {
+  specialization.set(find(constant, false), value);
+  return *this;
+}
+
+uint32_t ShaderVariants::Variant::find(std::string_view name,
+                                       bool feature) const {
+  const auto found = variants->declarations.find(name);
+  if (found == variants->declarations.end()) {
+    throw std::runtime_error(std::format("{} has no constant named '{}'",
+                                         variants->name, name));
+  }
+  if (found->second.feature != feature) {
+    throw std::runtime_error(
+        std::format("{}: '{}' is {}", variants->name, name,
+                    feature ? "a constant, not a feature"
+                            : "a feature, not a constant"));
+  }
+  return found->second.constantId;
+}
+
+ShaderVariants::ShaderVariants(GraphicsPipelineDesc base, std::string name)
+    : base(std::move(base)), name(std::move(name)) {}
+
+ShaderVariants &ShaderVariants::feature(std::string name,
+                                        uint32_t constantId) {
+  declarations.insert_or_assign(std::move(name),
+                                Declaration{constantId, true});
+  return *this;
+}
+
+ShaderVariants &ShaderVariants::constant(std::string name,
+                                         uint32_t constantId) {
+  declarations.insert_or_assign(std::move(name),
+                                Declaration{constantId, false});
+  return *this;
+}
+
+std::shared_ptr<GraphicsPipeline>
+ShaderVariants::request(const Variant &variant,
+                        std::shared_ptr<GraphicsPipeline> fallback) {
+  if (variant.variants != this) {
+    throw std::runtime_error(
+        std::format("variant requested from {}, but made by {}", name,
+                    variant.variants->name));
+  }
+  const auto &specialization = variant.getSpecialization();
+  std::lock_guard lock(mutex);
+  auto &entry = variants[specialization];
+  if (!entry) {
+    auto desc = base;
+    for (auto &stage : desc.stages) {
+      stage.specialization = specialization;
+    }
+    entry = Engine::ctx().pipelines.request(
+        desc, getVariantName(specialization).c_str(), std::move(fallback));
+  }
+  return entry;
+}
+
+std::shared_ptr<GraphicsPipeline>
+ShaderVariants::get(const Variant &variant) {
+  auto pipeline = request(variant);
+  pipeline->wait();
+  return pipeline;
+}
+
+size_t ShaderVariants::getVariantCount() const {
+  std::lock_guard lock(mutex);
+  return variants.size();
+}
+
+std::string
+ShaderVariants::getVariantName(const Specialization &specialization) const {
+  const auto &values = specialization.getValues();
+  std::string variantName = name + "[";
+  bool first = true;
+  for (const auto &[constantName, declaration] : declarations) {
+    const auto value = values.find(declaration.constantId);
+    if (value == values.end()) {
+      continue;
+    }
+    variantName += std::format("{}{}={}", first ? "" : ",", constantName,
+                               value->second);
+    first = false;
+  }
+  return variantName + "]";
+}
+} // namespace Vulking
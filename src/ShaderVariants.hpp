@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Common.hpp"
+#include "PipelineRegistry.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Vulking {
+/// One shader source compiled into many pipelines. Features (bool
+/// constants) and tunables (int, uint or float constants) are declared by
+/// name against the shaders' constant_ids, and each material picks values
+/// for them; the driver then drops the dead branches when it compiles that
+/// variant instead of the fragment shader testing them every pixel.
+///
+/// Constant ids are shared by all stages of the base description, a stage
+/// that doesn't declare one ignores it. Variants are cached by their
+/// constant values and compiled through Context::pipelines, so materials
+/// that pick the same values share one pipeline.
+class ShaderVariants {
+public:
+  /// The constant values of one variant, set by the names declared on the
+  /// ShaderVariants that made it. Unknown names throw.
+  class Variant {
+  public:
+    Variant &enable(std::string_view feature, bool enabled = true);
+    Variant &set(std::string_view constant, int32_t value);
+    Variant &set(std::string_view constant, uint32_t value);
+    Variant &set(std::string_view constant, float value);
+
+    const Specialization &getSpecialization() const { return specialization; }
+
+  private:
+    friend class ShaderVariants;
+    explicit Variant(const ShaderVariants &variants) : variants(&variants) {}
+
+    uint32_t find(std::string_view name, bool feature) const;
+
+    const ShaderVariants *variants;
+    Specialization specialization;
+  };
+
+  ShaderVariants(GraphicsPipelineDesc base, std::string name);
+  ShaderVariants(const ShaderVariants &) = delete;
+  ShaderVariants &operator=(const ShaderVariants &) = delete;
+  ShaderVariants(ShaderVariants &&) = delete;
+  ShaderVariants &operator=(ShaderVariants &&) = delete;
+
+  /* Declares the bool constant at constantId as a feature toggle */
+  ShaderVariants &feature(std::string name, uint32_t constantId);
+  /* Declares the 32 bit constant at constantId as a tunable value */
+  ShaderVariants &constant(std::string name, uint32_t constantId);
+
+  /* A variant where every constant keeps the shader's default */
+  Variant variant() const { return Variant(*this); }
+
+  /* The shared pipeline for variant, queued on Context::pipelines the first
+   * time its values are seen. See PipelineRegistry::request for fallback. */
+  std::shared_ptr<GraphicsPipeline>
+  request(const Variant &variant,
+          std::shared_ptr<GraphicsPipeline> fallback = nullptr);
+  /* request() then wait() */
+  std::shared_ptr<GraphicsPipeline> get(const Variant &variant);
+
+  size_t getVariantCount() const;
+
+private:
+  struct Declaration {
+    uint32_t constantId;
+    bool feature;
+  };
+
+  /* e.g. "lit[LIGHTS=4,SHADOWS=1]", listing the constants set as raw words */
+  std::string getVariantName(const Specialization &specialization) const;
+
+  GraphicsPipelineDesc base;
+  std::string name;
+  std::map<std::string, Declaration, std::less<>> declarations;
+
+  mutable std::mutex mutex;
+  std::map<Specialization, std::shared_ptr<GraphicsPipeline>> variants;
+};
+} // namespace Vulking
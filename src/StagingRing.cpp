@@ -0,0 +1,234 @@
+#include "StagingRing.hpp"
+
+#include "Buffer.hpp"
+#include "Engine.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace Vulking {
+void StagingRing::init(vk::DeviceSize size) {
+  auto &ctx = Engine::ctx();
+  capacity = size;
+  buffer = ctx.device->createBufferUnique(
+      vk::BufferCreateInfo{}
+          .setSize(size)
+          .setUsage(BufferUsage::STAGING)
+          .setSharingMode(vk::SharingMode::eExclusive));
+  memory = ctx.allocator.allocate(buffer.get(), BufferMemory::STAGING,
+                                  "staging_ring");
+  ctx.device->bindBufferMemory(buffer.get(), memory.getMemory(),
+                               memory.getOffset());
+  NAME_OBJECT(ctx.device, buffer.get(), "staging_ring_buffer");
+
+  pData = static_cast<char *>(memory.getMappedData());
+  assert(pData != nullptr);
+}
+
+StagingRing::Scope StagingRing::openScope() {
+  std::lock_guard lock(mutex);
+  return nextScope++;
+}
+
+StagingSlice StagingRing::allocate(vk::DeviceSize size, Scope scope,
+                                   vk::DeviceSize alignment) {
+  assert(size != 0);
+  std::unique_lock lock(mutex);
+
+  if (size > capacity) {
+    return allocateOversized(size, scope);
+  }
+
+  while (true) {
+    if (const auto offset = tryAllocate(size, alignment, scope)) {
+      return StagingSlice{
+          .buffer = buffer.get(),
+          .offset = offset.value(),
+          .size = size,
+          .pData = pData + offset.value(),
+      };
+    }
+
+    // Reclaim what the GPU is done with, and only block if that wasn't enough
+    const auto before = used;
+    retire(false);
+    if (used == before) {
+      if (!spans.empty() && !spans.front().fence) {
+        if (spans.front().scope == scope) {
+          throw std::runtime_error(std::format(
+              "staging ring exhausted: {} bytes requested, {} of {} bytes "
+              "held by uploads that have not been committed",
+              size, used, capacity));
+        }
+        // Another submitter's, it frees up once that one commits
+        LOG_DEBUG("staging ring full, waiting for scope "
+                  << spans.front().scope << " to commit");
+        committed.wait(lock, [&] {
+          return spans.empty() || spans.front().fence != nullptr;
+        });
+        continue;
+      }
+      LOG_DEBUG("staging ring full, waiting for oldest upload");
+      retire(true);
+    }
+  }
+}
+
+StagingSlice StagingRing::upload(const void *src, vk::DeviceSize size,
+                                 Scope scope, vk::DeviceSize alignment) {
+  auto slice = allocate(size, scope, alignment);
+  memcpy(slice.pData, src, size);
+  return slice;
+}
+
+vk::Fence StagingRing::commit(Scope scope) {
+  std::unique_lock lock(mutex);
+  retire(false);
+
+  auto &fence = acquireFence();
+  fence.committed = true;
+  for (auto &span : spans) {
+    if (span.scope == scope && !span.fence) {
+      span.fence = &fence;
+      fence.refs++;
+    }
+  }
+  for (auto &entry : oversized) {
+    if (entry.scope == scope && !entry.fence) {
+      entry.fence = &fence;
+      fence.refs++;
+    }
+  }
+  lock.unlock();
+  committed.notify_all();
+  return fence.fence.get();
+}
+
+std::optional<vk::DeviceSize> StagingRing::tryAllocate(vk::DeviceSize size,
+                                                       vk::DeviceSize alignment,
+                                                       Scope scope) {
+  if (spans.empty()) {
+    // Nothing live, start over at the front for the most contiguous space
+    head = 0;
+  } else if (used == capacity) {
+    return std::nullopt;
+  }
+
+  const auto tail = spans.empty() ? head : spans.front().begin;
+  const auto aligned = alignUp(head, alignment);
+
+  vk::DeviceSize offset;
+  vk::DeviceSize consumed;
+  if (spans.empty() || head > tail) {
+    // Free space is [head, capacity) and [0, tail)
+    if (aligned + size <= capacity) {
+      offset = aligned;
+      consumed = aligned + size - head;
+    } else if (size <= tail) {
+      // Wrap around, the end of the ring is wasted until we come back
+      offset = 0;
+      consumed = capacity - head + size;
+    } else {
+      return std::nullopt;
+    }
+  } else {
+    // Free space is [head, tail)
+    if (aligned + size > tail) {
+      return std::nullopt;
+    }
+    offset = aligned;
+    consumed = aligned + size - head;
+  }
+
+  auto *last = spans.empty() ? nullptr : &spans.back();
+  if (last && last->scope == scope && !last->fence) {
+    last->bytes += consumed;
+  } else {
+    spans.push_back(Span{.begin = head, .bytes = consumed, .scope = scope});
+  }
+  used += consumed;
+  head = offset + size;
+  return offset;
+}
+
+StagingSlice StagingRing::allocateOversized(vk::DeviceSize size, Scope scope) {
+  auto &ctx = Engine::ctx();
+  LOG_DEBUG("staging request of " << size
+                                  << " bytes is larger than the ring, "
+                                     "using a dedicated buffer");
+  Oversized entry{.scope = scope};
+  entry.buffer = ctx.device->createBufferUnique(
+      vk::BufferCreateInfo{}
+          .setSize(size)
+          .setUsage(BufferUsage::STAGING)
+          .setSharingMode(vk::SharingMode::eExclusive));
+  entry.memory = ctx.allocator.allocate(
+      entry.buffer.get(), BufferMemory::STAGING, "staging_oversized");
+  ctx.device->bindBufferMemory(entry.buffer.get(), entry.memory.getMemory(),
+                               entry.memory.getOffset());
+
+  const auto slice = StagingSlice{
+      .buffer = entry.buffer.get(),
+      .offset = 0,
+      .size = size,
+      .pData = entry.memory.getMappedData(),
+  };
+  oversized.push_back(std::move(entry));
+  return slice;
+}
+
+void StagingRing::retire(bool wait) {
+  const auto device = Engine::ctx().device.get();
+
+  // The ring only frees from the front, so an uncommitted or unfinished span
+  // holds back everything allocated after it
+  while (!spans.empty() && spans.front().fence) {
+    auto &span = spans.front();
+    if (wait) {
+      CHK(device.waitForFences(span.fence->fence.get(), vk::True, UINT64_MAX),
+          "failed waiting for staging fence");
+      wait = false;
+    } else if (!isSignaled(*span.fence)) {
+      break;
+    }
+
+    used -= span.bytes;
+    span.fence->refs--;
+    spans.pop_front();
+  }
+
+  std::erase_if(oversized, [&](const Oversized &entry) {
+    if (entry.fence && isSignaled(*entry.fence)) {
+      entry.fence->refs--;
+      return true;
+    }
+    return false;
+  });
+
+  // Fences nothing waits on any more can be reused, once the submit they were
+  // handed to has signaled them
+  for (auto &fence : fences) {
+    if (fence.committed && fence.refs == 0 && isSignaled(fence)) {
+      fence.committed = false;
+    }
+  }
+}
+
+bool StagingRing::isSignaled(const Fence &fence) const {
+  return Engine::ctx().device->getFenceStatus(fence.fence.get()) ==
+         vk::Result::eSuccess;
+}
+
+StagingRing::Fence &StagingRing::acquireFence() {
+  const auto device = Engine::ctx().device.get();
+  for (auto &fence : fences) {
+    if (!fence.committed) {
+      device.resetFences(fence.fence.get());
+      return fence;
+    }
+  }
+  auto &fence = fences.emplace_back();
+  fence.fence = device.createFenceUnique(vk::FenceCreateInfo{});
+  return fence;
+}
+} // namespace Vulking
@@ -0,0 +1,136 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Vulking {
+namespace {
+/* Set for the lifetime of a worker thread */
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local uint32_t currentWorker = 0;
+} // namespace
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  // jthread joins on destruction
+  threads.clear();
+}
+
+void ThreadPool::init(uint32_t threadCount) {
+  assert(threads.empty());
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    threads.emplace_back([this, i] { run(i); });
+  }
+  LOG_INFO("started " << threadCount << " worker threads");
+}
+
+bool ThreadPool::isWorker() const { return currentPool == this; }
+
+size_t ThreadPool::getChunkCount(size_t count, size_t minChunk) const {
+  if (count == 0) {
+    return 0;
+  }
+  minChunk = std::max<size_t>(minChunk, 1);
+  const auto maxChunks = (count + minChunk - 1) / minChunk;
+  return std::clamp<size_t>(threads.size(), 1, maxChunks);
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const RangeFn &fn) {
+  assert(!threads.empty());
+  const auto chunks = getChunkCount(count, minChunk);
+  if (chunks == 0) {
+    return;
+  }
+  // Spread the remainder over the first chunks so none is more than one item
+  // larger than another
+  const auto chunkBegin = [&](size_t chunk) { return chunk * count / chunks; };
+  if (isWorker()) {
+    // Same chunks as the workers would get, callers like ParallelRecorder
+    // count on one call per chunk
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      fn(chunkBegin(chunk), chunkBegin(chunk + 1), currentWorker);
+    }
+    return;
+  }
+
+  struct Wait {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+    std::exception_ptr error;
+  } wait{.remaining = chunks};
+
+  {
+    std::lock_guard lock(mutex);
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      const auto begin = chunkBegin(chunk);
+      const auto end = chunkBegin(chunk + 1);
+      jobs.emplace_back([&wait, &fn, begin, end](uint32_t worker) {
+        std::exception_ptr error;
+        try {
+          fn(begin, end, worker);
+        } catch (...) {
+          error = std::current_exception();
+        }
+
+        std::lock_guard lock(wait.mutex);
+        if (error && !wait.error) {
+          wait.error = error;
+        }
+        if (--wait.remaining == 0) {
+          wait.done.notify_one();
+        }
+      });
+    }
+  }
+  wake.notify_all();
+
+  std::unique_lock lock(wait.mutex);
+  wait.done.wait(lock, [&] { return wait.remaining == 0; });
+  if (wait.error) {
+    std::rethrow_exception(wait.error);
+  }
+}
+
+void ThreadPool::submit(std::function<void(uint32_t worker)> fn) {
+  assert(!threads.empty());
+  {
+    std::lock_guard lock(mutex);
+    jobs.push_back(std::move(fn));
+  }
+  wake.notify_one();
+}
+
+void ThreadPool::run(uint32_t worker) {
+  PROFILE_THREAD_NAME(std::format("worker {}", worker));
+  currentPool = this;
+  currentWorker = worker;
+  while (true) {
+    std::function<void(uint32_t)> job;
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    job(worker);
+  }
+}
+
+std::weak_ptr<const void> getThreadLifetime() {
+  thread_local const std::shared_ptr<const void> lifetime =
+      std::make_shared<char>();
+  return lifetime;
+}
+} // namespace Vulking
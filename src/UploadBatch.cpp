@@ -0,0 +1,100 @@
+#include "UploadBatch.hpp"
+
+#include "Engine.hpp"
+#include "Functions.hpp"
+
+namespace Vulking {
+UploadBatch::UploadBatch(const char *name)
+    : name(name), stagingScope(Engine::ctx().staging.openScope()) {}
+
+UploadBatch::~UploadBatch() {
+  // Also reached while unwinding, where a second exception would terminate
+  try {
+    submit();
+  } catch (const std::exception &e) {
+    LOG_ERROR("failed submitting upload batch " << name << ": " << e.what());
+  }
+}
+
+vk::CommandBuffer UploadBatch::getCommandBuffer() {
+  begin();
+  recorded++;
+  return cmd;
+}
+
+void UploadBatch::copyToBuffer(const void *src, vk::DeviceSize size,
+                               vk::Buffer dst, vk::DeviceSize dstOffset) {
+  vk::Buffer staging;
+  const auto offset = stage(src, size, staging);
+  begin();
+  cmd.copyBuffer(staging, dst,
+                 vk::BufferCopy()
+                     .setSrcOffset(offset)
+                     .setDstOffset(dstOffset)
+                     .setSize(size));
+  recorded++;
+}
+
+void UploadBatch::copyToImage(const void *src, vk::DeviceSize size,
+                              vk::Image image, vk::Format format,
+                              uint32_t width, uint32_t height,
+                              uint32_t mipLevels) {
+  vk::Buffer staging;
+  const auto offset = stage(src, size, staging);
+  begin();
+  recordTransitionImageLayout(cmd, image, format, mipLevels,
+                              vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eTransferDstOptimal);
+  recordCopyBufferToImage(cmd, staging, offset, image, width, height);
+  // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating
+  // mipmaps
+  recordGenerateMipmaps(cmd, image, format, static_cast<int32_t>(width),
+                        static_cast<int32_t>(height), mipLevels);
+  recorded++;
+}
+
+void UploadBatch::transitionImageLayout(vk::Image image, vk::Format format,
+                                        uint32_t mipLevels,
+                                        vk::ImageLayout from,
+                                        vk::ImageLayout to) {
+  begin();
+  recordTransitionImageLayout(cmd, image, format, mipLevels, from, to);
+  recorded++;
+}
+
+void UploadBatch::submit() {
+  if (!cmd) {
+    return;
+  }
+  PROFILE_FUNCTION();
+  LOG_DEBUG("submitting upload batch " << name << ": " << recorded
+                                       << " operations, " << staged
+                                       << " staged bytes");
+  Engine::ctx().endAndSubmitGraphicsCommand(std::move(cmd), stagingScope);
+  cmd = nullptr;
+  staged = 0;
+  recorded = 0;
+  submitCount++;
+}
+
+void UploadBatch::begin() {
+  if (!cmd) {
+    cmd = Engine::ctx().beginCommand(name.c_str());
+  }
+}
+
+vk::DeviceSize UploadBatch::stage(const void *src, vk::DeviceSize size,
+                                  vk::Buffer &buffer) {
+  auto &staging = Engine::ctx().staging;
+  // Nothing we staged is committed until we submit, so don't let the batch
+  // grow past what the ring can hold. Half leaves room for alignment and
+  // wrap-around padding.
+  if (staged != 0 && staged + size > staging.getCapacity() / 2) {
+    submit();
+  }
+  const auto slice = staging.upload(src, size, stagingScope);
+  staged += size;
+  buffer = slice.buffer;
+  return slice.offset;
+}
+} // namespace Vulking
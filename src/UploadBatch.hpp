@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Common.hpp"
+#include "StagingRing.hpp"
+
+namespace Vulking {
+/// Records any number of uploads (buffer copies, image copies, layout
+/// transitions and mip blits) into one command buffer on the graphics queue
+/// and submits them together, so loading N assets costs one submit and one
+/// wait instead of several per asset.
+///
+/// Source data is copied into the staging ring while recording, so it doesn't
+/// have to outlive the call. If the batch stages more than the ring can hold
+/// it flushes what it has recorded so far and carries on.
+///
+/// Submits in the destructor if there is anything left to submit. Errors
+/// there are logged rather than thrown, call submit() to see them.
+class UploadBatch {
+public:
+  explicit UploadBatch(const char *name = "upload_batch");
+  UploadBatch(const UploadBatch &) = delete;
+  UploadBatch &operator=(const UploadBatch &) = delete;
+  UploadBatch(UploadBatch &&) = delete;
+  UploadBatch &operator=(UploadBatch &&) = delete;
+  ~UploadBatch();
+
+  void copyToBuffer(const void *src, vk::DeviceSize size, vk::Buffer dst,
+                    vk::DeviceSize dstOffset = 0);
+
+  /* Uploads mip level 0, generates the rest and leaves the image in
+   * eShaderReadOnlyOptimal */
+  void copyToImage(const void *src, vk::DeviceSize size, vk::Image image,
+                   vk::Format format, uint32_t width, uint32_t height,
+                   uint32_t mipLevels);
+
+  void transitionImageLayout(vk::Image image, vk::Format format,
+                             uint32_t mipLevels, vk::ImageLayout from,
+                             vk::ImageLayout to);
+
+  /* For anything not covered above. Valid until the next submit, which can
+   * happen inside any of the calls above. */
+  vk::CommandBuffer getCommandBuffer();
+
+  /* Submits everything recorded and waits for it. The batch can be reused
+   * afterwards. Does nothing if nothing was recorded. */
+  void submit();
+
+  uint32_t getSubmitCount() const { return submitCount; }
+
+private:
+  void begin();
+  vk::DeviceSize stage(const void *src, vk::DeviceSize size,
+                       vk::Buffer &buffer);
+
+  std::string name;
+  StagingRing::Scope stagingScope;
+  vk::CommandBuffer cmd;
+  /* bytes taken from the staging ring since the last submit */
+  vk::DeviceSize staged = 0;
+  uint32_t recorded = 0;
+  uint32_t submitCount = 0;
+};
+} // namespace Vulking
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <glm/gtc/packing.hpp>
+
+namespace Vulking {
+/* Packed attribute types, VertexFormat maps each to the format the vertex
+ * stage reads it with. All of them unpack to floats in the shader. */
+
+struct Half2 {
+  uint16_t x, y;
+
+  static Half2 pack(const glm::vec2 &v) {
+    return {glm::packHalf1x16(v.x), glm::packHalf1x16(v.y)};
+  }
+  glm::vec2 unpack() const {
+    return {glm::unpackHalf1x16(x), glm::unpackHalf1x16(y)};
+  }
+  bool operator==(const Half2 &) const = default;
+};
+
+/* Normals and tangents */
+struct Snorm8x4 {
+  int8_t x, y, z, w;
+
+  static Snorm8x4 pack(const glm::vec4 &v) {
+    return {std::bit_cast<int8_t>(glm::packSnorm1x8(v.x)),
+            std::bit_cast<int8_t>(glm::packSnorm1x8(v.y)),
+            std::bit_cast<int8_t>(glm::packSnorm1x8(v.z)),
+            std::bit_cast<int8_t>(glm::packSnorm1x8(v.w))};
+  }
+  glm::vec4 unpack() const {
+    return {glm::unpackSnorm1x8(std::bit_cast<uint8_t>(x)),
+            glm::unpackSnorm1x8(std::bit_cast<uint8_t>(y)),
+            glm::unpackSnorm1x8(std::bit_cast<uint8_t>(z)),
+            glm::unpackSnorm1x8(std::bit_cast<uint8_t>(w))};
+  }
+  bool operator==(const Snorm8x4 &) const = default;
+};
+
+/* Colors */
+struct Unorm8x4 {
+  uint8_t x, y, z, w;
+
+  static Unorm8x4 pack(const glm::vec4 &v) {
+    return {glm::packUnorm1x8(v.x), glm::packUnorm1x8(v.y),
+            glm::packUnorm1x8(v.z), glm::packUnorm1x8(v.w)};
+  }
+  glm::vec4 unpack() const {
+    return {glm::unpackUnorm1x8(x), glm::unpackUnorm1x8(y),
+            glm::unpackUnorm1x8(z), glm::unpackUnorm1x8(w)};
+  }
+  bool operator==(const Unorm8x4 &) const = default;
+};
+
+/* Positions quantized with a VertexQuantization */
+struct Snorm16x4 {
+  int16_t x, y, z, w;
+
+  static Snorm16x4 pack(const glm::vec4 &v) {
+    return {std::bit_cast<int16_t>(glm::packSnorm1x16(v.x)),
+            std::bit_cast<int16_t>(glm::packSnorm1x16(v.y)),
+            std::bit_cast<int16_t>(glm::packSnorm1x16(v.z)),
+            std::bit_cast<int16_t>(glm::packSnorm1x16(v.w))};
+  }
+  glm::vec4 unpack() const {
+    return {glm::unpackSnorm1x16(std::bit_cast<uint16_t>(x)),
+            glm::unpackSnorm1x16(std::bit_cast<uint16_t>(y)),
+            glm::unpackSnorm1x16(std::bit_cast<uint16_t>(z)),
+            glm::unpackSnorm1x16(std::bit_cast<uint16_t>(w))};
+  }
+  bool operator==(const Snorm16x4 &) const = default;
+};
+
+template <typename T> struct VertexFormat;
+template <> struct VertexFormat<float> {
+  static constexpr vk::Format FORMAT = vk::Format::eR32Sfloat;
+};
+template <> struct VertexFormat<glm::vec2> {
+  static constexpr vk::Format FORMAT = vk::Format::eR32G32Sfloat;
+};
+template <> struct VertexFormat<glm::vec3> {
+  static constexpr vk::Format FORMAT = vk::Format::eR32G32B32Sfloat;
+};
+template <> struct VertexFormat<glm::vec4> {
+  static constexpr vk::Format FORMAT = vk::Format::eR32G32B32A32Sfloat;
+};
+template <> struct VertexFormat<Half2> {
+  static constexpr vk::Format FORMAT = vk::Format::eR16G16Sfloat;
+};
+template <> struct VertexFormat<Snorm8x4> {
+  static constexpr vk::Format FORMAT = vk::Format::eR8G8B8A8Snorm;
+};
+template <> struct VertexFormat<Unorm8x4> {
+  static constexpr vk::Format FORMAT = vk::Format::eR8G8B8A8Unorm;
+};
+template <> struct VertexFormat<Snorm16x4> {
+  static constexpr vk::Format FORMAT = vk::Format::eR16G16B16A16Snorm;
+};
+
+struct VertexAttribute {
+  uint32_t location;
+  vk::Format format;
+  uint32_t offset;
+};
+
+/* An attribute of a vertex member of type Member, for getAttributes():
+ *   vertexAttribute<decltype(pos)>(0, offsetof(MyVertex, pos)) */
+template <typename Member>
+constexpr VertexAttribute vertexAttribute(uint32_t location, size_t offset) {
+  return {location, VertexFormat<Member>::FORMAT,
+          static_cast<uint32_t>(offset)};
+}
+
+/// A vertex struct that lists its attributes at compile time, in a static
+/// constexpr getAttributes() returning an array of VertexAttribute. The
+/// Vulkan descriptions are generated from that list, so adding or repacking
+/// a member only means changing its entry.
+template <typename V>
+concept VertexLayout = requires {
+  { V::getAttributes()[0] } -> std::convertible_to<VertexAttribute>;
+};
+
+template <VertexLayout V>
+vk::VertexInputBindingDescription getBindingDescription(uint32_t binding = 0) {
+  return vk::VertexInputBindingDescription{}
+      .setBinding(binding)
+      .setStride(sizeof(V))
+      .setInputRate(vk::VertexInputRate::eVertex);
+}
+
+template <VertexLayout V>
+std::vector<vk::VertexInputAttributeDescription>
+getAttributeDescriptions(uint32_t binding = 0) {
+  std::vector<vk::VertexInputAttributeDescription> descriptions;
+  for (const auto &attribute : V::getAttributes()) {
+    descriptions.push_back(vk::VertexInputAttributeDescription{}
+                               .setBinding(binding)
+                               .setLocation(attribute.location)
+                               .setFormat(attribute.format)
+                               .setOffset(attribute.offset));
+  }
+  return descriptions;
+}
+
+/// Maps positions inside a bounding box onto [-1, 1] to store them as snorm,
+/// and back. The vertex stage gets the quantized positions, so the mesh's
+/// model matrix has to be multiplied with getTransform().
+struct VertexQuantization {
+  glm::vec3 offset{0.0f};
+  glm::vec3 scale{1.0f};
+
+  static VertexQuantization fromBounds(const glm::vec3 &min,
+                                       const glm::vec3 &max) {
+    const auto extent = (max - min) * 0.5f;
+    // Flat along an axis, anything but 0 works
+    return {(min + max) * 0.5f,
+            glm::vec3(extent.x > 0.0f ? extent.x : 1.0f,
+                      extent.y > 0.0f ? extent.y : 1.0f,
+                      extent.z > 0.0f ? extent.z : 1.0f)};
+  }
+
+  glm::vec3 quantize(const glm::vec3 &position) const {
+    return (position - offset) / scale;
+  }
+  glm::vec3 dequantize(const glm::vec3 &quantized) const {
+    return quantized * scale + offset;
+  }
+  glm::mat4 getTransform() const {
+    return glm::scale(glm::translate(glm::mat4(1.0f), offset), scale);
+  }
+};
+} // namespace Vulking
@@ -35,3 +35,44 @@ void dothing(GLFWwindow *window) {
   buffer.set(&newData, sizeof(newData));
   buffer.unmap();
 }
+
+TEST_CASE("Headless engine renders and reads back", "[e2e]") {
+  const auto extent = vk::Extent2D{}.setWidth(64).setHeight(32);
+  Vulking::Engine engine(extent, "TestApplication", VK_MAKE_VERSION(0, 0, 1));
+  auto &ctx = engine.getContext();
+  REQUIRE(ctx.isHeadless());
+
+  const auto info = Vulking::RenderPassInfo::Create(ctx.swapchain.imageFormat,
+                                                    ctx.msaaSamples);
+  auto renderPass = ctx.device->createRenderPassUnique(info.toCreateInfo());
+  ctx.swapchain.createFramebuffers(renderPass.get());
+
+  auto clearValues = std::array<vk::ClearValue, 2>{};
+  clearValues[0].setColor(
+      vk::ClearColorValue{}.setFloat32({1.0f, 0.0f, 0.0f, 1.0f}));
+  clearValues[1].setDepthStencil({1.0f, 0});
+
+  // More frames than images, so every offscreen image gets reused
+  for (uint32_t i = 0; i < ctx.swapchain.imageCount + 1; i++) {
+    auto [cmd, index] = ctx.beginRender().value();
+    cmd.begin(vk::CommandBufferBeginInfo{});
+    cmd.beginRenderPass(vk::RenderPassBeginInfo{}
+                            .setRenderPass(renderPass.get())
+                            .setFramebuffer(ctx.swapchain.getFramebuffer())
+                            .setRenderArea(vk::Rect2D{}.setExtent(extent))
+                            .setClearValues(clearValues),
+                        vk::SubpassContents::eInline);
+    cmd.endRenderPass();
+    cmd.end();
+    ctx.endRender({cmd});
+  }
+
+  const auto pixels = ctx.readback();
+  REQUIRE(pixels.size() == extent.width * extent.height * 4);
+  REQUIRE(pixels[0] == 255);
+  REQUIRE(pixels[1] == 0);
+  REQUIRE(pixels[2] == 0);
+  REQUIRE(pixels[3] == 255);
+
+  ctx.device->waitIdle();
+}
@@ -0,0 +1,54 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("RangeAllocator sub-allocates and coalesces", "[allocator]") {
+  Vulking::RangeAllocator ranges(1024);
+
+  auto a = ranges.allocate(100, 1);
+  auto b = ranges.allocate(100, 256);
+  auto c = ranges.allocate(100, 1);
+  REQUIRE(a.has_value());
+  REQUIRE(b.has_value());
+  REQUIRE(c.has_value());
+  REQUIRE(b.value() % 256 == 0);
+  REQUIRE(ranges.getUsed() == 300);
+  REQUIRE(ranges.getAllocationCount() == 3);
+
+  // Nothing this large is left
+  REQUIRE_FALSE(ranges.allocate(1024, 1).has_value());
+
+  ranges.free(b.value());
+  ranges.free(a.value());
+  ranges.free(c.value());
+  REQUIRE(ranges.isEmpty());
+  REQUIRE(ranges.getUsed() == 0);
+  REQUIRE(ranges.getFreeRangeCount() == 1);
+  REQUIRE(ranges.getLargestFree() == 1024);
+
+  // Whole range is usable again after coalescing
+  auto whole = ranges.allocate(1024, 1);
+  REQUIRE(whole.has_value());
+  REQUIRE(whole.value() == 0);
+}
+
+TEST_CASE("RangeAllocator picks the best fitting hole", "[allocator]") {
+  Vulking::RangeAllocator ranges(1000);
+
+  auto a = ranges.allocate(500, 1);
+  auto b = ranges.allocate(100, 1);
+  auto c = ranges.allocate(50, 1);
+  auto d = ranges.allocate(350, 1);
+  REQUIRE(d.has_value());
+
+  // Holes of 500 and 50
+  ranges.free(a.value());
+  ranges.free(c.value());
+
+  auto e = ranges.allocate(40, 1);
+  REQUIRE(e.has_value());
+  REQUIRE(e.value() == c.value());
+
+  REQUIRE_THROWS(ranges.free(12345));
+}
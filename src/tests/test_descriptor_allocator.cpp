@@ -0,0 +1,85 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+vk::DescriptorSetLayoutBinding binding(uint32_t index,
+                                       vk::DescriptorType type,
+                                       uint32_t count = 1) {
+  return vk::DescriptorSetLayoutBinding{}
+      .setBinding(index)
+      .setDescriptorType(type)
+      .setDescriptorCount(count)
+      .setStageFlags(vk::ShaderStageFlagBits::eFragment);
+}
+
+vk::DescriptorSetLayout fakeLayout(uint64_t value) {
+  return vk::DescriptorSetLayout(
+      std::bit_cast<VkDescriptorSetLayout>(value));
+}
+} // namespace
+
+TEST_CASE("DescriptorAllocator sizes pools per set shape",
+          "[descriptor_allocator]") {
+  using Allocator = Vulking::DescriptorAllocator;
+  const std::array bindings = {
+      binding(0, vk::DescriptorType::eStorageBuffer),
+      binding(1, vk::DescriptorType::eUniformBuffer),
+      binding(2, vk::DescriptorType::eCombinedImageSampler, 4),
+      binding(3, vk::DescriptorType::eUniformBuffer, 2),
+  };
+
+  // Summed per type and sorted, so binding order doesn't matter
+  const auto sizes = Allocator::getSetSizes(bindings);
+  REQUIRE(sizes.size() == 3);
+  REQUIRE(std::ranges::is_sorted(sizes, {}, &vk::DescriptorPoolSize::type));
+  const auto countOf = [&](vk::DescriptorType type) {
+    return std::ranges::find(sizes, type, &vk::DescriptorPoolSize::type)
+        ->descriptorCount;
+  };
+  REQUIRE(countOf(vk::DescriptorType::eUniformBuffer) == 3);
+  REQUIRE(countOf(vk::DescriptorType::eCombinedImageSampler) == 4);
+  REQUIRE(countOf(vk::DescriptorType::eStorageBuffer) == 1);
+
+  const std::array reordered = {bindings[3], bindings[2], bindings[1],
+                                bindings[0]};
+  REQUIRE(Allocator::getSetSizes(reordered) == sizes);
+
+  const auto poolSizes = Allocator::getPoolSizes(sizes, 16);
+  REQUIRE(poolSizes.size() == sizes.size());
+  for (size_t i = 0; i < sizes.size(); i++) {
+    REQUIRE(poolSizes[i].type == sizes[i].type);
+    REQUIRE(poolSizes[i].descriptorCount == sizes[i].descriptorCount * 16);
+  }
+
+  // Doubles from the first pool up to the cap, then stays there
+  uint32_t capacity = Allocator::getNextCapacity(0);
+  REQUIRE(capacity == Allocator::INITIAL_SETS_PER_POOL);
+  for (int i = 0; i < 16; i++) {
+    const auto next = Allocator::getNextCapacity(capacity);
+    REQUIRE(next == std::min(capacity * 2, Allocator::MAX_SETS_PER_POOL));
+    capacity = next;
+  }
+  REQUIRE(capacity == Allocator::MAX_SETS_PER_POOL);
+}
+
+TEST_CASE("DescriptorAllocator forgets unregistered layouts",
+          "[descriptor_allocator]") {
+  Vulking::DescriptorAllocator allocator;
+  allocator.init(2);
+  const std::array bindings = {
+      binding(0, vk::DescriptorType::eUniformBufferDynamic)};
+  allocator.registerLayout(fakeLayout(0x1000), bindings);
+  allocator.registerLayout(fakeLayout(0x2000), bindings);
+  REQUIRE(allocator.getLayoutCount() == 2);
+
+  allocator.unregisterLayout(fakeLayout(0x1000));
+  REQUIRE(allocator.getLayoutCount() == 1);
+  REQUIRE_THROWS(allocator.allocateTransient(fakeLayout(0x1000)));
+
+  // Never registered
+  allocator.unregisterLayout(fakeLayout(0x3000));
+  REQUIRE(allocator.getLayoutCount() == 1);
+  REQUIRE(allocator.getPoolCount() == 0);
+}
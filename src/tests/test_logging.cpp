@@ -0,0 +1,106 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <thread>
+
+TEST_CASE("Logger formats records like the stream would", "[logging]") {
+  std::ostringstream output;
+  Vulking::Logger::setOutput(output);
+
+  const std::string name = "ubo";
+  const uint8_t byte = 'A';
+  LOG_INFO("set " << name << " " << 42 << " " << -1 << " " << 1.5f << " "
+                  << true << " " << byte << " " << vk::Extent2D{3, 4}.width);
+  Vulking::Logger::flush();
+  Vulking::Logger::setOutput(std::cout);
+
+  const auto text = output.str();
+  REQUIRE(text.find("[info]: set ubo 42 -1 1.5 1 A 3\n") != std::string::npos);
+  REQUIRE(text.starts_with("src/tests/test_logging.cpp:"));
+}
+
+TEST_CASE("Logger keeps every thread's records in order", "[logging]") {
+  std::ostringstream output;
+  Vulking::Logger::setOutput(output);
+
+  constexpr int THREADS = 4;
+  // More than fits in a thread's ring, so writers have to wait on the drain
+  constexpr int RECORDS = 20000;
+  std::vector<std::jthread> threads;
+  for (int t = 0; t < THREADS; t++) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < RECORDS; i++) {
+        LOG_INFO("thread " << t << " record " << i);
+      }
+    });
+  }
+  threads.clear();
+  Vulking::Logger::flush();
+  Vulking::Logger::setOutput(std::cout);
+
+  std::vector<int> next(THREADS, 0);
+  bool ordered = true;
+  std::istringstream lines(output.str());
+  std::string line;
+  while (std::getline(lines, line)) {
+    int t, i;
+    const auto at = line.find("thread ");
+    if (at == std::string::npos ||
+        std::sscanf(line.c_str() + at, "thread %d record %d", &t, &i) != 2) {
+      continue;
+    }
+    ordered = ordered && i == next[t];
+    next[t] = i + 1;
+  }
+  REQUIRE(ordered);
+  for (int t = 0; t < THREADS; t++) {
+    REQUIRE(next[t] == RECORDS);
+  }
+}
+
+TEST_CASE("Log rules filter and rate limit sites", "[logging]") {
+  std::ostringstream output;
+  Vulking::Logger::setOutput(output);
+
+  Vulking::Logger::configure("src/tests/test_logging.cpp=warning");
+  LOG_INFO("filtered");
+  LOG_WARNING("kept");
+
+  Vulking::Logger::configure("src/tests/test_logging.cpp=info/2");
+  for (int i = 0; i < 10; i++) {
+    LOG_INFO("limited " << i);
+  }
+  Vulking::Logger::flush();
+  Vulking::Logger::configure("");
+  Vulking::Logger::setOutput(std::cout);
+
+  const auto text = output.str();
+  REQUIRE(text.find("filtered") == std::string::npos);
+  REQUIRE(text.find("kept") != std::string::npos);
+  size_t limited = 0;
+  for (auto at = text.find("limited"); at != std::string::npos;
+       at = text.find("limited", at + 1)) {
+    limited++;
+  }
+  // Two per second, a second boundary in the middle of the loop allows four
+  REQUIRE(limited >= 2);
+  REQUIRE(limited <= 4);
+  REQUIRE_THROWS(Vulking::Logger::configure("loud"));
+}
+
+TEST_CASE("Log rules match installed headers as src", "[logging]") {
+  // What a LOG_* in a header template records when user code instantiates
+  // it through <vulking/...>
+  static Vulking::LogSite site{"includes/vulking/Buffer.hpp:40   ",
+                               Vulking::LogLevel::Debug};
+
+  Vulking::Logger::configure("info,src/Buffer.hpp=debug");
+  REQUIRE(site.shouldLog());
+  Vulking::Logger::configure("debug,src/Buffer.hpp=info");
+  REQUIRE_FALSE(site.shouldLog());
+  Vulking::Logger::configure("info,includes/vulking/Buffer.hpp=debug");
+  REQUIRE(site.shouldLog());
+  Vulking::Logger::configure("");
+}
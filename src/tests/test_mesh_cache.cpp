@@ -0,0 +1,74 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("MeshCache round trips and detects stale files", "[mesh_cache]") {
+  const auto dir = std::filesystem::temp_directory_path() / "vulking_tests";
+  std::filesystem::create_directories(dir);
+  const auto source = dir / "triangle.obj";
+  {
+    std::ofstream file(source, std::ios::trunc);
+    file << "v 0 0 0\nv 1 0 0\nv 0 2 0\nf 1 2 3\n";
+  }
+  std::filesystem::remove(Vulking::MeshCache::getPath(source));
+  REQUIRE(Vulking::MeshCache::open(source) == nullptr);
+
+  const std::vector<Vulking::Mesh::Vertex> vertices = {
+      {{0, 0, 0}, {1, 1, 1}, {0, 1}},
+      {{1, 0, 0}, {1, 1, 1}, {0, 1}},
+      {{0, 2, -1}, {1, 1, 1}, {0, 1}},
+  };
+  const std::vector<Vulking::Mesh::Index> indices = {0, 1, 2};
+  const auto packed = Vulking::Mesh::pack(vertices, indices);
+  Vulking::MeshCache::write(source, {}, packed);
+
+  {
+    const auto cache = Vulking::MeshCache::open(source);
+    REQUIRE(cache != nullptr);
+    REQUIRE(std::ranges::equal(cache->getVertices(), packed.vertices));
+    REQUIRE(std::ranges::equal(cache->getIndexData(), packed.indices));
+    REQUIRE(cache->getIndexType() == vk::IndexType::eUint16);
+    REQUIRE(cache->getQuantization().getTransform() ==
+            packed.quantization.getTransform());
+    REQUIRE(cache->getBounds().min == glm::vec3(0, 0, -1));
+    REQUIRE(cache->getBounds().max == glm::vec3(1, 2, 0));
+    REQUIRE(cache->getHeader().contentHash != 0);
+  }
+
+  // As does asking for other optimizations
+  REQUIRE(Vulking::MeshCache::open(source, {.overdraw = true}) == nullptr);
+
+  // Editing the source invalidates the cache
+  {
+    std::ofstream file(source, std::ios::app);
+    file << "# edited\n";
+  }
+  REQUIRE(Vulking::MeshCache::open(source) == nullptr);
+
+  // Writing the same mesh twice gives the same file
+  const auto path = Vulking::MeshCache::getPath(source);
+  const auto readFile = [&] {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+  };
+  Vulking::MeshCache::write(source, {}, packed);
+  const auto written = readFile();
+  Vulking::MeshCache::write(source, {}, packed);
+  REQUIRE(readFile() == written);
+
+  // A damaged index is caught by the content hash
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put(static_cast<char>(written.back() ^ 1));
+  }
+  REQUIRE(Vulking::MeshCache::open(source) == nullptr);
+
+  // And a cut off file by its size
+  Vulking::MeshCache::write(source, {}, packed);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  REQUIRE(Vulking::MeshCache::open(source) == nullptr);
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,78 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+
+namespace {
+/* A grid of quads with its triangles shuffled, the worst order there is */
+void makeShuffledGrid(std::vector<Vulking::Mesh::Vertex> &vertices,
+                      std::vector<Vulking::Mesh::Index> &indices) {
+  constexpr uint32_t SIZE = 32;
+  for (uint32_t y = 0; y <= SIZE; y++) {
+    for (uint32_t x = 0; x <= SIZE; x++) {
+      vertices.push_back({{float(x), float(y), 0.0f}, {1, 1, 1}, {0, 0}});
+    }
+  }
+  std::vector<std::array<Vulking::Mesh::Index, 3>> triangles;
+  for (uint32_t y = 0; y < SIZE; y++) {
+    for (uint32_t x = 0; x < SIZE; x++) {
+      const auto a = y * (SIZE + 1) + x;
+      const auto c = a + SIZE + 1;
+      triangles.push_back({a, a + 1, c + 1});
+      triangles.push_back({a, c + 1, c});
+    }
+  }
+  std::ranges::shuffle(triangles, std::mt19937(1));
+  for (const auto &triangle : triangles) {
+    indices.insert(indices.end(), triangle.begin(), triangle.end());
+  }
+}
+
+/* Every triangle's corner positions, in a canonical order */
+std::vector<std::array<float, 9>>
+getTriangles(const std::vector<Vulking::Mesh::Vertex> &vertices,
+             const std::vector<Vulking::Mesh::Index> &indices) {
+  std::vector<std::array<float, 9>> triangles;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    std::array<float, 9> corners;
+    for (int c = 0; c < 3; c++) {
+      const auto &pos = vertices[indices[i + c]].pos;
+      corners[c * 3 + 0] = pos.x;
+      corners[c * 3 + 1] = pos.y;
+      corners[c * 3 + 2] = pos.z;
+    }
+    triangles.push_back(corners);
+  }
+  std::ranges::sort(triangles);
+  return triangles;
+}
+} // namespace
+
+TEST_CASE("optimizeMesh improves ACMR and keeps the triangles",
+          "[mesh_optimizer]") {
+  std::vector<Vulking::Mesh::Vertex> vertices;
+  std::vector<Vulking::Mesh::Index> indices;
+  makeShuffledGrid(vertices, indices);
+  const auto triangles = getTriangles(vertices, indices);
+  const auto before = Vulking::analyzeVertexCache(indices, vertices.size());
+
+  const bool overdraw = GENERATE(false, true);
+  Vulking::optimizeMesh(vertices, indices, {.overdraw = overdraw});
+
+  // Corners keep their order within each triangle, so winding is unchanged
+  REQUIRE(getTriangles(vertices, indices) == triangles);
+  const auto after = Vulking::analyzeVertexCache(indices, vertices.size());
+  REQUIRE(before.acmr > 2.5f);
+  REQUIRE(after.acmr < 0.8f);
+  REQUIRE(after.atvr < before.atvr);
+
+  // Vertices are in first use order
+  Vulking::Mesh::Index next = 0;
+  for (const auto index : indices) {
+    REQUIRE(index <= next);
+    next = std::max(next, index + 1);
+  }
+  REQUIRE(next == vertices.size());
+}
@@ -0,0 +1,79 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <tiny_obj_loader.h>
+
+#include <unordered_map>
+
+/* Mesh's reference path: tinyobj with corners deduplicated in face order */
+static Vulking::ObjMesh loadWithTinyObj(const char *path) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warn, err;
+  REQUIRE(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path));
+
+  Vulking::ObjMesh mesh;
+  std::unordered_map<Vulking::Mesh::Vertex, Vulking::Mesh::Index> unique;
+  for (const auto &shape : shapes) {
+    for (const auto &index : shape.mesh.indices) {
+      Vulking::Mesh::Vertex vertex{};
+      vertex.pos = {attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]};
+      vertex.texCoord = {attrib.texcoords[2 * index.texcoord_index + 0],
+                         1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+      vertex.color = {1.0f, 1.0f, 1.0f};
+      const auto [it, inserted] = unique.try_emplace(
+          vertex, static_cast<Vulking::Mesh::Index>(mesh.vertices.size()));
+      if (inserted) {
+        mesh.vertices.push_back(vertex);
+      }
+      mesh.indices.push_back(it->second);
+    }
+  }
+  return mesh;
+}
+
+TEST_CASE("parseObj matches tinyobj", "[obj_parser]") {
+  Vulking::ThreadPool pool;
+  pool.init(4);
+
+  const char *path = PROJECT_ROOT "assets/models/viking_room.obj";
+  const auto expected = loadWithTinyObj(path);
+  const auto mesh = Vulking::loadObj(path, pool);
+  REQUIRE(mesh.has_value());
+  REQUIRE(mesh->indices == expected.indices);
+  REQUIRE(mesh->vertices == expected.vertices);
+
+  // Tiny chunks exercise the merge of chunks' vertices
+  const Vulking::MappedFile file(path);
+  const auto chunked = Vulking::parseObj(file.getText(), pool, 4096);
+  REQUIRE(chunked.has_value());
+  REQUIRE(chunked->indices == expected.indices);
+  REQUIRE(chunked->vertices == expected.vertices);
+}
+
+TEST_CASE("parseObj handles quads and relative indices", "[obj_parser]") {
+  Vulking::ThreadPool pool;
+  pool.init(4);
+
+  const std::string_view text = "# quad\n"
+                                "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                                "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+                                "f 1/1 2/2 3/3 4/4\n"
+                                "f -4/-4 -2/-2 -1/-1\n";
+  const auto mesh = Vulking::parseObj(text, pool, 16);
+  REQUIRE(mesh.has_value());
+  REQUIRE(mesh->vertices.size() == 4);
+  REQUIRE(mesh->indices.size() == 9);
+  REQUIRE(mesh->vertices[1].texCoord == glm::vec2(1.0f, 1.0f));
+  // The second face reuses the quad's corners
+  REQUIRE(std::vector(mesh->indices.begin() + 6, mesh->indices.end()) ==
+          std::vector<Vulking::Mesh::Index>{0, 3, 2});
+
+  REQUIRE_FALSE(
+      Vulking::parseObj("v 0 0 0\nf 1 1 1 1 1\n", pool, 16).has_value());
+  REQUIRE_THROWS(Vulking::parseObj("v 0 0 0\nf 0 1 1\n", pool, 16));
+}
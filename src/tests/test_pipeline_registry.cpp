@@ -0,0 +1,89 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+/* SPIR-V headers only, never handed to a driver */
+const uint32_t SHADER[] = {0x07230203, 0x00010000, 0, 16, 0};
+const uint32_t SHADER_COPY[] = {0x07230203, 0x00010000, 0, 16, 0};
+const uint32_t OTHER_SHADER[] = {0x07230203, 0x00010000, 0, 17, 0};
+
+template <typename T> T fakeHandle(uint64_t value) {
+  return T(std::bit_cast<typename T::CType>(value));
+}
+
+/* Color and depth with the same format and samples, so only the subpass
+ * wiring tells them apart */
+Vulking::RenderPassDesc makeRenderPass(uint64_t handle, uint32_t color,
+                                       uint32_t depth) {
+  const std::array attachments = {
+      vk::AttachmentDescription{}
+          .setFormat(vk::Format::eR32Sfloat)
+          .setSamples(vk::SampleCountFlagBits::e4),
+      vk::AttachmentDescription{}
+          .setFormat(vk::Format::eR32Sfloat)
+          .setSamples(vk::SampleCountFlagBits::e4),
+  };
+  const auto colorRef = vk::AttachmentReference{}.setAttachment(color);
+  const auto depthRef = vk::AttachmentReference{}.setAttachment(depth);
+  const auto subpass = vk::SubpassDescription{}
+                           .setColorAttachments(colorRef)
+                           .setPDepthStencilAttachment(&depthRef);
+  return Vulking::RenderPassDesc::fromCreateInfo(
+      fakeHandle<vk::RenderPass>(handle),
+      vk::RenderPassCreateInfo{}
+          .setAttachments(attachments)
+          .setSubpasses(subpass));
+}
+
+Vulking::GraphicsPipelineDesc makeDesc(std::span<const uint32_t> spirv,
+                                       uint64_t handles) {
+  return Vulking::GraphicsPipelineDesc{
+      .stages = {{
+          .stage = vk::ShaderStageFlagBits::eVertex,
+          .code = Vulking::ShaderCode(spirv),
+      }},
+      .layout = {.setLayouts = {fakeHandle<vk::DescriptorSetLayout>(1)}},
+      .renderPass = makeRenderPass(handles, 0, 1),
+  };
+}
+} // namespace
+
+TEST_CASE("Pipeline descriptions are keyed by content",
+          "[pipeline_registry]") {
+  // A destroyed render pass and shader reloaded into new memory
+  const auto desc = makeDesc(SHADER, 0x1000);
+  const auto same = makeDesc(SHADER_COPY, 0x2000);
+  REQUIRE(desc == same);
+  REQUIRE(desc.hash() == same.hash());
+
+  const auto other = makeDesc(OTHER_SHADER, 0x1000);
+  REQUIRE(desc != other);
+  REQUIRE(desc.hash() != other.hash());
+
+  auto specialized = desc;
+  specialized.stages[0].specialization.set(0, true);
+  REQUIRE(desc != specialized);
+
+  auto otherEntrypoint = desc;
+  otherEntrypoint.stages[0].entrypoint = "vertexMain";
+  REQUIRE(desc != otherEntrypoint);
+
+  auto otherLayout = desc;
+  otherLayout.layout.pushConstantRanges.push_back(
+      vk::PushConstantRange{}
+          .setStageFlags(vk::ShaderStageFlagBits::eFragment)
+          .setSize(sizeof(uint32_t)));
+  REQUIRE(desc != otherLayout);
+
+  auto otherSamples = desc;
+  otherSamples.renderPass.attachments[0].second = vk::SampleCountFlagBits::e1;
+  REQUIRE(desc != otherSamples);
+
+  auto swapped = desc;
+  swapped.renderPass = makeRenderPass(0x1000, 1, 0);
+  REQUIRE(swapped.renderPass.attachments == desc.renderPass.attachments);
+  REQUIRE(desc != swapped);
+  REQUIRE(desc.hash() != swapped.hash());
+}
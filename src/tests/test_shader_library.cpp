@@ -0,0 +1,72 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+/* SPIR-V headers only, never handed to a driver */
+const uint32_t EMBEDDED_VERT[] = {0x07230203, 0x00010000, 0, 1, 0};
+const uint32_t PACK_VERT[] = {0x07230203, 0x00010000, 0, 2, 0};
+const uint32_t PACK_FRAG[] = {0x07230203, 0x00010000, 0, 3, 0};
+const uint32_t OTHER_PACK_FRAG[] = {0x07230203, 0x00010000, 0, 4, 0};
+
+void writeWords(const std::filesystem::path &path,
+                std::span<const uint32_t> words) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(words.data()),
+             words.size_bytes());
+}
+} // namespace
+
+TEST_CASE("ShaderLibrary finds shaders in packs and embedded arrays",
+          "[shader_library]") {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "vulking_shader_tests";
+  std::filesystem::remove_all(dir);
+  const auto pack = dir / "pack";
+  const auto otherPack = dir / "other_pack";
+  std::filesystem::create_directories(pack);
+  std::filesystem::create_directories(otherPack);
+  writeWords(pack / "test.vert.spv", PACK_VERT);
+  writeWords(pack / "test.frag.spv", PACK_FRAG);
+  writeWords(otherPack / "test.frag.spv", OTHER_PACK_FRAG);
+  writeWords(otherPack / "other.frag.spv", OTHER_PACK_FRAG);
+  {
+    std::ofstream file(pack / "broken.frag.spv", std::ios::trunc);
+    file << "not a shader";
+  }
+
+  // Scoped so the mappings are closed before the files are removed
+  {
+    Vulking::ShaderLibrary library;
+    library.addPack(pack);
+    library.addPack(otherPack);
+
+    // Packs are searched in the order added
+    const auto frag = library.load("test.frag.spv");
+    REQUIRE(std::ranges::equal(frag.getWords(), PACK_FRAG));
+    REQUIRE(std::ranges::equal(library.load("other.frag.spv").getWords(),
+                               OTHER_PACK_FRAG));
+    // A second load reuses the mapping
+    REQUIRE(library.load("test.frag.spv").getWords().data() ==
+            frag.getWords().data());
+
+    // Embedded shaders win over packs
+    REQUIRE(std::ranges::equal(library.load("test.vert.spv").getWords(),
+                               PACK_VERT));
+    const std::array<std::pair<const char *, std::span<const uint32_t>>, 1>
+        embedded = {{{"test.vert.spv", EMBEDDED_VERT}}};
+    library.addEmbedded(embedded);
+    const auto vert = library.load("test.vert.spv");
+    REQUIRE(vert.getWords().data() == EMBEDDED_VERT);
+    REQUIRE(vert == Vulking::ShaderCode(EMBEDDED_VERT));
+
+    REQUIRE_THROWS_WITH(library.load("missing.vert.spv"),
+                        Catch::Matchers::ContainsSubstring("not found"));
+    REQUIRE_THROWS_WITH(library.load("broken.frag.spv"),
+                        Catch::Matchers::ContainsSubstring("broken.frag.spv"));
+    REQUIRE_THROWS(library.addPack(dir / "missing"));
+  }
+
+  std::filesystem::remove_all(dir);
+}
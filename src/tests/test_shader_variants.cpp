@@ -0,0 +1,36 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Specialization is keyed by its values", "[shader_variants]") {
+  Vulking::Specialization a;
+  a.set(1, 4u).set(0, true);
+  Vulking::Specialization b;
+  b.set(0, true).set(1, 4u);
+
+  // Order of set() doesn't matter, so both map to the same pipeline
+  REQUIRE(a == b);
+  REQUIRE(a.hash() == b.hash());
+
+  b.set(1, 2.0f);
+  REQUIRE(a != b);
+  REQUIRE(b.getValues().at(1) == std::bit_cast<uint32_t>(2.0f));
+
+  Vulking::GraphicsPipelineDesc descA{.stages = {{.specialization = a}}};
+  Vulking::GraphicsPipelineDesc descB{.stages = {{.specialization = b}}};
+  REQUIRE(descA != descB);
+}
+
+TEST_CASE("ShaderVariants checks constant names", "[shader_variants]") {
+  Vulking::ShaderVariants variants({}, "lit");
+  variants.feature("SHADOWS", 0).constant("LIGHTS", 1);
+
+  const auto variant = variants.variant().enable("SHADOWS").set("LIGHTS", 4u);
+  REQUIRE(variant.getSpecialization().getValues() ==
+          std::map<uint32_t, uint32_t>{{0, vk::True}, {1, 4}});
+
+  REQUIRE_THROWS(variants.variant().enable("FOG"));
+  REQUIRE_THROWS(variants.variant().set("SHADOWS", 1u));
+  REQUIRE_THROWS(variants.variant().enable("LIGHTS"));
+}
@@ -0,0 +1,108 @@
+#include <vulking/vulking.hpp>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("ThreadPool covers every item exactly once", "[thread_pool]") {
+  Vulking::ThreadPool pool;
+  pool.init(4);
+
+  std::vector<std::atomic<uint32_t>> hits(1000);
+  std::atomic<size_t> chunks = 0;
+  std::atomic<uint32_t> maxWorker = 0;
+  // Catch2 assertions aren't thread safe, so only count on the workers
+  pool.parallelFor(hits.size(), 10,
+                   [&](size_t begin, size_t end, uint32_t worker) {
+                     for (size_t i = begin; i < end; i++) {
+                       hits[i]++;
+                     }
+                     chunks++;
+                     uint32_t seen = maxWorker;
+                     while (seen < worker &&
+                            !maxWorker.compare_exchange_weak(seen, worker)) {
+                     }
+                   });
+
+  REQUIRE(chunks == pool.getChunkCount(hits.size(), 10));
+  REQUIRE(maxWorker < pool.getThreadCount());
+  for (const auto &hit : hits) {
+    REQUIRE(hit == 1);
+  }
+
+  // Never splits below minChunk
+  REQUIRE(pool.getChunkCount(15, 10) == 2);
+  REQUIRE(pool.getChunkCount(5, 10) == 1);
+  REQUIRE(pool.getChunkCount(0, 10) == 0);
+
+  REQUIRE_THROWS_AS(pool.parallelFor(100, 1,
+                                     [](size_t begin, size_t, uint32_t) {
+                                       if (begin == 0) {
+                                         throw std::runtime_error("chunk");
+                                       }
+                                     }),
+                    std::runtime_error);
+}
+
+TEST_CASE("ThreadPool runs submitted jobs before it is destroyed",
+          "[thread_pool]") {
+  std::atomic<uint32_t> ran = 0;
+  {
+    Vulking::ThreadPool pool;
+    pool.init(2);
+    for (int i = 0; i < 100; i++) {
+      pool.submit([&](uint32_t) { ran++; });
+    }
+  }
+  REQUIRE(ran == 100);
+}
+
+TEST_CASE("ThreadPool runs parallelFor inline on its own workers",
+          "[thread_pool]") {
+  Vulking::ThreadPool pool;
+  pool.init(2);
+  REQUIRE_FALSE(pool.isWorker());
+
+  // Both workers block in parallelFor, which would wait forever if it
+  // queued chunks behind them. It still has to hand out the same chunks.
+  const size_t count = 101;
+  const size_t minChunk = 10;
+  const auto chunks = pool.getChunkCount(count, minChunk);
+  REQUIRE(chunks == 2);
+  std::array<std::vector<std::pair<size_t, size_t>>, 2> ranges;
+  std::atomic<uint32_t> wrongWorker = 0;
+  std::atomic<uint32_t> finished = 0;
+  for (uint32_t job = 0; job < 2; job++) {
+    pool.submit([&, job](uint32_t worker) {
+      pool.parallelFor(count, minChunk,
+                       [&](size_t begin, size_t end, uint32_t inner) {
+                         ranges[job].emplace_back(begin, end);
+                         wrongWorker += inner != worker;
+                       });
+      finished++;
+      finished.notify_one();
+    });
+  }
+  for (auto done = finished.load(); done != 2; done = finished.load()) {
+    finished.wait(done);
+  }
+  REQUIRE(wrongWorker == 0);
+  for (const auto &jobRanges : ranges) {
+    REQUIRE(jobRanges.size() == chunks);
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      REQUIRE(jobRanges[chunk].first == chunk * count / chunks);
+      REQUIRE(jobRanges[chunk].second == (chunk + 1) * count / chunks);
+    }
+  }
+}
+
+TEST_CASE("Thread lifetimes expire when their thread exits",
+          "[thread_pool]") {
+  const auto main = Vulking::getThreadLifetime();
+  std::weak_ptr<const void> exited;
+  std::thread([&] { exited = Vulking::getThreadLifetime(); }).join();
+  REQUIRE(exited.expired());
+  REQUIRE_FALSE(main.expired());
+  REQUIRE_FALSE(Vulking::getThreadLifetime().owner_before(main));
+  REQUIRE_FALSE(main.owner_before(Vulking::getThreadLifetime()));
+}
@@ -0,0 +1,51 @@
+#include <vulking/vulking.hpp>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <glm/gtc/epsilon.hpp>
+
+TEST_CASE("Vertex descriptions come from the attribute list",
+          "[vertex_layout]") {
+  using Packed = Vulking::Mesh::PackedVertex;
+  REQUIRE(sizeof(Packed) * 2 == sizeof(Vulking::Mesh::Vertex));
+
+  const auto binding = Vulking::getBindingDescription<Packed>(1);
+  REQUIRE(binding.binding == 1);
+  REQUIRE(binding.stride == sizeof(Packed));
+
+  const auto attributes = Vulking::getAttributeDescriptions<Packed>(1);
+  REQUIRE(attributes.size() == 3);
+  REQUIRE(attributes[0].location == 0);
+  REQUIRE(attributes[0].format == vk::Format::eR16G16B16A16Snorm);
+  REQUIRE(attributes[1].format == vk::Format::eR8G8B8A8Unorm);
+  REQUIRE(attributes[1].offset == offsetof(Packed, color));
+  REQUIRE(attributes[2].format == vk::Format::eR16G16Sfloat);
+  REQUIRE(attributes[2].binding == 1);
+}
+
+TEST_CASE("Packed vertices round trip within their precision",
+          "[vertex_layout]") {
+  const std::vector<Vulking::Mesh::Vertex> vertices = {
+      {{-3.0f, 0.5f, 10.0f}, {1.0f, 0.5f, 0.0f}, {0.25f, 0.75f}},
+      {{5.0f, 0.5f, -2.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}},
+      {{1.0f, 0.5f, 4.0f}, {0.0f, 0.0f, 0.0f}, {0.5f, 0.125f}},
+  };
+  const std::vector<Vulking::Mesh::Index> indices = {0, 1, 2};
+  const auto packed = Vulking::Mesh::pack(vertices, indices);
+  REQUIRE(packed.indexType == vk::IndexType::eUint16);
+  REQUIRE(packed.indices.size() == indices.size() * sizeof(uint16_t));
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const auto unpacked = packed.vertices[i].unpack(packed.quantization);
+    // snorm16 over an extent of 12 and 8 bit colors
+    REQUIRE(glm::all(glm::epsilonEqual(unpacked.pos, vertices[i].pos,
+                                       12.0f / 32767.0f)));
+    REQUIRE(glm::all(glm::epsilonEqual(unpacked.color, vertices[i].color,
+                                       1.0f / 255.0f)));
+    REQUIRE(unpacked.texCoord == vertices[i].texCoord);
+  }
+
+  REQUIRE(Vulking::Mesh::getIndexType(UINT16_MAX) == vk::IndexType::eUint16);
+  REQUIRE(Vulking::Mesh::getIndexType(UINT16_MAX + 1) ==
+          vk::IndexType::eUint32);
+}
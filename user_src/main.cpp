@@ -6,6 +6,12 @@
 #include <ranges>
 #include <vulking/vulking.hpp>
 
+#if __has_include("embedded_shaders.hpp")
+// Generated by vulking_embed_shaders when glslc was found at configure time
+#include "embedded_shaders.hpp"
+#define HAS_EMBEDDED_SHADERS
+#endif
+
 struct UBO {
   alignas(4) glm::float32 time;
   alignas(16) glm::mat4 model;
@@ -13,14 +19,15 @@ struct UBO {
   alignas(16) glm::mat4 proj;
 };
 
-void updateUBO(const Vulking::Context &ctx, const Vulking::Buffer<UBO> &buffer);
-void updateDescriptorSets(const Vulking::Context &ctx,
-                          const std::vector<vk::UniqueDescriptorSet> &sets,
-                          const std::vector<Vulking::Buffer<UBO>> &uboBuffers,
-                          const vk::ImageView &textureImageView,
-                          const vk::Sampler &sampler);
+/* Packed in the order of getFrameDescriptorBindings, for frameTemplate */
+struct FrameDescriptors {
+  vk::DescriptorBufferInfo ubo;
+};
+
+UBO computeUBO(const Vulking::Context &ctx, const glm::mat4 &meshTransform);
 
 int main() {
+  PROFILE_THREAD_NAME("main");
   auto window = createWindow();
   auto extensions = getGlfwRequiredInstanceExtensions();
   Vulking::Engine engine(window, "Game?", vk::makeApiVersion(0, 0, 0, 1),
@@ -28,64 +35,67 @@ int main() {
 
   auto &ctx = engine.getContext();
 
+  Vulking::ShaderLibrary shaderLibrary;
+#ifdef HAS_EMBEDDED_SHADERS
+  shaderLibrary.addEmbedded(EmbeddedShaders::ALL);
+#endif
+  shaderLibrary.addPack("assets/shaders");
+
   std::map<vk::ShaderStageFlagBits, Shader> shaders = {
       {vk::ShaderStageFlagBits::eVertex,
-       loadShader(ctx, "assets/shaders/test.vert.spv", "main",
-                  "vertex_shader")},
+       {.code = shaderLibrary.load("test.vert.spv")}},
       {vk::ShaderStageFlagBits::eFragment,
-       loadShader(ctx, "assets/shaders/test.frag.spv", "main",
-                  "fragment_shader")},
+       {.code = shaderLibrary.load("test.frag.spv")}},
   };
 
   auto renderPass = createRenderPass(ctx);
   auto descriptorSetLayout = createDescriptorSetLayout(ctx);
+  Vulking::DescriptorTemplate frameTemplate;
+  frameTemplate.init(descriptorSetLayout.get(), getFrameDescriptorBindings(),
+                     "frame_descriptor_template");
+  // Set 0 is per frame, set 1 the bindless table
   std::vector<vk::DescriptorSetLayout> descriptorSetLayouts{
-      descriptorSetLayout.get()};
-  auto [pipeline, pipelineLayout] = createGraphicsPipeline(
-      ctx, renderPass, shaders, descriptorSetLayouts, "graphics_pipeline");
-
-  for (auto &[_, shader] : shaders) {
-    shader.destroy();
-  }
+      descriptorSetLayout.get(), ctx.bindless.getLayout()};
+  const auto materialRange =
+      vk::PushConstantRange{}
+          .setStageFlags(vk::ShaderStageFlagBits::eFragment)
+          .setOffset(0)
+          .setSize(sizeof(uint32_t));
+  const auto pipeline =
+      createGraphicsPipeline(ctx, renderPass, shaders, descriptorSetLayouts,
+                             {materialRange}, "graphics_pipeline");
+  const auto pipelineLayout = pipeline->getLayout();
 
   ctx.swapchain.createFramebuffers(renderPass.get());
 
-  const auto swapchainImageCount = ctx.swapchain.imageCount;
-  auto descriptorPool = Vulking::createDescriptorPool(
-      swapchainImageCount,
-      {{vk::DescriptorType::eUniformBuffer, swapchainImageCount},
-       {vk::DescriptorType::eCombinedImageSampler, swapchainImageCount}});
-
-  std::vector<Vulking::Buffer<UBO>> uboBuffers;
-  for (uint32_t i = 0; i < swapchainImageCount; i++) {
-    uboBuffers.emplace_back(UBO{}, Vulking::BufferUsage::UNIFORM,
-                            Vulking::BufferMemory::UNIFORM,
-                            std::format("ubo_buffer_{}", i).c_str());
-    uboBuffers[i].map();
-  }
-
-  const std::vector<vk::DescriptorSetLayout> layouts(swapchainImageCount,
-                                                     descriptorSetLayout.get());
-  auto descriptorSets = Vulking::allocateDescriptorSet(descriptorPool, layouts);
+  // The UBO is pushed to ctx.frameData every frame and found through the
+  // dynamic offset, so this one set is written once and never updated
+  const auto descriptorSet =
+      ctx.descriptors.allocate(descriptorSetLayout.get(), "frame_descriptors");
+  frameTemplate.update(descriptorSet,
+                       FrameDescriptors{
+                           .ubo = ctx.frameData.getBufferInfo(sizeof(UBO)),
+                       });
 
   // this shouldn't be here start
-  auto mesh = Vulking::Mesh("assets/models/viking_room.obj", "viking_room");
+  Vulking::UploadBatch uploads("scene_uploads");
+  auto mesh =
+      Vulking::Mesh("assets/models/viking_room.obj", uploads, "viking_room");
   mesh.releaseCPUResources();
 
-  auto textureImage =
-      Vulking::Image("assets/textures/viking_room.png", ctx.msaaSamples,
-                     vk::Format::eR8G8B8A8Srgb, "viking_room_texture");
+  auto textureImage = Vulking::Image("assets/textures/viking_room.png",
+                                     ctx.msaaSamples, vk::Format::eR8G8B8A8Srgb,
+                                     uploads, "viking_room_texture");
+  uploads.submit();
   auto textureImageView = engine.getContext().createImageViewUnique(
       textureImage.image.get(), vk::Format::eR8G8B8A8Srgb,
       vk::ImageAspectFlagBits::eColor, textureImage.getMipLevels());
-  auto textureSampler = Vulking::createSampler();
-
-  updateDescriptorSets(ctx, descriptorSets, uboBuffers, textureImageView.get(),
-                       textureSampler.get());
+  const auto textureIndex = ctx.bindless.addTexture(textureImageView.get());
   // this shouldn't be here end
 
   while (!glfwWindowShouldClose(window)) {
     LOG_DEBUG("polling events");
+    PROFILE_ZONE("frame_loop");
     glfwPollEvents();
     LOG_DEBUG("beginning render");
     auto ok = ctx.beginRender();
@@ -93,11 +103,12 @@ int main() {
       LOG_DEBUG("beginRender returned false, skipped frame");
       continue;
     }
-    auto [cmd, index] = ok.value();
+    auto [cmd, imageIndex] = ok.value();
     // draw frame start
 
     cmd.begin(vk::CommandBufferBeginInfo{});
-    updateUBO(ctx, uboBuffers[ctx.swapchain.getCurrentResourceIndex()]);
+    const auto ubo = ctx.frameData.push(
+        computeUBO(ctx, mesh.getQuantization().getTransform()));
 
     auto clearValues = std::array<vk::ClearValue, 2>{};
     clearValues[0].setColor(
@@ -110,33 +121,59 @@ int main() {
             .setRenderArea(vk::Rect2D{}.setExtent(ctx.swapchain.extent))
             .setClearValues(clearValues);
 
-    cmd.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-    {
-      cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline.get());
-
-      const auto viewport = vk::Viewport{}
-                                .setX(0.0f)
-                                .setY(0.0f)
-                                .setWidth((float)ctx.swapchain.extent.width)
-                                .setHeight((float)ctx.swapchain.extent.height)
-                                .setMinDepth(0.0f)
-                                .setMaxDepth(1.0f);
-      cmd.setViewport(0, 1, &viewport);
-
-      const auto scissor =
-          vk::Rect2D{}.setExtent(ctx.swapchain.extent).setOffset({0, 0});
-      cmd.setScissor(0, 1, &scissor);
-
-      // binds mesh's vertex and index buffers
-      mesh.bind(cmd);
-
-      cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                             pipelineLayout.get(), 0,
-                             {descriptorSets[index].get()}, {});
+    // Draws are recorded into secondary command buffers on the worker
+    // threads, each chunk of the draw list into its own. There's a single
+    // draw for now, but the split is the same for any number of them.
+    const auto inheritance =
+        vk::CommandBufferInheritanceInfo{}
+            .setRenderPass(renderPass.get())
+            .setSubpass(0)
+            .setFramebuffer(ctx.swapchain.getFramebuffer());
+    const auto drawCount = 1;
+    const auto secondaries = ctx.recorder.record(
+        inheritance, drawCount,
+        [&](vk::CommandBuffer cmd, size_t begin, size_t end) {
+          cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->get());
+
+          const auto viewport =
+              vk::Viewport{}
+                  .setX(0.0f)
+                  .setY(0.0f)
+                  .setWidth((float)ctx.swapchain.extent.width)
+                  .setHeight((float)ctx.swapchain.extent.height)
+                  .setMinDepth(0.0f)
+                  .setMaxDepth(1.0f);
+          cmd.setViewport(0, 1, &viewport);
+
+          const auto scissor =
+              vk::Rect2D{}.setExtent(ctx.swapchain.extent).setOffset({0, 0});
+          cmd.setScissor(0, 1, &scissor);
+
+          // binds the geometry pool every mesh lives in
+          mesh.bind(cmd);
+
+          // Bound once per secondary, draws only push their texture index
+          cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                 pipelineLayout, 0, {descriptorSet},
+                                 {ubo.offset});
+          ctx.bindless.bind(cmd, pipelineLayout, 1);
+
+          for (size_t i = begin; i < end; i++) {
+            cmd.pushConstants<uint32_t>(pipelineLayout,
+                                        vk::ShaderStageFlagBits::eFragment, 0,
+                                        textureIndex);
+            cmd.drawIndexed(mesh.getNumIndices(), 1, mesh.getFirstIndex(),
+                            mesh.getVertexOffset(), 0);
+          }
+        });
 
-      cmd.drawIndexed(mesh.getNumIndices(), 1, 0, 0, 0);
+    {
+      Vulking::GpuScope scope(ctx.gpuProfiler, cmd, "main_pass");
+      cmd.beginRenderPass(renderPassBeginInfo,
+                          vk::SubpassContents::eSecondaryCommandBuffers);
+      cmd.executeCommands(secondaries);
+      cmd.endRenderPass();
     }
-    cmd.endRenderPass();
     cmd.end();
 
     // draw frame end
@@ -145,10 +182,15 @@ int main() {
   }
 
   ctx.device->waitIdle();
+  ctx.gpuProfiler.logStats();
+  ctx.gpuProfiler.writeChromeTrace("gpu_trace.json");
+  if constexpr (Vulking::Profiler::ENABLED) {
+    Vulking::Profiler::writeChromeTrace("cpu_trace.json");
+  }
 }
 
-void updateUBO(const Vulking::Context &ctx,
-               const Vulking::Buffer<UBO> &buffer) {
+/* meshTransform maps the mesh's quantized positions to model space */
+UBO computeUBO(const Vulking::Context &ctx, const glm::mat4 &meshTransform) {
   static auto startTime = std::chrono::high_resolution_clock::now();
 
   auto currentTime = std::chrono::high_resolution_clock::now();
@@ -158,7 +200,8 @@ void updateUBO(const Vulking::Context &ctx,
 
   UBO ubo{};
   ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
-                          glm::vec3(0.0f, 0.0f, 1.0f));
+                          glm::vec3(0.0f, 0.0f, 1.0f)) *
+              meshTransform;
   ubo.view =
       glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
                   glm::vec3(0.0f, 0.0f, 1.0f));
@@ -168,44 +211,5 @@ void updateUBO(const Vulking::Context &ctx,
                               0.1f, 10.0f);
   ubo.proj[1][1] *= -1;
 
-  buffer.set(ubo);
-}
-
-void updateDescriptorSets(const Vulking::Context &ctx,
-                          const std::vector<vk::UniqueDescriptorSet> &sets,
-                          const std::vector<Vulking::Buffer<UBO>> &uboBuffers,
-                          const vk::ImageView &textureImageView,
-                          const vk::Sampler &sampler) {
-  for (auto [i, set] : std::views::enumerate(sets)) {
-    const auto bufferInfo = vk::DescriptorBufferInfo{}
-                                .setBuffer(uboBuffers[i].getBuffer())
-                                .setOffset(0)
-                                .setRange(sizeof(UBO));
-
-    const auto imageInfo =
-        vk::DescriptorImageInfo{}
-            .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-            .setImageView(textureImageView)
-            .setSampler(sampler);
-
-    std::array<vk::WriteDescriptorSet, 2> writes{};
-
-    // image must be in the correct layout here
-
-    writes[0]
-        .setDstSet(set.get())
-        .setDstBinding(0)
-        .setDstArrayElement(0)
-        .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-        .setBufferInfo(bufferInfo);
-
-    writes[1]
-        .setDstSet(set.get())
-        .setDstBinding(1)
-        .setDstArrayElement(0)
-        .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-        .setImageInfo(imageInfo);
-
-    ctx.device->updateDescriptorSets(writes, {});
-  }
+  return ubo;
 }
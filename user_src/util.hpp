@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <map>
 #include <tuple>
 #include <vulking/vulking.hpp>
@@ -7,23 +8,22 @@
 GLFWwindow *createWindow();
 
 struct Shader {
-  vk::ShaderModule module;
-  std::string entrypoint;
-
-  void destroy();
+  Vulking::ShaderCode code;
+  std::string entrypoint = "main";
 };
 
+Vulking::RenderPassInfo getRenderPassInfo(const Vulking::Context &ctx);
 vk::UniqueRenderPass createRenderPass(const Vulking::Context &ctx);
 
-vk::UniqueDescriptorSetLayout
-createDescriptorSetLayout(const Vulking::Context &ctx);
+/* Set 0, written once per frame */
+std::array<vk::DescriptorSetLayoutBinding, 1> getFrameDescriptorBindings();
 
-Shader loadShader(const Vulking::Context &ctx, const std::string &path,
-                  const std::string &entrypoint = "main",
-                  const char *name = "unnamed");
+Vulking::UniqueSetLayout createDescriptorSetLayout(Vulking::Context &ctx);
 
-std::tuple<vk::UniquePipeline, vk::UniquePipelineLayout> createGraphicsPipeline(
-    const Vulking::Context &ctx, const vk::UniqueRenderPass &renderPass,
+/* The pipeline layout is the registry's, see GraphicsPipeline::getLayout */
+std::shared_ptr<Vulking::GraphicsPipeline> createGraphicsPipeline(
+    Vulking::Context &ctx, const vk::UniqueRenderPass &renderPass,
     const std::map<vk::ShaderStageFlagBits, Shader> &shaders,
     const std::vector<vk::DescriptorSetLayout> &descriptorSetLayouts,
+    const std::vector<vk::PushConstantRange> &pushConstantRanges = {},
     const char *name = "unnamed");